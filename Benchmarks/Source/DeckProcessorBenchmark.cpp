@@ -0,0 +1,130 @@
+#include <iostream>
+#include <limits>
+#include <JuceHeader.h>
+#include "DeckProcessorBenchmark.h"
+
+
+DeckProcessorBenchmark::DeckProcessorBenchmark()
+    : noise{ 2, static_cast<int>(sampleRate * noiseSeconds) }
+{
+    // Fill the test signal with white noise, at a level that leaves
+    // headroom for the shelf boost
+    juce::Random random{ 1 };
+    for (int channel = 0; channel < noise.getNumChannels(); ++channel)
+    {
+        float* samples = noise.getWritePointer(channel);
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+        {
+            samples[i] = (random.nextFloat() * 2.0f - 1.0f) * 0.25f;
+        }
+    }
+}
+
+DeckProcessorBenchmark::~DeckProcessorBenchmark()
+{
+}
+
+void DeckProcessorBenchmark::run()
+{
+    std::cout << "Deck signal chain, nanoseconds per output sample, fastest of "
+              << numRuns << " runs" << std::endl;
+    std::cout << juce::String::formatted("%6s %10s %10s %10s %10s %10s",
+                                         "Block", "Stacked", "Linear", "Cubic", "Sinc", "Speedup")
+              << std::endl;
+
+    // Block sizes used by low latency audio devices
+    const int blockSizes[]{ 32, 64, 128 };
+    for (int blockSize : blockSizes)
+    {
+        double stacked = timeStackedChain(blockSize);
+        double linear = timeDeckProcessor(blockSize, DeckProcessor::Interpolation::linear);
+        double cubic = timeDeckProcessor(blockSize, DeckProcessor::Interpolation::cubic);
+        double sinc = timeDeckProcessor(blockSize, DeckProcessor::Interpolation::sinc);
+
+        // The stacked chain's resampler interpolates linearly, so the
+        // speedup is against the fused chain's linear interpolator
+        std::cout << juce::String::formatted("%6d %10.2f %10.2f %10.2f %10.2f %9.2fx",
+                                             blockSize, stacked, linear, cubic, sinc, stacked / linear)
+                  << std::endl;
+    }
+}
+
+double DeckProcessorBenchmark::timeStackedChain(int blockSize)
+{
+    // Build the chain the way DJAudioPlayer used to
+    juce::MemoryAudioSource trackSource{ noise, false, true };
+    juce::AudioTransportSource transportSource;
+    transportSource.setSource(&trackSource);
+    transportSource.setGain(gain);
+    juce::IIRFilterAudioSource lowShelfFilteredSource{ &transportSource, false };
+    juce::IIRFilterAudioSource highShelfFilteredSource{ &lowShelfFilteredSource, false };
+    juce::ResamplingAudioSource resampleSource{ &highShelfFilteredSource, false, 2 };
+
+    // Preparing the resampler prepares everything it pulls from
+    resampleSource.prepareToPlay(blockSize, sampleRate);
+    lowShelfFilteredSource.setCoefficients(juce::IIRCoefficients::makeLowShelf(sampleRate, 200.0, 0.7, 2.0f));
+    highShelfFilteredSource.setCoefficients(juce::IIRCoefficients::makeHighShelf(sampleRate, 5000.0, 0.7, 0.5f));
+    resampleSource.setResamplingRatio(speed);
+    transportSource.start();
+
+    double nanoseconds = timeBlocks(blockSize, [&resampleSource] (const juce::AudioSourceChannelInfo& block)
+    {
+        resampleSource.getNextAudioBlock(block);
+    });
+
+    transportSource.stop();
+    resampleSource.releaseResources();
+    transportSource.setSource(nullptr);
+    return nanoseconds;
+}
+
+double DeckProcessorBenchmark::timeDeckProcessor(int blockSize, DeckProcessor::Interpolation interpolation)
+{
+    // The deck processor pulls straight from the track. The stacked chain's
+    // transport is timed with it, as the transport applied the deck gain.
+    juce::MemoryAudioSource trackSource{ noise, false, true };
+    trackSource.prepareToPlay(blockSize, sampleRate);
+    DeckProcessor deckProcessor;
+    deckProcessor.setInterpolation(interpolation);
+    deckProcessor.setFilterCoefficients(DeckProcessor::lowShelf, 
+        juce::IIRCoefficients::makeLowShelf(sampleRate, 200.0, 0.7, 2.0f));
+    deckProcessor.setFilterCoefficients(DeckProcessor::highShelf, 
+        juce::IIRCoefficients::makeHighShelf(sampleRate, 5000.0, 0.7, 0.5f));
+
+    double nanoseconds = timeBlocks(blockSize, [&deckProcessor, &trackSource] (const juce::AudioSourceChannelInfo& block)
+    {
+        deckProcessor.process(trackSource, block, speed, speed, gain, gain);
+    });
+
+    trackSource.releaseResources();
+    return nanoseconds;
+}
+
+double DeckProcessorBenchmark::timeBlocks(int blockSize, 
+                                          const std::function<void(const juce::AudioSourceChannelInfo&)>& renderBlock)
+{
+    juce::AudioBuffer<float> output{ 2, blockSize };
+    juce::AudioSourceChannelInfo block{ &output, 0, blockSize };
+    int numBlocks = static_cast<int>(sampleRate * runSeconds) / blockSize;
+
+    // Warm up the caches and branch predictors before timing
+    for (int i = 0; i < numBlocks / 10; ++i)
+    {
+        renderBlock(block);
+    }
+
+    // Keep the fastest run
+    double fastestSeconds = std::numeric_limits<double>::max();
+    for (int run = 0; run < numRuns; ++run)
+    {
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            renderBlock(block);
+        }
+        double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        fastestSeconds = juce::jmin(fastestSeconds, seconds);
+    }
+
+    return fastestSeconds * 1.0e9 / (static_cast<double>(numBlocks) * blockSize);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <JuceHeader.h>
+#include "../../Source/DeckProcessor.h"
+
+
+/**
+ * Times one deck's signal chain, comparing the stacked AudioSource chain
+ * the decks used to play through with the fused DeckProcessor.
+ *
+ * Both paths play the same looped noise slightly faster than normal, through
+ * two shelf filters that are both cutting or boosting, and a gain, so every
+ * stage is doing real work. The old chain is the transport, two
+ * IIRFilterAudioSources and a ResamplingAudioSource, as DJAudioPlayer used
+ * to wrap them. The fused chain is timed with each of its interpolators.
+ *
+ * Each path renders the same length of audio several times over, one block
+ * at a time, and the fastest run is reported, to leave out the noise of
+ * other work on the machine.
+ */
+class DeckProcessorBenchmark
+{
+public:
+    /** Constructor. Generates the test signal. */
+    DeckProcessorBenchmark();
+
+    /** Destructor */
+    ~DeckProcessorBenchmark();
+
+    /**
+     * Times both paths at each of the block sizes, and prints a table of
+     * the results.
+     */
+    void run();
+
+private:
+    /**
+     * Times the stacked AudioSource chain.
+     *
+     * @param blockSize - The number of samples rendered per block.
+     * @return The time taken per output sample, in nanoseconds.
+     */
+    double timeStackedChain(int blockSize);
+
+    /**
+     * Times the fused DeckProcessor.
+     *
+     * @param blockSize     - The number of samples rendered per block.
+     * @param interpolation - The interpolation to resample with.
+     * @return The time taken per output sample, in nanoseconds.
+     */
+    double timeDeckProcessor(int blockSize, DeckProcessor::Interpolation interpolation);
+
+    /**
+     * Renders audio one block at a time, and times it.
+     *
+     * @param blockSize   - The number of samples rendered per block.
+     * @param renderBlock - Fills one block of output.
+     * @return The fastest run's time per output sample, in nanoseconds.
+     */
+    static double timeBlocks(int blockSize, const std::function<void(const juce::AudioSourceChannelInfo&)>& renderBlock);
+
+    // Looped stereo noise, the input to both paths
+    juce::AudioBuffer<float> noise;
+
+    // Settings both paths play with
+    static constexpr double sampleRate{ 44100.0 };
+    static constexpr double speed{ 1.02 };
+    static constexpr float gain{ 0.8f };
+    // Length of the test signal, and of each timed run, in seconds
+    static constexpr double noiseSeconds{ 10.0 };
+    static constexpr double runSeconds{ 60.0 };
+    // Number of timed runs for each path
+    static constexpr int numRuns{ 5 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckProcessorBenchmark)
+};
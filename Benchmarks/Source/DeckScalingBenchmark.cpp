@@ -0,0 +1,160 @@
+#include <iostream>
+#include <limits>
+#include <JuceHeader.h>
+#include "DeckScalingBenchmark.h"
+
+
+DeckScalingBenchmark::DeckScalingBenchmark()
+{
+    formatManager.registerBasicFormats();
+
+    // Write a different noise track for each deck, so no two decks read
+    // the same memory
+    juce::WavAudioFormat wavFormat;
+    juce::AudioBuffer<float> noise{ 2, static_cast<int>(sampleRate * trackSeconds) };
+    for (int deck = 0; deck < DeckManager::maxDecks; ++deck)
+    {
+        juce::Random random{ deck + 1 };
+        for (int channel = 0; channel < noise.getNumChannels(); ++channel)
+        {
+            float* samples = noise.getWritePointer(channel);
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+            {
+                samples[i] = (random.nextFloat() * 2.0f - 1.0f) * 0.1f;
+            }
+        }
+
+        auto* trackFile = trackFiles.add(new juce::TemporaryFile{ ".wav" });
+        std::unique_ptr<juce::AudioFormatWriter> writer{ wavFormat.createWriterFor(
+            new juce::FileOutputStream{ trackFile->getFile() }, sampleRate, 2, 16, {}, 0) };
+        if (writer == nullptr || !writer->writeFromAudioSampleBuffer(noise, 0, noise.getNumSamples()))
+        {
+            DBG("DeckScalingBenchmark: could not write " << trackFile->getFile().getFullPathName());
+        }
+    }
+}
+
+DeckScalingBenchmark::~DeckScalingBenchmark()
+{
+}
+
+void DeckScalingBenchmark::run()
+{
+    std::cout << "Deck engine, microseconds per block, fastest of " << numRuns << " runs, "
+              << juce::SystemStats::getNumCpus() << " CPUs" << std::endl;
+
+    // Block sizes used by low latency audio devices
+    const int blockSizes[]{ 64, 256 };
+    for (int blockSize : blockSizes)
+    {
+        std::cout << std::endl << "Block size " << blockSize << std::endl;
+        std::cout << juce::String::formatted("%6s %12s %12s %10s", "Decks", "Per block", "Per deck", "Scaling")
+                  << std::endl;
+
+        double oneDeckTime = 0;
+        for (int numDecks = 1; numDecks <= DeckManager::maxDecks; ++numDecks)
+        {
+            Timing timing = timeDecks(numDecks, blockSize);
+            if (timing.blockTime < 0)
+            {
+                std::cout << juce::String::formatted("%6d   decks did not start", numDecks) << std::endl;
+                continue;
+            }
+
+            // Scaling is the time per deck relative to a single deck, so 1.0
+            // means each deck costs the same however many are playing
+            if (numDecks == 1)
+            {
+                oneDeckTime = timing.deckTime;
+            }
+            std::cout << juce::String::formatted("%6d %12.2f %12.2f %10.2f", numDecks, timing.blockTime, 
+                                                 timing.deckTime, timing.deckTime / oneDeckTime)
+                      << std::endl;
+        }
+    }
+}
+
+DeckScalingBenchmark::Timing DeckScalingBenchmark::timeDecks(int numDecks, int blockSize)
+{
+    DeckManager deckManager{ formatManager, trackCache, thumbCache };
+    deckManager.prepareToPlay(blockSize, sampleRate);
+
+    // Load each deck with its own track, at its own speed and EQ
+    for (int i = 0; i < numDecks; ++i)
+    {
+        deckManager.addDeck();
+        DJAudioPlayer* player = deckManager.getPlayer(i);
+        player->setLoadMode(DJAudioPlayer::LoadMode::decodeToMemory);
+        player->setSpeed(0.95 + 0.02 * i);
+        player->setLowShelf(200.0, 0.5f, 0.7);
+        player->setHighShelf(5000.0, 0.7f, 0.7);
+        player->loadURL(juce::URL{ trackFiles[i]->getFile() });
+    }
+
+    // Stereo output, as most devices have
+    juce::AudioBuffer<float> output{ 2, blockSize };
+    if (!startDecks(deckManager, output))
+    {
+        deckManager.releaseResources();
+        return { -1.0, -1.0 };
+    }
+
+    // Render the same length of audio several times over, keeping the
+    // fastest run
+    juce::AudioSourceChannelInfo block{ &output, 0, blockSize };
+    int numBlocks = static_cast<int>(sampleRate * runSeconds) / blockSize;
+    double fastestSeconds = std::numeric_limits<double>::max();
+    double lowestDeckLoad = std::numeric_limits<double>::max();
+    for (int run = 0; run < numRuns; ++run)
+    {
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            deckManager.getNextAudioBlock(block);
+        }
+        double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        fastestSeconds = juce::jmin(fastestSeconds, seconds);
+
+        // Each deck's load has settled over the run, so it's the deck's
+        // render time as a proportion of a block's duration
+        double deckLoad = 0;
+        for (int i = 0; i < numDecks; ++i)
+        {
+            deckLoad += deckManager.getDeckLoad(i);
+        }
+        lowestDeckLoad = juce::jmin(lowestDeckLoad, deckLoad / numDecks);
+    }
+
+    deckManager.releaseResources();
+    double blockDuration = blockSize * 1.0e6 / sampleRate;
+    return { fastestSeconds * 1.0e6 / numBlocks, lowestDeckLoad * blockDuration };
+}
+
+// A deck picks up its track at the start of a block and then stops, so it's
+// asked to play again after every block until its playhead moves
+bool DeckScalingBenchmark::startDecks(DeckManager& deckManager, juce::AudioBuffer<float>& output)
+{
+    juce::AudioSourceChannelInfo block{ &output, 0, output.getNumSamples() };
+    juce::uint32 startMs = juce::Time::getMillisecondCounter();
+    while (juce::Time::getMillisecondCounter() - startMs < static_cast<juce::uint32>(startTimeoutMs))
+    {
+        bool allPlaying = true;
+        for (int i = 0; i < deckManager.getNumDecks(); ++i)
+        {
+            DJAudioPlayer* player = deckManager.getPlayer(i);
+            if (player->getPositionRelative() <= 0)
+            {
+                allPlaying = false;
+                player->start();
+            }
+        }
+        if (allPlaying)
+        {
+            return true;
+        }
+
+        deckManager.getNextAudioBlock(block);
+        juce::Thread::sleep(1);
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <JuceHeader.h>
+#include "../../Source/DecodedTrackCache.h"
+#include "../../Source/DeckManager.h"
+
+
+/**
+ * Times the whole deck engine with one to maxDecks decks playing, to show
+ * how the audio thread's time grows with the number of decks.
+ *
+ * Each deck plays its own track, decoded into memory, at a slightly
+ * different speed and with both shelf filters cutting, so the
+ * decks don't share any work. The DeckManager is driven offline, one block
+ * at a time, the way the audio device would call it.
+ *
+ * For each number of decks, the fastest of several runs is reported for
+ * the whole block. The time per deck is the average of the decks' own
+ * render times, as the DeckManager measures them, rather than the block's
+ * time divided by the number of decks, so it stays a deck's real cost
+ * however the decks are scheduled. If the engine scales linearly, the time
+ * per deck stays flat as decks are added.
+ */
+class DeckScalingBenchmark
+{
+public:
+    /** Constructor. Writes a test track for each deck. */
+    DeckScalingBenchmark();
+
+    /** Destructor. Deletes the test tracks. */
+    ~DeckScalingBenchmark();
+
+    /**
+     * Times the engine with each number of decks at each block size, and
+     * prints a table of the results.
+     */
+    void run();
+
+private:
+    /** The times measured for one number of decks, in microseconds. */
+    struct Timing
+    {
+        double blockTime;
+        double deckTime;
+    };
+
+    /**
+     * Times the engine with a number of decks playing.
+     *
+     * @param numDecks  - The number of decks to play.
+     * @param blockSize - The number of samples rendered per block.
+     * @return The fastest run's time per block, and the average time each
+     *     deck took to render a block, in microseconds. Both are negative
+     *     if the decks didn't start playing.
+     */
+    Timing timeDecks(int numDecks, int blockSize);
+
+    /**
+     * Renders blocks until every deck's track has been picked up and the
+     * deck is playing.
+     *
+     * @param deckManager - The decks to start.
+     * @param output      - A buffer to render into.
+     * @return True if every deck started playing in time.
+     */
+    static bool startDecks(DeckManager& deckManager, juce::AudioBuffer<float>& output);
+
+    // Shared services for the decks, as MainComponent sets them up
+    juce::AudioFormatManager formatManager;
+    DecodedTrackCache trackCache{ formatManager };
+    juce::AudioThumbnailCache thumbCache{ 1 };
+
+    // One noise track per deck
+    juce::OwnedArray<juce::TemporaryFile> trackFiles;
+
+    // Settings the decks play with
+    static constexpr double sampleRate{ 44100.0 };
+    // Length of each test track, and of each timed run, in seconds
+    static constexpr double trackSeconds{ 20.0 };
+    static constexpr double runSeconds{ 10.0 };
+    // Number of timed runs for each number of decks
+    static constexpr int numRuns{ 3 };
+    // Longest to wait for the decks to start playing, in milliseconds
+    static constexpr int startTimeoutMs{ 10000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckScalingBenchmark)
+};
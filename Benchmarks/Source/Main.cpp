@@ -0,0 +1,29 @@
+/*
+  ==============================================================================
+
+    Offline benchmarks for the DJApp audio engine. Run the Release build, on
+    a machine that is otherwise idle, for meaningful numbers.
+
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <JuceHeader.h>
+#include "DeckProcessorBenchmark.h"
+#include "DeckScalingBenchmark.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The transport sends change messages, so a message manager is needed
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    DeckProcessorBenchmark deckProcessorBenchmark;
+    deckProcessorBenchmark.run();
+    std::cout << std::endl;
+
+    DeckScalingBenchmark deckScalingBenchmark;
+    deckScalingBenchmark.run();
+
+    return 0;
+}
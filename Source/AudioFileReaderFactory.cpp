@@ -0,0 +1,65 @@
+#include <JuceHeader.h>
+#include "AudioFileReaderFactory.h"
+
+
+AudioFileReaderFactory::AudioFileReaderFactory(juce::AudioFormatManager& _formatManager)
+    : formatManager{ _formatManager }
+{
+}
+
+AudioFileReaderFactory::~AudioFileReaderFactory()
+{
+}
+
+std::unique_ptr<juce::AudioFormatReader> AudioFileReaderFactory::createReaderFor(const juce::File& file) const
+{
+    // Map the file if possible
+    if (auto mappedReader = createMappedReaderFor(file))
+    {
+        return mappedReader;
+    }
+
+    // Otherwise read it through a stream
+    return std::unique_ptr<juce::AudioFormatReader>{ formatManager.createReaderFor(file) };
+}
+
+std::unique_ptr<juce::AudioFormatReader> AudioFileReaderFactory::createReaderFor(const juce::URL& audioURL) const
+{
+    if (audioURL.isLocalFile())
+    {
+        return createReaderFor(audioURL.getLocalFile());
+    }
+
+    // Convert audioURL to an input stream and create an AudioFormatReader for it
+    return std::unique_ptr<juce::AudioFormatReader>{ 
+        formatManager.createReaderFor(audioURL.createInputStream(false)) };
+}
+
+// Only formats that store plain PCM, like WAV and AIFF, create memory-mapped
+// readers. The rest return nullptr, as do PCM formats for compressed files.
+std::unique_ptr<juce::AudioFormatReader> AudioFileReaderFactory::createMappedReaderFor(const juce::File& file) const
+{
+    // Find the format from the file extension
+    juce::AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr)
+    {
+        return nullptr;
+    }
+
+    // Parse the header, and check the format can be mapped
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader{ format->createMemoryMappedReader(file) };
+    if (reader == nullptr || reader->sampleRate <= 0)
+    {
+        return nullptr;
+    }
+
+    // Map the audio data. This only reserves address space; pages are read
+    // from disk when they are first touched.
+    if (!reader->mapEntireFile())
+    {
+        DBG("AudioFileReaderFactory: could not map " << file.getFullPathName());
+        return nullptr;
+    }
+
+    return reader;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <JuceHeader.h>
+
+
+/**
+ * Creates format readers for audio files, memory-mapping uncompressed WAV
+ * and AIFF files instead of reading them through a stream.
+ *
+ * A mapped reader reads samples straight out of the file's pages, so seeking
+ * costs at most a page fault rather than a buffered stream read, and the
+ * operating system shares the pages between every reader of the same file.
+ * Compressed files, remote URLs and files that can't be mapped fall back to
+ * the format manager's normal stream-based readers.
+ */
+class AudioFileReaderFactory
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app. Used to find the format for each file.
+     */
+    AudioFileReaderFactory(juce::AudioFormatManager& _formatManager);
+
+    /**
+     * Destructor
+     */
+    ~AudioFileReaderFactory();
+
+    /**
+     * Creates a reader for a local audio file. Safe to call from several
+     * threads at once.
+     *
+     * @param file - The audio file to read.
+     * @return The reader, or nullptr if the file can't be read as audio.
+     */
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::File& file) const;
+
+    /**
+     * Creates a reader for an audio URL. Local files are read as above, and
+     * anything else through an input stream.
+     *
+     * @param audioURL - The URL of the audio file to read.
+     * @return The reader, or nullptr if the URL can't be read as audio.
+     */
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::URL& audioURL) const;
+
+private:
+    /**
+     * Creates a memory-mapped reader for a file, if its format supports
+     * mapping and the whole file can be mapped.
+     *
+     * @param file - The audio file to read.
+     * @return The mapped reader, or nullptr if the file can't be mapped.
+     */
+    std::unique_ptr<juce::AudioFormatReader> createMappedReaderFor(const juce::File& file) const;
+
+    // Shared format manager
+    juce::AudioFormatManager& formatManager;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileReaderFactory)
+};
@@ -0,0 +1,360 @@
+#include <cmath>
+#include <JuceHeader.h>
+#include "BeatAnalyser.h"
+
+
+BeatAnalyser::BeatAnalyser(juce::AudioFormatManager& _formatManager)
+    : formatManager{ _formatManager }
+{
+}
+
+BeatAnalyser::~BeatAnalyser()
+{
+}
+
+// A new reader is made for each call, which keeps the analyser safe to
+// share between import threads
+bool BeatAnalyser::analyse(const juce::File& file, BeatGrid& beatGrid, const std::function<bool()>& shouldStop) const
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ readerFactory.createReaderFor(file) };
+    if (reader == nullptr)
+    {
+        DBG("BeatAnalyser::analyse: the file could not be read. File: " + file.getFullPathName());
+        return false;
+    }
+    return analyse(*reader, beatGrid, shouldStop);
+}
+
+bool BeatAnalyser::analyse(juce::AudioFormatReader& reader, BeatGrid& beatGrid, const std::function<bool()>& shouldStop)
+{
+    // Make sure there are enough beats to find a tempo from
+    if (reader.sampleRate <= 0 || reader.lengthInSamples < reader.sampleRate * minTrackSeconds)
+    {
+        return false;
+    }
+
+    // Decode the track into its onset envelopes
+    OnsetEnvelopes envelopes;
+    if (!readOnsetEnvelopes(reader, envelopes, shouldStop))
+    {
+        return false;
+    }
+
+    // Keep just the peaks of the coarse envelope, so the tempo isn't
+    // swayed by the track getting louder or quieter
+    double framesPerSecond = reader.sampleRate / envelopes.coarseHop;
+    removeLocalMean(envelopes.coarse, juce::roundToInt(framesPerSecond * 0.5));
+
+    // Estimate the beat period, then refine it over the whole track, first
+    // to within a frame and then to a small fraction of one
+    double period = findBeatPeriod(envelopes.coarse, framesPerSecond);
+    if (period <= 0)
+    {
+        return false;
+    }
+    period = refineBeatPeriod(envelopes.coarse, period, 1.0, 0.02);
+    period = refineBeatPeriod(envelopes.coarse, period, 0.02, 0.001);
+
+    // Give up on tracks without a steady beat
+    BeatAlignment coarseAlignment = alignBeats(envelopes.coarse, period, 0, period);
+    if (coarseAlignment.strength < minBeatStrength)
+    {
+        return false;
+    }
+
+    // Refine the period once more against the fine envelope, whose onsets
+    // are sharper, then place the beats close to where the coarse envelope
+    // puts them
+    double fineFramesPerCoarse = static_cast<double>(envelopes.coarseHop) / fineHop;
+    double finePeriod = refineBeatPeriod(envelopes.fine, period * fineFramesPerCoarse,
+                                         0.002 * fineFramesPerCoarse, 0.0001 * fineFramesPerCoarse);
+    double coarsePhase = coarseAlignment.phase * fineFramesPerCoarse;
+    BeatAlignment fineAlignment = alignBeats(envelopes.fine, finePeriod,
+                                             coarsePhase - fineFramesPerCoarse,
+                                             coarsePhase + fineFramesPerCoarse);
+
+    beatGrid.bpm = 60.0 * reader.sampleRate / (finePeriod * fineHop);
+    beatGrid.firstBeatSample = static_cast<juce::int64>(std::round(fineAlignment.phase * fineHop));
+    return true;
+}
+
+// Each envelope frame is how much louder the frame is than the one before,
+// on a compressed scale. The coarse envelope adds the bass band's rise to
+// the full signal's, so kick drums stand out.
+bool BeatAnalyser::readOnsetEnvelopes(juce::AudioFormatReader& reader,
+                                      OnsetEnvelopes& envelopes,
+                                      const std::function<bool()>& shouldStop)
+{
+    // Coarse frames are a whole number of fine frames
+    int fineFramesPerCoarse = juce::jmax(1, juce::roundToInt(reader.sampleRate / coarseFramesPerSecond / fineHop));
+    envelopes.coarseHop = fineFramesPerCoarse * fineHop;
+    envelopes.fine.reserve(static_cast<size_t>(reader.lengthInSamples / fineHop) + 1);
+    envelopes.coarse.reserve(static_cast<size_t>(reader.lengthInSamples / envelopes.coarseHop) + 1);
+
+    // One-pole low-pass filter for the bass band
+    float bassCoefficient = static_cast<float>(1.0 - std::exp(-juce::MathConstants<double>::twoPi
+                                                              * bassCutoff / reader.sampleRate));
+    float bass{ 0 };
+
+    // Energy of the frames in progress, and the levels of the last frames
+    float fineEnergy{ 0 };
+    float coarseEnergy{ 0 };
+    float bassEnergy{ 0 };
+    int fineSamples{ 0 };
+    int coarseFineFrames{ 0 };
+    float lastFineLevel{ 0 };
+    float lastCoarseLevel{ 0 };
+    float lastBassLevel{ 0 };
+
+    // Read the track in chunks, mixed down to mono. Mono tracks are read
+    // into both channels.
+    juce::AudioBuffer<float> buffer{ 2, chunkSize };
+    for (juce::int64 position = 0; position < reader.lengthInSamples; position += chunkSize)
+    {
+        if (shouldStop != nullptr && shouldStop())
+        {
+            return false;
+        }
+
+        int numSamples = static_cast<int>(juce::jmin<juce::int64>(chunkSize, reader.lengthInSamples - position));
+        if (!reader.read(&buffer, 0, numSamples, position, true, true))
+        {
+            return false;
+        }
+
+        const float* left = buffer.getReadPointer(0);
+        const float* right = buffer.getReadPointer(1);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float sample = 0.5f * (left[i] + right[i]);
+            bass += bassCoefficient * (sample - bass);
+            fineEnergy += sample * sample;
+            bassEnergy += bass * bass;
+            if (++fineSamples < fineHop)
+            {
+                continue;
+            }
+
+            // Finish the fine frame
+            float fineLevel = std::log1p(energyCompression * fineEnergy / fineHop);
+            envelopes.fine.push_back(juce::jmax(0.0f, fineLevel - lastFineLevel));
+            lastFineLevel = fineLevel;
+            coarseEnergy += fineEnergy;
+            fineEnergy = 0;
+            fineSamples = 0;
+            if (++coarseFineFrames < fineFramesPerCoarse)
+            {
+                continue;
+            }
+
+            // Finish the coarse frame
+            float coarseLevel = std::log1p(energyCompression * coarseEnergy / envelopes.coarseHop);
+            float bassLevel = std::log1p(energyCompression * bassEnergy / envelopes.coarseHop);
+            envelopes.coarse.push_back(juce::jmax(0.0f, coarseLevel - lastCoarseLevel)
+                                       + juce::jmax(0.0f, bassLevel - lastBassLevel));
+            lastCoarseLevel = coarseLevel;
+            lastBassLevel = bassLevel;
+            coarseEnergy = 0;
+            bassEnergy = 0;
+            coarseFineFrames = 0;
+        }
+    }
+    return true;
+}
+
+void BeatAnalyser::removeLocalMean(std::vector<float>& envelope, int windowInFrames)
+{
+    // Keep the original values, as the window reaches ahead of the frame
+    // being changed
+    std::vector<float> original{ envelope };
+    int numFrames = static_cast<int>(original.size());
+    int halfWindow = juce::jmax(1, windowInFrames / 2);
+
+    // Slide a window centred on each frame along the envelope, keeping a
+    // running sum of the frames in it
+    double sum{ 0 };
+    int count{ 0 };
+    for (int i = 0; i < juce::jmin(halfWindow, numFrames); ++i)
+    {
+        sum += original[static_cast<size_t>(i)];
+        ++count;
+    }
+    for (int i = 0; i < numFrames; ++i)
+    {
+        if (i + halfWindow < numFrames)
+        {
+            sum += original[static_cast<size_t>(i + halfWindow)];
+            ++count;
+        }
+        if (i - halfWindow - 1 >= 0)
+        {
+            sum -= original[static_cast<size_t>(i - halfWindow - 1)];
+            --count;
+        }
+        float localMean = static_cast<float>(sum / count);
+        envelope[static_cast<size_t>(i)] = juce::jmax(0.0f, original[static_cast<size_t>(i)] - localMean);
+    }
+}
+
+// A beat period shows up as peaks in the autocorrelation at the period and
+// its multiples, so each candidate is scored by summing those (a comb
+// filter). Candidates are tried every twentieth of a frame, with the
+// autocorrelation interpolated between whole lags.
+double BeatAnalyser::findBeatPeriod(const std::vector<float>& envelope, double framesPerSecond)
+{
+    int minLag = static_cast<int>(std::floor(framesPerSecond * 60.0 / maxBpm));
+    int maxLag = static_cast<int>(std::ceil(framesPerSecond * 60.0 / minBpm));
+    int maxCombLag = (maxLag + 1) * combHarmonics;
+    int numFrames = static_cast<int>(envelope.size());
+    if (numFrames < maxCombLag * 2)
+    {
+        return 0;
+    }
+
+    // Autocorrelation at every lag the comb filter reaches
+    std::vector<float> autocorrelation(static_cast<size_t>(maxCombLag) + 1);
+    const float* data = envelope.data();
+    for (int lag = 0; lag <= maxCombLag; ++lag)
+    {
+        float sum{ 0 };
+        for (int i = lag; i < numFrames; ++i)
+        {
+            sum += data[i] * data[i - lag];
+        }
+        autocorrelation[static_cast<size_t>(lag)] = sum / static_cast<float>(numFrames - lag);
+    }
+
+    // Linear interpolation between whole lags
+    auto autocorrelationAt = [&autocorrelation](double lag) {
+        size_t index = static_cast<size_t>(lag);
+        float fraction = static_cast<float>(lag - static_cast<double>(index));
+        return autocorrelation[index] + fraction * (autocorrelation[index + 1] - autocorrelation[index]);
+    };
+
+    // Score every candidate period in the tempo range
+    double bestPeriod{ 0 };
+    float bestScore{ -1.0f };
+    for (double period = minLag; period <= maxLag; period += 0.05)
+    {
+        double bpm = 60.0 * framesPerSecond / period;
+        if (bpm < minBpm || bpm > maxBpm)
+        {
+            continue;
+        }
+
+        float score{ 0 };
+        for (int harmonic = 1; harmonic <= combHarmonics; ++harmonic)
+        {
+            score += autocorrelationAt(period * harmonic);
+        }
+
+        // Lean towards the preferred tempo, on a log scale, so a track
+        // isn't read at half or double its tempo
+        double octaves = std::log2(bpm / preferredBpm) / tempoPriorWidth;
+        score *= static_cast<float>(std::exp(-0.5 * octaves * octaves));
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestPeriod = period;
+        }
+    }
+    return bestPeriod;
+}
+
+// A slightly wrong period smears the folded onsets across several frames,
+// so the period that lines them up most sharply is the most accurate
+double BeatAnalyser::refineBeatPeriod(const std::vector<float>& envelope, double period, double range, double step)
+{
+    double bestPeriod{ period };
+    float bestStrength{ -1.0f };
+    int numSteps = juce::roundToInt(range / step);
+    for (int i = -numSteps; i <= numSteps; ++i)
+    {
+        double candidate = period + i * step;
+        BeatAlignment alignment = alignBeats(envelope, candidate, 0, candidate);
+        if (alignment.strength > bestStrength)
+        {
+            bestStrength = alignment.strength;
+            bestPeriod = candidate;
+        }
+    }
+    return bestPeriod;
+}
+
+// Every frame is added into a bin by its phase within the beat period. The
+// beats are in the bin with the strongest average, and their phase is the
+// weighted average phase of the frames in and around it, which places them
+// to a fraction of a frame.
+BeatAnalyser::BeatAlignment BeatAnalyser::alignBeats(const std::vector<float>& envelope, double period,
+                                                      double searchStart, double searchEnd)
+{
+    // Fold the envelope into one bin per frame of the period
+    int numBins = static_cast<int>(std::ceil(period));
+    std::vector<float> binSums(static_cast<size_t>(numBins), 0.0f);
+    std::vector<float> binPhaseSums(static_cast<size_t>(numBins), 0.0f);
+    std::vector<int> binCounts(static_cast<size_t>(numBins), 0);
+    double inversePeriod = 1.0 / period;
+    float total{ 0 };
+    for (size_t frame = 0; frame < envelope.size(); ++frame)
+    {
+        double position = static_cast<double>(frame);
+        double phase = position - period * std::floor(position * inversePeriod);
+        size_t bin = static_cast<size_t>(juce::jmin(numBins - 1, static_cast<int>(phase)));
+        binSums[bin] += envelope[frame];
+        binPhaseSums[bin] += envelope[frame] * static_cast<float>(phase);
+        ++binCounts[bin];
+        total += envelope[frame];
+    }
+    if (total <= 0)
+    {
+        return {};
+    }
+
+    // Wraps a bin number around the period
+    auto wrap = [numBins](int bin) { return ((bin % numBins) + numBins) % numBins; };
+    // Average strength of the frames in a bin and its neighbours
+    auto averageAround = [&](int bin) {
+        float sum{ 0 };
+        int count{ 0 };
+        for (int offset = -1; offset <= 1; ++offset)
+        {
+            sum += binSums[static_cast<size_t>(wrap(bin + offset))];
+            count += binCounts[static_cast<size_t>(wrap(bin + offset))];
+        }
+        return count > 0 ? sum / count : 0.0f;
+    };
+
+    // Find the strongest bin in the search range
+    int bestBin{ 0 };
+    float bestAverage{ -1.0f };
+    for (int bin = static_cast<int>(std::floor(searchStart)); bin <= static_cast<int>(std::floor(searchEnd)); ++bin)
+    {
+        float average = averageAround(bin);
+        if (average > bestAverage)
+        {
+            bestAverage = average;
+            bestBin = wrap(bin);
+        }
+    }
+
+    // Average the phase of the onsets around it. Neighbouring bins across
+    // the end of the period are moved a period along, so they average in
+    // the right place.
+    double weightedPhase{ 0 };
+    double weight{ 0 };
+    for (int offset = -1; offset <= 1; ++offset)
+    {
+        int bin = bestBin + offset;
+        double shift = bin < 0 ? -period : (bin >= numBins ? period : 0.0);
+        size_t index = static_cast<size_t>(wrap(bin));
+        weightedPhase += binPhaseSums[index] + shift * binSums[index];
+        weight += binSums[index];
+    }
+
+    BeatAlignment alignment;
+    alignment.phase = weight > 0 ? weightedPhase / weight : bestBin;
+    alignment.phase -= period * std::floor(alignment.phase * inversePeriod);
+    alignment.strength = bestAverage / (total / static_cast<float>(envelope.size()));
+    return alignment;
+}
\ No newline at end of file
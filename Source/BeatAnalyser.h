@@ -0,0 +1,168 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <JuceHeader.h>
+#include "MusicTrack.h"
+#include "AudioFileReaderFactory.h"
+
+
+/**
+ * Finds the tempo and beats of a track, offline, for the library's beatgrids.
+ *
+ * The track is decoded once and reduced to two onset envelopes, which rise
+ * wherever the sound gets suddenly louder: a coarse one, about 200 frames
+ * per second, that combines the full signal with its bass, and a fine one,
+ * 32 samples per frame, for placing the beats precisely.
+ *
+ * The tempo is the beat period whose multiples best match the coarse
+ * envelope's autocorrelation, a comb filter over its first few harmonics,
+ * weighted gently towards faster tempos, as the comb favours half tempo.
+ * The range reaches 200 BPM, so drum and bass and jungle aren't folded to
+ * half tempo. The period is then refined, and the beats placed, by folding
+ * the envelopes over the whole track at the beat period and finding where
+ * the onsets line up.
+ *
+ * The result is a constant-tempo beatgrid, as used for beatmatching. Most
+ * of the analysis time is spent decoding the track.
+ */
+class BeatAnalyser
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app. Used to create readers for the tracks.
+     */
+    BeatAnalyser(juce::AudioFormatManager& _formatManager);
+
+    /**
+     * Destructor
+     */
+    ~BeatAnalyser();
+
+    /**
+     * Analyses an audio file. Blocks until the whole track has been read, so
+     * only call this on a background thread. Safe to call from several
+     * threads at once.
+     *
+     * @param file       - The audio file to analyse.
+     * @param beatGrid   - The beatgrid to fill in.
+     * @param shouldStop - Checked between chunks. Return true to give up.
+     * @return True if a steady beat was found.
+     */
+    bool analyse(const juce::File& file, BeatGrid& beatGrid, const std::function<bool()>& shouldStop) const;
+
+    /**
+     * Analyses a track from a reader.
+     *
+     * @param reader     - The reader for the track.
+     * @param beatGrid   - The beatgrid to fill in.
+     * @param shouldStop - Checked between chunks. Return true to give up.
+     * @return True if a steady beat was found.
+     */
+    static bool analyse(juce::AudioFormatReader& reader, BeatGrid& beatGrid, const std::function<bool()>& shouldStop);
+
+private:
+    /** The onset envelopes of a track. */
+    struct OnsetEnvelopes
+    {
+        std::vector<float> coarse;  // One frame per coarseHop samples
+        std::vector<float> fine;    // One frame per fineHop samples
+        int coarseHop{ 0 };
+    };
+
+    /** Where beats line up when an envelope is folded at a beat period. */
+    struct BeatAlignment
+    {
+        double phase{ 0 };      // Frames from the start of the envelope to the first beat
+        float strength{ 0 };    // How much stronger the onsets are on the beat than on average
+    };
+
+    /**
+     * Decodes a track into its onset envelopes.
+     *
+     * @param reader     - The reader for the track.
+     * @param envelopes  - The envelopes to fill in.
+     * @param shouldStop - Checked between chunks. Return true to give up.
+     * @return True if the whole track was read.
+     */
+    static bool readOnsetEnvelopes(juce::AudioFormatReader& reader,
+                                   OnsetEnvelopes& envelopes,
+                                   const std::function<bool()>& shouldStop);
+
+    /**
+     * Removes the slowly changing level from an envelope, leaving its peaks.
+     *
+     * @param envelope       - The envelope.
+     * @param windowInFrames - The width of the window the level is averaged over.
+     */
+    static void removeLocalMean(std::vector<float>& envelope, int windowInFrames);
+
+    /**
+     * Estimates the beat period from the autocorrelation of an envelope.
+     *
+     * @param envelope        - The coarse onset envelope.
+     * @param framesPerSecond - The envelope's frame rate.
+     * @return The beat period in frames, or 0 if the track is too short.
+     */
+    static double findBeatPeriod(const std::vector<float>& envelope, double framesPerSecond);
+
+    /**
+     * Finds the period, close to an estimate, at which the onsets line up
+     * best across the whole envelope.
+     *
+     * @param envelope - The onset envelope.
+     * @param period   - The estimated beat period, in frames.
+     * @param range    - How far either side of the estimate to search, in frames.
+     * @param step     - The distance between periods tried, in frames.
+     * @return The refined beat period, in frames.
+     */
+    static double refineBeatPeriod(const std::vector<float>& envelope, double period, double range, double step);
+
+    /**
+     * Folds an envelope at a beat period, and finds the phase where the
+     * onsets line up.
+     *
+     * @param envelope    - The onset envelope.
+     * @param period      - The beat period, in frames.
+     * @param searchStart - The earliest phase to look at, in frames.
+     * @param searchEnd   - The latest phase to look at, in frames. Phases
+     *     wrap around the period.
+     * @return The phase of the beats and how strongly they line up.
+     */
+    static BeatAlignment alignBeats(const std::vector<float>& envelope, double period,
+                                    double searchStart, double searchEnd);
+
+    // Shared format manager, and reader factory for the tracks
+    juce::AudioFormatManager& formatManager;
+    AudioFileReaderFactory readerFactory{ formatManager };
+
+    // Range of tempos to look for
+    static constexpr double minBpm{ 70.0 };
+    static constexpr double maxBpm{ 200.0 };
+    // Tempo that ambiguous tracks lean towards, and how widely, in octaves.
+    // Centred high and wide, so 170-180 BPM tracks beat their half tempo
+    // without 70-100 BPM tracks being doubled.
+    static constexpr double preferredBpm{ 150.0 };
+    static constexpr double tempoPriorWidth{ 1.5 };
+    // Number of multiples of the beat period the comb filter checks
+    static constexpr int combHarmonics{ 4 };
+    // Samples per frame of the fine envelope, and the coarse envelope's
+    // approximate frame rate. Coarse frames are a whole number of fine ones.
+    static constexpr int fineHop{ 32 };
+    static constexpr double coarseFramesPerSecond{ 200.0 };
+    // Cutoff of the bass band in the coarse envelope, in Hz
+    static constexpr double bassCutoff{ 150.0 };
+    // Scales energy before it is compressed, so quiet onsets still count
+    static constexpr float energyCompression{ 100.0f };
+    // Samples read from the track at a time
+    static constexpr int chunkSize{ 65536 };
+    // Shortest track with enough beats to analyse, in seconds
+    static constexpr double minTrackSeconds{ 10.0 };
+    // Least strength a beat must line up with to count as a steady beat
+    static constexpr float minBeatStrength{ 1.5f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatAnalyser)
+};
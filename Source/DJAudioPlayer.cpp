@@ -1,8 +1,10 @@
 #include "DJAudioPlayer.h"
+#include "MusicTrack.h"
 
 
-DJAudioPlayer::DJAudioPlayer(juce::AudioFormatManager& _formatManager)
-    : formatManager{ _formatManager }
+DJAudioPlayer::DJAudioPlayer(juce::AudioFormatManager& _formatManager, DecodedTrackCache& _trackCache)
+    : formatManager{ _formatManager },
+      trackCache{ _trackCache }
 {
 }
 DJAudioPlayer::~DJAudioPlayer()
@@ -11,48 +13,108 @@ DJAudioPlayer::~DJAudioPlayer()
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
 {
-    // Get the sample rate
+    // Get the sample rate, and the block size for preparing new tracks
     sampleRate = _sampleRate;
-    // Prepare the transport source
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    // Pprepare the resample source, for playback speed control
-    resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    expectedBlockSize.store(samplesPerBlockExpected);
+    // Prepare the time stretcher, for key lock
+    timeStretcher.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // Clear any audio left in the deck processor from before
+    deckProcessor.reset();
+
+    // Set the ramp lengths for the new sample rate
+    smoothedGain.reset(sampleRate, gainRampSeconds);
+    smoothedSpeed.reset(sampleRate, speedRampSeconds);
+    smoothedPlayGain.reset(sampleRate, playRampSeconds);
+    for (ShelfSmoother* smoother : { &lowShelfSmoother, &highShelfSmoother })
+    {
+        smoother->frequency.reset(sampleRate, shelfRampSeconds);
+        smoother->gain.reset(sampleRate, shelfRampSeconds);
+        smoother->q.reset(sampleRate, shelfRampSeconds);
+        smoother->active = false;
+    }
+
+    // Recalculate any filter coefficients already set for the new sample rate
+    if (lowShelf.frequency.load() > 0)
+    {
+        lowShelf.changed.store(true, std::memory_order_release);
+    }
+    if (highShelf.frequency.load() > 0)
+    {
+        highShelf.changed.store(true, std::memory_order_release);
+    }
 }
 
 void DJAudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    resampleSource.getNextAudioBlock(bufferToFill);
+    // Pick up any changes the user has made since the last block
+    applyPendingParameters();
+
+    // Output silence if there's no track, or the deck has finished fading out
+    if (currentTrack == nullptr 
+        || (!smoothedPlayGain.isSmoothing() && smoothedPlayGain.getTargetValue() == 0))
+    {
+        bufferToFill.clearActiveBufferRegion();
+        smoothedGain.skip(bufferToFill.numSamples);
+        smoothedSpeed.skip(bufferToFill.numSamples);
+        return;
+    }
+
+    bool shelfRamping = lowShelfSmoother.frequency.isSmoothing() 
+        || lowShelfSmoother.gain.isSmoothing() || lowShelfSmoother.q.isSmoothing()
+        || highShelfSmoother.frequency.isSmoothing() 
+        || highShelfSmoother.gain.isSmoothing() || highShelfSmoother.q.isSmoothing();
+
+    if (!shelfRamping)
+    {
+        // The filters aren't changing, so render the whole block in one pass,
+        // with the speed and gain ramped per sample
+        renderBlock(bufferToFill);
+    }
+    else
+    {
+        // Render in short sub-blocks, updating the filters between them
+        for (int offset = 0; offset < bufferToFill.numSamples; offset += smoothingBlockSize)
+        {
+            int numSamples = juce::jmin(smoothingBlockSize, bufferToFill.numSamples - offset);
+
+            advanceShelf(lowShelfSmoother, DeckProcessor::lowShelf, numSamples, 
+                         &juce::IIRCoefficients::makeLowShelf);
+            advanceShelf(highShelfSmoother, DeckProcessor::highShelf, numSamples, 
+                         &juce::IIRCoefficients::makeHighShelf);
+
+            renderBlock({ bufferToFill.buffer, bufferToFill.startSample + offset, numSamples });
+        }
+    }
+
+    // Publish the playhead for the GUI, and stop at the end of the track
+    juce::int64 position = currentTrack->source->getNextReadPosition();
+    bool playing = smoothedPlayGain.getTargetValue() > 0;
+    if (position >= currentTrack->source->getTotalLength() && !currentTrack->source->isLooping())
+    {
+        playRequested.store(false, std::memory_order_relaxed);
+        playing = false;
+    }
+    publishPlayhead(position, playing ? smoothedSpeed.getCurrentValue() * currentTrack->sampleRate / 1000.0 : 0.0);
 }
 
 void DJAudioPlayer::releaseResources()
 {
-    // Release resources for both source objects
-    transportSource.releaseResources();
-    resampleSource.releaseResources();
+    // Release resources for the time stretcher, and clear the deck processor
+    timeStretcher.releaseResources();
+    deckProcessor.reset();
 }
 
-// Creates JUCE audio source objects for the file 
-void DJAudioPlayer::loadURL(const juce::URL& audioURL)
+// Opens the file on the loader's background thread. The audio thread
+// swaps it in at the start of a block.
+void DJAudioPlayer::loadURL(const juce::URL& audioURL, DeckLoader::ReadyCallback onReady)
 {
-    // Convert audioURL to an input stream and create an AudioFormatReader for it
-    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
-    // Check that the file converted correctly
-    if (reader != nullptr)
-    {
-        // Dynamically create an AudioFormatReaderSource based on the reader
-        std::unique_ptr<juce::AudioFormatReaderSource> newSource
-            { new juce::AudioFormatReaderSource(reader, true) };
+    loader.load(audioURL, loadMode == LoadMode::decodeToMemory, 
+                expectedBlockSize.load(), std::move(onReady));
+}
 
-        // Wrap in a TransportSource 
-        transportSource.setSource(newSource.get(), 0, 
-                                  nullptr, reader->sampleRate);
-        // Move the AudioFormatReaderSource object to the readerSource pointer
-        readerSource.reset(newSource.release());
-    }
-    else
-    {
-        DBG("Something went wrong loading the file.");
-    }
+void DJAudioPlayer::setLoadMode(LoadMode mode)
+{
+    loadMode = mode;
 }
 
 void DJAudioPlayer::setGain(double gain)
@@ -64,7 +126,8 @@ void DJAudioPlayer::setGain(double gain)
     }
     else
     {
-        transportSource.setGain(gain);
+        // Applied by the audio thread at the start of the next block
+        targetGain.store(static_cast<float>(gain), std::memory_order_relaxed);
     }
 }
 
@@ -77,14 +140,15 @@ void DJAudioPlayer::setSpeed(double ratio)
     }
     else
     {
-        resampleSource.setResamplingRatio(ratio);
+        // Applied by the audio thread at the start of the next block
+        targetSpeed.store(ratio, std::memory_order_relaxed);
     }
 }
 
 void DJAudioPlayer::setPosition(double positionInSeconds)
 {
-    // Update the position of the playhead 
-    transportSource.setPosition(positionInSeconds);
+    // Ask the audio thread to move the playhead at the next block
+    pendingPosition.store(juce::jmax(0.0, positionInSeconds), std::memory_order_release);
 }
 
 void DJAudioPlayer::setPositionRelative(double relativePosition)
@@ -97,8 +161,7 @@ void DJAudioPlayer::setPositionRelative(double relativePosition)
     else
     {
         // Convert relative position to actual position in seconds
-        double positionInSeconds = transportSource.getLengthInSeconds() 
-                                   * (relativePosition / 100);
+        double positionInSeconds = getLengthInSeconds() * (relativePosition / 100);
         // Update the position
         setPosition(positionInSeconds);
     }
@@ -106,34 +169,48 @@ void DJAudioPlayer::setPositionRelative(double relativePosition)
 
 void DJAudioPlayer::setLowShelf(double frequency, float gain, double q)
 {
-    // Set the coefficients for the filter
-    juce::IIRCoefficients lowShelfCoefficients = juce::IIRCoefficients::makeLowShelf(sampleRate, frequency, q, gain);
-    // Update the filtered audio source with the coefficients
-    lowShelfFilteredSource.setCoefficients(lowShelfCoefficients);
+    // The coefficients are calculated by the audio thread
+    publishShelf(lowShelf, frequency, gain, q);
 }
 
 void DJAudioPlayer::setHighShelf(double frequency, float gain, double q)
 {
-    // Set the coefficients for the filter
-    juce::IIRCoefficients highShelfCoefficients = juce::IIRCoefficients::makeHighShelf(sampleRate, frequency, q, gain);
-    // Update the filtered audio source with the coefficients
-    highShelfFilteredSource.setCoefficients(highShelfCoefficients);
+    // The coefficients are calculated by the audio thread
+    publishShelf(highShelf, frequency, gain, q);
+}
+
+void DJAudioPlayer::setKeyLock(bool shouldLockKey)
+{
+    // Applied by the audio thread at the start of the next block
+    keyLockEnabled.store(shouldLockKey, std::memory_order_relaxed);
+}
+
+void DJAudioPlayer::setKeyLockQuality(TimeStretcher::Quality quality)
+{
+    // Applied by the audio thread at the start of the next block
+    keyLockQuality.store(static_cast<int>(quality), std::memory_order_relaxed);
+}
+
+void DJAudioPlayer::setResamplingQuality(DeckProcessor::Interpolation quality)
+{
+    // Applied by the audio thread at the start of the next block
+    resamplingQuality.store(static_cast<int>(quality), std::memory_order_relaxed);
 }
 
 void DJAudioPlayer::start()
 {
-    transportSource.start();                    //  Begin playback
+    playRequested.store(true);                  //  Begin playback
 }
 
 void DJAudioPlayer::pause()
 {
-    transportSource.stop();                     // Pause playback
+    playRequested.store(false);                 // Pause playback
 }
 
 void DJAudioPlayer::stop()
 {
-    transportSource.stop();                     // Pause playback
-    transportSource.setNextReadPosition(0);     // Reset position to 0
+    playRequested.store(false);                 // Pause playback
+    setPosition(0);                             // Reset position to 0
 }
 
 // Returns the relative position into the track, or 0 if no track is loaded.
@@ -143,24 +220,266 @@ double DJAudioPlayer::getPositionRelative()
     double position{};  // Default is 0
 
     // If a track is loaded and playing, get position
-    if (transportSource.getLengthInSeconds() != 0)
+    juce::int64 length = trackLength.load(std::memory_order_relaxed);
+    if (length != 0)
     {
         // Calculate relative position as a proportion of total track length
-        position = transportSource.getCurrentPosition() / 
-                    transportSource.getLengthInSeconds();
+        position = static_cast<double>(playheadPosition.load(std::memory_order_relaxed)) / length;
     }
     return position;
 }
 
+double DJAudioPlayer::getPositionInSeconds() const
+{
+    // The playhead is counted in samples at the file's rate
+    double rate = sourceSampleRate.load(std::memory_order_relaxed);
+    return rate > 0 ? playheadPosition.load(std::memory_order_relaxed) / rate : 0;
+}
+
+// Reads the published playhead with a sequence lock: if the sequence
+// changed while reading, the audio thread was writing, so it reads again.
+DJAudioPlayer::PlayheadPosition DJAudioPlayer::getPlayheadPosition(double timeMs) const
+{
+    juce::int64 position;
+    double publishedTimeMs;
+    double samplesPerMs;
+    for (;;)
+    {
+        juce::uint32 sequence = playheadSequence.load(std::memory_order_acquire);
+        position = playheadPosition.load(std::memory_order_relaxed);
+        publishedTimeMs = playheadTimeMs.load(std::memory_order_relaxed);
+        samplesPerMs = playheadSamplesPerMs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((sequence & 1) == 0 && sequence == playheadSequence.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    PlayheadPosition playhead;
+    double rate = sourceSampleRate.load(std::memory_order_relaxed);
+    juce::int64 length = trackLength.load(std::memory_order_relaxed);
+    if (rate <= 0 || length <= 0)
+    {
+        return playhead;
+    }
+
+    // Move the position on by the time since it was published
+    double elapsedMs = juce::jlimit(0.0, maxExtrapolationMs, timeMs - publishedTimeMs);
+    double samples = juce::jlimit(0.0, static_cast<double>(length), position + elapsedMs * samplesPerMs);
+    playhead.seconds = samples / rate;
+    playhead.relative = samples / length;
+    return playhead;
+}
+
 std::string DJAudioPlayer::getTrackLength()
 {
-    // Get the total seconds of the track
-    int lengthInSeconds = round(transportSource.getLengthInSeconds());
+    // Format the total seconds of the track
+    return MusicTrack::formatLength(getLengthInSeconds());
+}
+
+double DJAudioPlayer::getLengthInSeconds() const
+{
+    // The track's length is counted in samples at the file's rate
+    double rate = sourceSampleRate.load(std::memory_order_relaxed);
+    return rate > 0 ? trackLength.load(std::memory_order_relaxed) / rate : 0;
+}
+
+void DJAudioPlayer::publishShelf(ShelfParameters& shelf, double frequency, float gain, double q)
+{
+    // Write the values before raising the flag, so the audio thread sees
+    // them all once it sees the flag. If it reads part way through an
+    // update, the flag is raised again and the next block corrects it.
+    shelf.frequency.store(frequency, std::memory_order_relaxed);
+    shelf.gain.store(gain, std::memory_order_relaxed);
+    shelf.q.store(q, std::memory_order_relaxed);
+    shelf.changed.store(true, std::memory_order_release);
+}
+
+void DJAudioPlayer::publishPlayhead(juce::int64 position, double samplesPerMs)
+{
+    // Make the sequence odd while writing, then even again when done
+    juce::uint32 sequence = playheadSequence.load(std::memory_order_relaxed);
+    playheadSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    playheadPosition.store(position, std::memory_order_relaxed);
+    playheadTimeMs.store(juce::Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
+    playheadSamplesPerMs.store(samplesPerMs, std::memory_order_relaxed);
+    playheadSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void DJAudioPlayer::applyPendingParameters()
+{
+    // Swap in a newly loaded track, handing the old one back to be deleted.
+    // Loading a track stops the deck, so a track that's still playing is
+    // faded out over the play ramp first, and swapped once it's silent.
+    if (loader.hasLoadedTrack())
+    {
+        playRequested.store(false);
+        if (currentTrack == nullptr || smoothedPlayGain.getCurrentValue() == 0)
+        {
+            if (LoadedTrack* incoming = loader.takeLoadedTrack())
+            {
+                loader.retireTrack(currentTrack.release(), incoming->generation);
+                currentTrack.reset(incoming);
+                trackInput.source = incoming->source.get();
+
+                // Publish the new track's details for the GUI
+                sourceSampleRate.store(incoming->sampleRate, std::memory_order_relaxed);
+                trackLength.store(incoming->source->getTotalLength(), std::memory_order_relaxed);
+                publishPlayhead(0, 0.0);
+
+                smoothedPlayGain.setCurrentAndTargetValue(0.0f);
+                timeStretcher.reset();
+                deckProcessor.reset();
+            }
+        }
+    }
+
+    // Fade in or out when playback is started or paused
+    smoothedPlayGain.setTargetValue(playRequested.load() ? 1.0f : 0.0f);
+
+    // Ramp towards the latest gain and speed
+    smoothedGain.setTargetValue(targetGain.load(std::memory_order_relaxed));
+    smoothedSpeed.setTargetValue(targetSpeed.load(std::memory_order_relaxed));
 
-    // Convert to minutes and seconds
-    int secondsLong = lengthInSeconds % 60;
-    int minutesLong = (int)(lengthInSeconds / 60);
+    // Jump to a new position if one was requested
+    double position = pendingPosition.exchange(-1.0, std::memory_order_acquire);
+    if (position >= 0 && currentTrack != nullptr)
+    {
+        juce::int64 newPosition = static_cast<juce::int64>(position * currentTrack->sampleRate);
+        currentTrack->source->setNextReadPosition(newPosition);
+        publishPlayhead(newPosition, 0.0);
+        // Don't blend audio from before the jump into the new position
+        timeStretcher.reset();
+        deckProcessor.reset();
+    }
+
+    // Switch key lock on or off. The stretcher is restarted, so it doesn't
+    // play audio buffered from before it was last used.
+    bool keyLock = keyLockEnabled.load(std::memory_order_relaxed);
+    if (keyLock != keyLockActive)
+    {
+        keyLockActive = keyLock;
+        timeStretcher.reset();
+        deckProcessor.reset();
+    }
+    timeStretcher.setQuality(static_cast<TimeStretcher::Quality>(keyLockQuality.load(std::memory_order_relaxed)));
+
+    // Switch the resampler's interpolation
+    deckProcessor.setInterpolation(static_cast<DeckProcessor::Interpolation>(
+        resamplingQuality.load(std::memory_order_relaxed)));
 
-    // Return a formatted string
-    return std::to_string(minutesLong) + "m " + std::to_string(secondsLong) + "s";
+    // Coefficients can only be calculated once the sample rate is known
+    if (sampleRate <= 0)
+    {
+        return;
+    }
+
+    // Pick up the shelf filter settings if they have changed
+    applyPendingShelf(lowShelf, lowShelfSmoother, DeckProcessor::lowShelf, 
+                      &juce::IIRCoefficients::makeLowShelf);
+    applyPendingShelf(highShelf, highShelfSmoother, DeckProcessor::highShelf, 
+                      &juce::IIRCoefficients::makeHighShelf);
+}
+
+void DJAudioPlayer::renderBlock(const juce::AudioSourceChannelInfo& block)
+{
+    // Step the speed and gain ramps across the block. The gain includes the
+    // fade for starting and pausing.
+    double startSpeed = smoothedSpeed.getCurrentValue();
+    double endSpeed = smoothedSpeed.skip(block.numSamples);
+    float startGain = smoothedGain.getCurrentValue() * smoothedPlayGain.getCurrentValue();
+    float endGain = smoothedGain.skip(block.numSamples) * smoothedPlayGain.skip(block.numSamples);
+
+    // The resampler converts from the file's rate to the device's as well
+    double sourceRate = currentTrack->sampleRate;
+    double rateRatio = sourceRate > 0 && sampleRate > 0 ? sourceRate / sampleRate : 1.0;
+
+    if (keyLockActive)
+    {
+        // The stretcher changes the tempo, so the resampler only converts
+        // the rate and the pitch stays the same
+        timeStretcher.setTempo(endSpeed);
+        deckProcessor.process(timeStretcher, block, rateRatio, rateRatio, startGain, endGain);
+    }
+    else
+    {
+        // Resampling changes the tempo and pitch together
+        deckProcessor.process(trackInput, block, startSpeed * rateRatio, endSpeed * rateRatio, 
+                              startGain, endGain);
+    }
+}
+
+void DJAudioPlayer::applyPendingShelf(ShelfParameters& shelf, 
+                                      ShelfSmoother& smoother,
+                                      DeckProcessor::Filter filter,
+                                      juce::IIRCoefficients (*makeCoefficients)(double, double, double, float))
+{
+    if (!shelf.changed.exchange(false, std::memory_order_acquire))
+    {
+        return;
+    }
+
+    double frequency = shelf.frequency.load(std::memory_order_relaxed);
+    // Gain is ramped multiplicatively, so it must stay above 0
+    float gain = juce::jmax(0.001f, shelf.gain.load(std::memory_order_relaxed));
+    double q = shelf.q.load(std::memory_order_relaxed);
+
+    if (smoother.active)
+    {
+        // Ramp towards the new settings. The coefficients follow in getNextAudioBlock
+        smoother.frequency.setTargetValue(frequency);
+        smoother.gain.setTargetValue(gain);
+        smoother.q.setTargetValue(q);
+    }
+    else
+    {
+        // First settings since the player was prepared, so apply them straight away
+        smoother.frequency.setCurrentAndTargetValue(frequency);
+        smoother.gain.setCurrentAndTargetValue(gain);
+        smoother.q.setCurrentAndTargetValue(q);
+        smoother.active = true;
+
+        deckProcessor.setFilterCoefficients(filter, makeCoefficients(sampleRate, frequency, q, gain));
+    }
+}
+
+void DJAudioPlayer::advanceShelf(ShelfSmoother& smoother,
+                                 DeckProcessor::Filter filter,
+                                 int numSamples,
+                                 juce::IIRCoefficients (*makeCoefficients)(double, double, double, float))
+{
+    // Leave the coefficients alone once the ramp has finished
+    if (!smoother.frequency.isSmoothing() && !smoother.gain.isSmoothing() && !smoother.q.isSmoothing())
+    {
+        return;
+    }
+
+    // Step to where the ramp will be at the end of the sub-block
+    double frequency = smoother.frequency.skip(numSamples);
+    float gain = smoother.gain.skip(numSamples);
+    double q = smoother.q.skip(numSamples);
+
+    deckProcessor.setFilterCoefficients(filter, makeCoefficients(sampleRate, frequency, q, gain));
+}
+
+void DJAudioPlayer::TrackInput::prepareToPlay(int, double)
+{
+}
+
+void DJAudioPlayer::TrackInput::releaseResources()
+{
+}
+
+void DJAudioPlayer::TrackInput::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (source != nullptr)
+    {
+        source->getNextAudioBlock(bufferToFill);
+    }
+    else
+    {
+        bufferToFill.clearActiveBufferRegion();
+    }
 }
\ No newline at end of file
@@ -1,17 +1,51 @@
 #pragma once
 
+#include <atomic>
 #include <JuceHeader.h>
+#include "DecodedTrackCache.h"
+#include "DeckLoader.h"
+#include "DeckProcessor.h"
+#include "TimeStretcher.h"
 
+/**
+ * Plays an audio file with speed, gain and shelf filter controls.
+ *
+ * The setters are called from the message thread, but do not touch the
+ * audio sources directly. They publish the new values through atomics,
+ * and the audio thread applies them at the start of its next block, so
+ * neither thread ever waits on the other.
+ *
+ * Gain, speed and shelf changes are ramped rather than stepped, to avoid
+ * zipper noise and clicks. Gain and speed are ramped per sample across the
+ * block. While a shelf is ramping, the block is rendered in short sub-blocks,
+ * with the filter coefficients updated between them.
+ *
+ * With key lock on, the speed changes the tempo through a time stretcher
+ * instead of resampling, so the pitch stays the same.
+ *
+ * Tracks are decoded into the shared decoded track cache when loaded, or
+ * streamed through a read-ahead buffer if they don't fit, so the audio 
+ * thread never reads from disk. Tracks are opened on a background thread
+ * and swapped in by the audio thread at the start of a block.
+ */
 class DJAudioPlayer : public juce::AudioSource
 {
 public:
+    /** How tracks are loaded for playback. */
+    enum class LoadMode
+    {
+        decodeToMemory,     // Decode the whole track into the track cache
+        stream              // Read and decode on a background thread during playback
+    };
+
     /** 
      * Constructor
      *
      * @param _formatManager - Reference to the shared audio format manager
      *      for the app. Used to create the audio source for the player.
+     * @param _trackCache    - Reference to the shared decoded track cache.
      */
-    DJAudioPlayer(juce::AudioFormatManager& _formatManager);
+    DJAudioPlayer(juce::AudioFormatManager& _formatManager, DecodedTrackCache& _trackCache);
 
     /** 
      * Destructor 
@@ -41,11 +75,23 @@ public:
     void releaseResources() override;
 
     /** 
-     * Loads an audio file as an audio source. 
+     * Loads an audio file as an audio source, in the background. The deck
+     * keeps playing its current track until the new one is ready, then
+     * stops.
      * 
      * @param audioURL - The URL of the audio file being loaded.
+     * @param onReady  - Called on the message thread once the track has
+     *     replaced the current one, or if it couldn't be loaded.
+     */
+    void loadURL(const juce::URL& audioURL, DeckLoader::ReadyCallback onReady = nullptr);
+
+    /**
+     * Sets how tracks are loaded. Takes effect from the next track loaded.
+     * Tracks too large for the track cache are always streamed.
+     *
+     * @param mode - The load mode.
      */
-    void loadURL(const juce::URL& audioURL);
+    void setLoadMode(LoadMode mode);
 
     /**
      * Sets the gain (volume) of the audio source.
@@ -62,7 +108,8 @@ public:
     void setSpeed(double ratio);
 
     /**
-     * Sets the position in the audio source playback.
+     * Sets the position in the audio source playback. The playhead moves
+     * at the start of the next audio block.
      *
      * @param positionInSeconds - The number of seconds into the playback to jump to.
      */
@@ -93,6 +140,30 @@ public:
      */
     void setHighShelf(double frequency, float gain, double q);
 
+    /**
+     * Turns key lock on or off. With key lock on, speed changes the tempo 
+     * without changing the pitch.
+     *
+     * @param shouldLockKey - True to turn key lock on.
+     */
+    void setKeyLock(bool shouldLockKey);
+
+    /**
+     * Sets the quality of the time stretching used for key lock. Higher
+     * qualities use more CPU.
+     *
+     * @param quality - The time stretching quality.
+     */
+    void setKeyLockQuality(TimeStretcher::Quality quality);
+
+    /**
+     * Sets how the player resamples for speed changes and for files at a
+     * different sample rate to the output. Higher qualities use more CPU.
+     *
+     * @param quality - The interpolation to resample with.
+     */
+    void setResamplingQuality(DeckProcessor::Interpolation quality);
+
     /** 
      * Starts playback on the audio source. 
      */
@@ -104,7 +175,8 @@ public:
     void pause();
 
     /** 
-     * Stops and resets playback on the audio source. 
+     * Stops and resets playback on the audio source. The playhead returns
+     * to the start at the next audio block.
      */
     void stop();
 
@@ -116,6 +188,31 @@ public:
      */
     double getPositionRelative();
 
+    /**
+     * Returns the position of the playhead in the track.
+     *
+     * @return - The position in seconds, or 0 if no track is loaded
+     */
+    double getPositionInSeconds() const;
+
+    /** The playhead position at a moment in time. */
+    struct PlayheadPosition
+    {
+        double seconds{ 0 };    // Position in the track, in seconds
+        double relative{ 0 };   // Position as a proportion of the track length
+    };
+
+    /**
+     * Gets where the playhead is at a given time, for drawing. The audio
+     * thread publishes the position and playback rate after each block, and
+     * the position is extrapolated from that to the time asked for, so it
+     * moves smoothly between blocks.
+     *
+     * @param timeMs - The time, on the Time::getMillisecondCounterHiRes() clock.
+     * @return The playhead position at that time.
+     */
+    PlayheadPosition getPlayheadPosition(double timeMs) const;
+
     /** 
      * Gets the source's track length and formats it as a string of 
      * minutes and seconds. 
@@ -125,20 +222,177 @@ public:
     std::string getTrackLength();
 
 private:
+    /** 
+     * Passes audio from the current track to the deck processor and time
+     * stretcher, so they needn't change when the track does.
+     */
+    class TrackInput : public juce::AudioSource
+    {
+    public:
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+        // Source of the current track, set by the audio thread
+        juce::PositionableAudioSource* source{ nullptr };
+    };
+
+    /** Shelf filter settings, published by the message thread. */
+    struct ShelfParameters
+    {
+        std::atomic<double> frequency{ 0 };
+        std::atomic<float> gain{ 1.0f };
+        std::atomic<double> q{ 1.0 };
+        // Set once all the values above are written, cleared by the audio thread
+        std::atomic<bool> changed{ false };
+    };
+
+    /** Shelf filter settings, ramped by the audio thread. */
+    struct ShelfSmoother
+    {
+        juce::SmoothedValue<double, juce::ValueSmoothingTypes::Multiplicative> frequency;
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> gain;
+        juce::SmoothedValue<double> q;
+        // False until the shelf is first set, so the first setting isn't ramped
+        bool active{ false };
+    };
+
+    /**
+     * Publishes new shelf filter settings for the audio thread.
+     *
+     * @param shelf     - The shelf parameters to update.
+     * @param frequency - The cutoff frequency.
+     * @param gain      - The amount to attenuate.
+     * @param q         - The Q value.
+     */
+    static void publishShelf(ShelfParameters& shelf, double frequency, float gain, double q);
+
+    /**
+     * Applies any parameters published since the last audio block. Only
+     * called on the audio thread, at the start of getNextAudioBlock.
+     */
+    void applyPendingParameters();
+
+    /**
+     * Publishes the playhead for the GUI. Called on the audio thread.
+     *
+     * @param position     - The playhead position, in samples of the track.
+     * @param samplesPerMs - How fast the playhead is moving.
+     */
+    void publishPlayhead(juce::int64 position, double samplesPerMs);
+
+    /**
+     * Gets the length of the loaded track.
+     *
+     * @return The length in seconds, or 0 if no track is loaded.
+     */
+    double getLengthInSeconds() const;
+
+    /**
+     * Renders a block through the deck processor, stepping the speed and 
+     * gain ramps across it. Only called on the audio thread.
+     *
+     * @param block - The section of the output buffer to fill.
+     */
+    void renderBlock(const juce::AudioSourceChannelInfo& block);
+
+    /**
+     * Picks up new shelf filter settings, if any were published. The first
+     * settings are applied straight away, later ones are ramped towards.
+     *
+     * @param shelf    - The published shelf parameters.
+     * @param smoother - The audio thread's ramping state for the shelf.
+     * @param filter   - The deck processor filter for the shelf.
+     * @param makeCoefficients - Function for the shelf's filter coefficients.
+     */
+    void applyPendingShelf(ShelfParameters& shelf, 
+                           ShelfSmoother& smoother,
+                           DeckProcessor::Filter filter,
+                           juce::IIRCoefficients (*makeCoefficients)(double, double, double, float));
+
+    /**
+     * Steps a ramping shelf filter forward and recalculates its coefficients.
+     *
+     * @param smoother   - The audio thread's ramping state for the shelf.
+     * @param filter     - The deck processor filter for the shelf.
+     * @param numSamples - The number of samples to step forward.
+     * @param makeCoefficients - Function for the shelf's filter coefficients.
+     */
+    void advanceShelf(ShelfSmoother& smoother,
+                      DeckProcessor::Filter filter,
+                      int numSamples,
+                      juce::IIRCoefficients (*makeCoefficients)(double, double, double, float));
+
     // Shared format manager
     juce::AudioFormatManager& formatManager;
+    // Shared cache of decoded tracks
+    DecodedTrackCache& trackCache;
+    // How tracks are loaded
+    LoadMode loadMode{ LoadMode::decodeToMemory };
 
-    // Audio source object 
-    // Uses smart pointer for dynamic instantiation
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-    // Transport wrapper for the audio source, to control playback
-    juce::AudioTransportSource transportSource;
-    // Filter wrappers for the audio source, to enable filtering frequencies
-    juce::IIRFilterAudioSource lowShelfFilteredSource {&transportSource, false};
-    juce::IIRFilterAudioSource highShelfFilteredSource {&lowShelfFilteredSource, false};
-    // Resampling wrapper for the audio source, to control speed
-    juce::ResamplingAudioSource resampleSource{ &highShelfFilteredSource, false, 2 };
+    // Opens tracks in the background
+    DeckLoader loader{ formatManager, trackCache };
+    // The track being played. Only changed by the audio thread.
+    std::unique_ptr<LoadedTrack> currentTrack;
+    // Input from the current track
+    TrackInput trackInput;
+    // Tempo control without pitch change, for key lock
+    TimeStretcher timeStretcher{ &trackInput };
+    // Speed and sample rate conversion, shelf filters and gain for the track's output
+    DeckProcessor deckProcessor;
 
     // The audio source's sample rate
     double sampleRate { 0 };
+    // Block size to prepare new tracks for
+    std::atomic<int> expectedBlockSize{ 512 };
+
+    /*------------- Track State for the GUI ------------*/
+    // The sample rate and length of the loaded file, published by the 
+    // audio thread
+    std::atomic<double> sourceSampleRate{ 0 };
+    std::atomic<juce::int64> trackLength{ 0 };
+    // The playhead position in samples, when it was published, and how fast
+    // it was moving. Written together under playheadSequence, which is odd
+    // while they are being written.
+    std::atomic<juce::uint32> playheadSequence{ 0 };
+    std::atomic<juce::int64> playheadPosition{ 0 };
+    std::atomic<double> playheadTimeMs{ 0 };
+    std::atomic<double> playheadSamplesPerMs{ 0 };
+    // The furthest the playhead is extrapolated past its last published
+    // position, so it stops promptly if the audio thread does
+    static constexpr double maxExtrapolationMs{ 100.0 };
+
+    /*------------- Parameters for the audio thread ------------*/
+    // Whether the deck should be playing
+    std::atomic<bool> playRequested{ false };
+    // Gain and speed ratio last set by the user
+    std::atomic<float> targetGain{ 1.0f };
+    std::atomic<double> targetSpeed{ 1.0 };
+    // Position to jump to in seconds, or negative if no jump is waiting
+    std::atomic<double> pendingPosition{ -1.0 };
+    // Key lock setting and time stretching quality last set by the user
+    std::atomic<bool> keyLockEnabled{ false };
+    std::atomic<int> keyLockQuality{ static_cast<int>(TimeStretcher::Quality::medium) };
+    // Resampler interpolation last set by the user
+    std::atomic<int> resamplingQuality{ static_cast<int>(DeckProcessor::Interpolation::sinc) };
+    // Shelf filter settings last set by the user
+    ShelfParameters lowShelf;
+    ShelfParameters highShelf;
+
+    /*------------- Parameter Smoothing ------------*/
+    // Ramp times, in seconds
+    static constexpr double gainRampSeconds{ 0.02 };
+    static constexpr double speedRampSeconds{ 0.05 };
+    static constexpr double shelfRampSeconds{ 0.02 };
+    static constexpr double playRampSeconds{ 0.005 };
+    // Number of samples rendered between filter updates while ramping
+    static constexpr int smoothingBlockSize{ 32 };
+    // Ramping state, only used on the audio thread
+    juce::SmoothedValue<float> smoothedGain{ 1.0f };
+    juce::SmoothedValue<double> smoothedSpeed{ 1.0 };
+    juce::SmoothedValue<float> smoothedPlayGain{ 0.0f };
+    ShelfSmoother lowShelfSmoother;
+    ShelfSmoother highShelfSmoother;
+    // Whether the audio thread is playing through the time stretcher
+    bool keyLockActive{ false };
 };
\ No newline at end of file
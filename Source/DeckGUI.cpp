@@ -3,9 +3,11 @@
 
 
 DeckGUI::DeckGUI(DJAudioPlayer* _player,
+                 MixerBus::Channel* _mixerChannel,
                  juce::AudioFormatManager& formatManagerToUse,
                  juce::AudioThumbnailCache& cacheToUse) 
     : player { _player },
+      mixerChannel { _mixerChannel },
       waveformDisplay {          
         formatManagerToUse,   // AudioFormatManager: to pass to AudioThumbnail
         cacheToUse }          // AudioThumbnailCache: to pass to AudioThumbnail
@@ -30,12 +32,17 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     addAndMakeVisible(volumeControls);
     addAndMakeVisible(volumeSlider);
     addAndMakeVisible(volumeSliderLabel);
+    addAndMakeVisible(trimSlider);
+    addAndMakeVisible(trimSliderLabel);
+    addAndMakeVisible(crossfaderSideBox);
     addAndMakeVisible(turntableDisplay);
     addAndMakeVisible(frequencyControls);
     addAndMakeVisible(frequencyShelfFilter);
     addAndMakeVisible(playbackControls);
     addAndMakeVisible(speedSlider);
     addAndMakeVisible(speedSliderLabel);
+    addAndMakeVisible(keyLockButton);
+    addAndMakeVisible(cueButton);
     addAndMakeVisible(positionSlider);
     addAndMakeVisible(positionSliderLabel);
     addAndMakeVisible(waveformDisplay);
@@ -47,18 +54,17 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     playButton.addListener(this);
     pauseButton.addListener(this);
     stopButton.addListener(this);
+    keyLockButton.addListener(this);
+    cueButton.addListener(this);
     volumeSlider.addListener(this);
+    trimSlider.addListener(this);
+    crossfaderSideBox.addListener(this);
     speedSlider.addListener(this);
     positionSlider.addListener(this);
-
-    // Start the timer to coordinate audio playback with waveform and turntable displays
-    startTimer(100);
 }
 
 DeckGUI::~DeckGUI()
 {
-    // Stop the timer from continuing
-    stopTimer();
     // Remove this component's look and feel
     setLookAndFeel(nullptr);
 }
@@ -107,9 +113,15 @@ void DeckGUI::resized()
     playButton.setBounds(startStopControlsArea.removeFromLeft(startStopButtonWidth).reduced(startStopButtonMargin));
     pauseButton.setBounds(startStopControlsArea.removeFromLeft(startStopButtonWidth).reduced(startStopButtonMargin));
     stopButton.setBounds(startStopControlsArea.removeFromLeft(startStopButtonWidth).reduced(startStopButtonMargin));
-    // Volume controls
+    // Volume controls: volume, trim and crossfader side
     auto volumeLabelWidth = 60;
+    auto trimLabelWidth = 40;
+    auto crossfaderSideBoxWidth = 70;
     volumeSliderLabel.setBounds(volumeControlsArea.removeFromLeft(volumeLabelWidth));
+    crossfaderSideBox.setBounds(volumeControlsArea.removeFromRight(crossfaderSideBoxWidth).reduced(2));
+    auto trimArea = volumeControlsArea.removeFromRight(volumeControlsArea.getWidth() / 3);
+    trimSliderLabel.setBounds(trimArea.removeFromLeft(trimLabelWidth));
+    trimSlider.setBounds(trimArea);
     volumeSlider.setBounds(volumeControlsArea);
     // Frequency control sliders
     frequencyShelfFilter.setBounds(frequencyControlsArea.reduced(5));
@@ -117,25 +129,49 @@ void DeckGUI::resized()
     auto playbackSliderHeight = playbackControlsArea.getHeight() / 2;
     auto playbackLabelWidth = 50;
     auto playbackSliderMargin = 10;
+    auto keyLockButtonWidth = 90;
+    auto cueButtonWidth = 70;
     auto speedSliderArea = playbackControlsArea.removeFromTop(playbackSliderHeight);
     auto positionSliderArea = playbackControlsArea.removeFromTop(playbackSliderHeight);
     positionSliderLabel.setBounds(positionSliderArea.removeFromLeft(playbackLabelWidth));
     speedSliderLabel.setBounds(speedSliderArea.removeFromLeft(playbackLabelWidth));
+    keyLockButton.setBounds(speedSliderArea.removeFromRight(keyLockButtonWidth).reduced(playbackSliderMargin, 0));
+    cueButton.setBounds(positionSliderArea.removeFromRight(cueButtonWidth).reduced(playbackSliderMargin, 0));
     positionSlider.setBounds(positionSliderArea.reduced(playbackSliderMargin));
     speedSlider.setBounds(speedSliderArea.reduced(playbackSliderMargin));
 }
 
 void DeckGUI::loadURL(const juce::URL& audioURL, const juce::String& fileName)
 {
-    // Load the URL with the player (audio source)
-    player->loadURL(audioURL);
-    // Load the URL with the waveform display (audio thumbnail)
-    waveformDisplay.loadURL(audioURL);
-
-    // Set the track title for the deck
-    trackTitle.setText(fileName, juce::dontSendNotification);
-    // Reset position slider
-    positionSlider.setValue(0, juce::dontSendNotification);
+    // Show the track is loading. The current track keeps playing until
+    // the new one is ready.
+    trackTitle.setText("Loading " + fileName + "...", juce::dontSendNotification);
+
+    // Load the URL with the player (audio source), in the background
+    juce::Component::SafePointer<DeckGUI> safeThis{ this };
+    player->loadURL(audioURL, [safeThis, audioURL, fileName](bool loaded)
+    {
+        // The deck may have been closed while the track was loading
+        if (safeThis == nullptr)
+        {
+            return;
+        }
+
+        if (loaded)
+        {
+            // Set the track title for the deck
+            safeThis->trackTitle.setText(fileName, juce::dontSendNotification);
+            // Reset position slider
+            safeThis->positionSlider.setValue(0, juce::dontSendNotification);
+            // Load the URL with the waveform display (audio thumbnail), 
+            // now that the track is the one playing
+            safeThis->waveformDisplay.loadURL(audioURL);
+        }
+        else
+        {
+            safeThis->trackTitle.setText("Couldn't load " + fileName, juce::dontSendNotification);
+        }
+    });
 }
 
 void DeckGUI::buttonClicked(juce::Button* button)
@@ -154,15 +190,30 @@ void DeckGUI::buttonClicked(juce::Button* button)
         // beginning of track
         player->stop();     
     }
+    if (button == &keyLockButton)   // Key Lock toggle
+    {
+        // Keep the pitch steady when the speed changes
+        player->setKeyLock(keyLockButton.getToggleState());
+    }
+    if (button == &cueButton)       // Cue toggle
+    {
+        // Send the deck to the headphones
+        mixerChannel->setCue(cueButton.getToggleState());
+    }
 }
 
 void DeckGUI::sliderValueChanged(juce::Slider* slider)
 {
     if (slider == &volumeSlider)    // Volume slider
     {
-        // Set playback gain (volume) from the slider value
-        player->setGain(slider->getValue());
+        // Set the deck's mixer fader from the slider value
+        mixerChannel->setFader(static_cast<float>(slider->getValue()));
     } 
+    if (slider == &trimSlider)      // Trim slider
+    {
+        // Set the deck's mixer trim, in decibels
+        mixerChannel->setTrim(static_cast<float>(slider->getValue()));
+    }
     if (slider == &speedSlider)     // Speed slider
     {
         // Set playback speed from the slider value
@@ -179,6 +230,16 @@ void DeckGUI::sliderValueChanged(juce::Slider* slider)
     }
 }
 
+void DeckGUI::comboBoxChanged(juce::ComboBox* comboBox)
+{
+    if (comboBox == &crossfaderSideBox)     // Crossfader side
+    {
+        // Item IDs are the crossfader sides, offset by 1
+        auto side = static_cast<MixerBus::CrossfaderSide>(comboBox->getSelectedId() - 1);
+        mixerChannel->setCrossfaderSide(side);
+    }
+}
+
 bool DeckGUI::isInterestedInFileDrag(const juce::StringArray& files)
 {
     return true;
@@ -198,14 +259,19 @@ void DeckGUI::filesDropped(const juce::StringArray& files, int x, int y)
     }
 }
 
-// Called at interval and coordinates playback with the waveform and
-// turntable displays
-void DeckGUI::timerCallback()
+// Called once per frame by the display refresh driver, and coordinates 
+// playback with the waveform and turntable displays. The playhead is read
+// once, so both displays show the same position.
+void DeckGUI::refreshDisplay(double frameTimeMs)
 {
+    DJAudioPlayer::PlayheadPosition playhead = player->getPlayheadPosition(frameTimeMs);
+
     // Update the relative position of the waveform display
-    waveformDisplay.setPositionRelative(player->getPositionRelative());
+    waveformDisplay.setPositionRelative(playhead.relative);
     // Update the relative position of the turntable display
-    turntableDisplay.setPositionRelative(player->getPositionRelative());
+    turntableDisplay.setPositionRelative(playhead.relative);
+    // Spin the turntable's platter
+    turntableDisplay.setPositionInSeconds(playhead.seconds);
 }
 
 // Button images are free stock images licensed under the MIT license, 
@@ -245,6 +311,8 @@ void DeckGUI::setUpSliders()
     // Attach slider labels
     volumeSliderLabel.setText("Volume", juce::dontSendNotification);
     volumeSliderLabel.attachToComponent(&volumeSlider, true);
+    trimSliderLabel.setText("Trim", juce::dontSendNotification);
+    trimSliderLabel.attachToComponent(&trimSlider, true);
     speedSliderLabel.setText("Speed", juce::dontSendNotification);
     speedSliderLabel.attachToComponent(&speedSlider, true);
     positionSliderLabel.setText("Position", juce::dontSendNotification);
@@ -258,11 +326,25 @@ void DeckGUI::setUpSliders()
 
     // Restrict slider ranges
     volumeSlider.setRange(0.0, 1.0);
+    trimSlider.setRange(-12.0, 12.0, 0.1);
     speedSlider.setRange(0.0, 2.0, 0.01);
     positionSlider.setRange(0.0, 100.0, 0.01);
 
     // Set initial slider values
     volumeSlider.setValue(0.7, juce::dontSendNotification);
+    trimSlider.setValue(0, juce::dontSendNotification);
+    trimSlider.setDoubleClickReturnValue(true, 0);
+
+    // Start the mixer channel at the volume shown
+    mixerChannel->setFader(static_cast<float>(volumeSlider.getValue()));
+
+    // Crossfader side choices, showing the side the deck's channel is on.
+    // Item IDs are the crossfader sides, offset by 1, as IDs can't be 0.
+    crossfaderSideBox.addItem("A", static_cast<int>(MixerBus::CrossfaderSide::left) + 1);
+    crossfaderSideBox.addItem("Thru", static_cast<int>(MixerBus::CrossfaderSide::through) + 1);
+    crossfaderSideBox.addItem("B", static_cast<int>(MixerBus::CrossfaderSide::right) + 1);
+    crossfaderSideBox.setSelectedId(static_cast<int>(mixerChannel->getCrossfaderSide()) + 1,
+                                    juce::dontSendNotification);
     speedSlider.setValue(1.0, juce::dontSendNotification);
     positionSlider.setValue(0, juce::dontSendNotification);
 }
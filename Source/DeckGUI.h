@@ -3,22 +3,28 @@
 #include <JuceHeader.h>
 #include "MainLookAndFeel.h"
 #include "DJAudioPlayer.h"
+#include "MixerBus.h"
 #include "WaveformDisplay.h"
 #include "FrequencyShelfFilter.h"
 #include "TurntableDisplay.h"
+#include "DisplayRefreshDriver.h"
 
 
 class DeckGUI  : public juce::Component,
                  public juce::Button::Listener,
                  public juce::Slider::Listener,
+                 public juce::ComboBox::Listener,
                  public juce::FileDragAndDropTarget,
-                 public juce::Timer
+                 public DisplayRefreshDriver::Client
 {
 public:
     /** 
      * Constructor 
      *
      * @param player             - A pointer to the player for the deck.
+     * @param mixerChannel       - A pointer to the deck's channel on the mixer,
+     *                             for the volume, trim, crossfader and cue
+     *                             controls.
      * @param formatManagerToUse - Reference to the shared audio format manager
      *                             for the app, to pass on to child components 
      *                             that need it.
@@ -27,6 +33,7 @@ public:
      *                             need it.
      */
     DeckGUI(DJAudioPlayer* player,
+            MixerBus::Channel* mixerChannel,
             juce::AudioFormatManager& formatManagerToUse,
             juce::AudioThumbnailCache& cacheToUse);
 
@@ -50,7 +57,8 @@ public:
     void resized() override;
 
     /**
-     * Loads an audio URL to the deck's player.
+     * Loads an audio URL to the deck's player in the background. The title
+     * shows the track is loading until the player has swapped it in.
      *
      * @param audioURL - The URL of the audio file being loaded.
      * @param fileName - The file name of the audio file being loaded.
@@ -72,6 +80,13 @@ private:
      */
     void sliderValueChanged(juce::Slider* slider) override;
 
+    /**
+     * Implements ComboBox::Listener: Processes combo box selections.
+     *
+     * @param comboBox - The combo box whose selection changed.
+     */
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
+
     /** 
      * Implements FileDragAndDrop: Callback called repeatedly while user
      * is dragging files.
@@ -90,10 +105,13 @@ private:
     void filesDropped(const juce::StringArray& files, int x, int y) override;
 
     /** 
-     * Implements Timer. Processes the timer callback to update the display 
-     * on Waveform and Turntable components.
+     * Implements DisplayRefreshDriver::Client. Updates the display on the
+     * Waveform and Turntable components once per frame, from the playhead
+     * position at the frame time.
+     *
+     * @param frameTimeMs - The time of the frame.
      */
-    void timerCallback() override;
+    void refreshDisplay(double frameTimeMs) override;
 
     /** 
      * Loads images for GUI buttons. 
@@ -103,12 +121,14 @@ private:
     void setUpButtonImages();
 
     /** 
-     * Initializes slider labels and ranges. 
+     * Initializes slider labels and ranges, and the crossfader side choices. 
      */
     void setUpSliders();
 
     // Pointer to the audio player for the deck
     DJAudioPlayer* player;
+    // Pointer to the deck's channel on the mixer
+    MixerBus::Channel* mixerChannel;
     // Location of images for GUI buttons
     juce::File buttonImageDirectory{ 
         juce::File::getCurrentWorkingDirectory().getChildFile("button-images")};
@@ -128,6 +148,10 @@ private:
     juce::Slider volumeSlider{ juce::Slider::SliderStyle::LinearHorizontal,
                                juce::Slider::TextEntryBoxPosition::NoTextBox };
     juce::Label volumeSliderLabel;
+    juce::Slider trimSlider{ juce::Slider::SliderStyle::LinearHorizontal,
+                             juce::Slider::TextEntryBoxPosition::NoTextBox };
+    juce::Label trimSliderLabel;
+    juce::ComboBox crossfaderSideBox;
     // Turntable display 
     TurntableDisplay turntableDisplay;
     // Frequency shelf sliders block
@@ -137,6 +161,8 @@ private:
     juce::GroupComponent playbackControls;
     juce::Slider speedSlider;
     juce::Label speedSliderLabel;
+    juce::ToggleButton keyLockButton{ "Key Lock" };
+    juce::ToggleButton cueButton{ "Cue" };
     juce::Slider positionSlider;
     juce::Label positionSliderLabel;
     // Waveform display component
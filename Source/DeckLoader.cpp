@@ -0,0 +1,146 @@
+#include <JuceHeader.h>
+#include "DeckLoader.h"
+
+
+DeckLoader::DeckLoader(juce::AudioFormatManager& _formatManager, DecodedTrackCache& _trackCache)
+    : formatManager{ _formatManager },
+      trackCache{ _trackCache }
+{
+}
+
+DeckLoader::~DeckLoader()
+{
+    stopTimer();
+
+    // Wait for any track being opened, then delete the tracks still held here
+    loadPool.removeAllJobs(true, 10000);
+    delete pendingTrack.exchange(nullptr);
+    delete retiredTrack.exchange(nullptr);
+}
+
+void DeckLoader::load(const juce::URL& audioURL, bool decodeToMemory, int blockSize, ReadyCallback onReady)
+{
+    // Newer requests replace older ones. A load already running finishes,
+    // but its track is thrown away.
+    int generation = ++requestedGeneration;
+    readyCallback = std::move(onReady);
+    loadPool.removeAllJobs(false, 0);
+    delete pendingTrack.exchange(nullptr, std::memory_order_acq_rel);
+    loadPool.addJob([this, audioURL, decodeToMemory, blockSize, generation] 
+    { 
+        openTrack(audioURL, decodeToMemory, blockSize, generation); 
+    });
+
+    // Watch for the audio thread picking the track up
+    startTimerHz(30);
+}
+
+bool DeckLoader::hasLoadedTrack() const
+{
+    return pendingTrack.load(std::memory_order_acquire) != nullptr;
+}
+
+LoadedTrack* DeckLoader::takeLoadedTrack()
+{
+    // Only one retired track is held at a time, so wait for the last one
+    // to be deleted before swapping again
+    if (retiredTrack.load(std::memory_order_acquire) != nullptr)
+    {
+        return nullptr;
+    }
+    LoadedTrack* track = pendingTrack.exchange(nullptr, std::memory_order_acq_rel);
+
+    // A track can be posted just after a newer load was requested. Drop it
+    // rather than play it, and leave it for the message thread to delete.
+    if (track != nullptr && track->generation != requestedGeneration.load(std::memory_order_acquire))
+    {
+        retiredTrack.store(track, std::memory_order_release);
+        return nullptr;
+    }
+    return track;
+}
+
+void DeckLoader::retireTrack(LoadedTrack* track, int newGeneration)
+{
+    retiredTrack.store(track, std::memory_order_release);
+    playingGeneration.store(newGeneration, std::memory_order_release);
+}
+
+void DeckLoader::timerCallback()
+{
+    // Delete the track the audio thread has finished with
+    delete retiredTrack.exchange(nullptr, std::memory_order_acquire);
+
+    // Tell the caller once the latest track is playing, or has failed
+    int requested = requestedGeneration.load();
+    if (readyCallback != nullptr)
+    {
+        bool loaded = playingGeneration.load(std::memory_order_acquire) == requested;
+        bool failed = failedGeneration.load() == requested;
+        if (loaded || failed)
+        {
+            ReadyCallback callback = std::move(readyCallback);
+            readyCallback = nullptr;
+            callback(loaded);
+        }
+    }
+
+    // Stop checking once there's nothing left to do
+    if (readyCallback == nullptr && retiredTrack.load() == nullptr && pendingTrack.load() == nullptr)
+    {
+        stopTimer();
+    }
+}
+
+void DeckLoader::openTrack(const juce::URL& audioURL, bool decodeToMemory, int blockSize, int generation)
+{
+    // Skip requests that have already been replaced
+    if (generation != requestedGeneration.load())
+    {
+        return;
+    }
+
+    auto track = std::make_unique<LoadedTrack>();
+    track->generation = generation;
+
+    // Play from memory if the track can be decoded into the cache
+    if (decodeToMemory && audioURL.isLocalFile())
+    {
+        if (auto decoded = trackCache.getTrack(audioURL.getLocalFile()))
+        {
+            track->sampleRate = decoded->sampleRate;
+            track->source = std::make_unique<DecodedTrackSource>(std::move(decoded));
+        }
+    }
+
+    // Otherwise stream from the file, reading ahead on a background thread
+    if (track->source == nullptr)
+    {
+        // Create an AudioFormatReader for the file, memory-mapped if it's uncompressed
+        std::unique_ptr<juce::AudioFormatReader> reader = readerFactory.createReaderFor(audioURL);
+        // Check that the file converted correctly
+        if (reader == nullptr)
+        {
+            DBG("Something went wrong loading the file.");
+            failedGeneration.store(generation);
+            return;
+        }
+        track->sampleRate = reader->sampleRate;
+        track->source = std::make_unique<juce::BufferingAudioSource>(
+            new juce::AudioFormatReaderSource(reader.release(), true),
+            trackCache.getReadAheadThread(), true, readAheadSamples, 2);
+    }
+
+    // Prepare the source here, so a streamed track's buffer is filled
+    // before it starts playing
+    track->source->prepareToPlay(blockSize, track->sampleRate);
+
+    // Post the track for the audio thread, unless it's been replaced since.
+    // A newer load can still be requested after this check, so the audio
+    // thread checks the generation again when it takes the track. A track
+    // posted earlier that the audio thread never picked up is deleted.
+    if (generation == requestedGeneration.load())
+    {
+        delete pendingTrack.exchange(track.release(), std::memory_order_acq_rel);
+    }
+}
\ No newline at end of file
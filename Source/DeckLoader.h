@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <JuceHeader.h>
+#include "AudioFileReaderFactory.h"
+#include "DecodedTrackCache.h"
+
+
+/** A track opened and prepared for playback, ready to hand to the audio thread. */
+struct LoadedTrack
+{
+    // The audio to play, either a cached track or a buffered file reader
+    std::unique_ptr<juce::PositionableAudioSource> source;
+    // The sample rate of the track
+    double sampleRate{ 0 };
+    // Which load request the track is for
+    int generation{ 0 };
+};
+
+
+/**
+ * Opens tracks for a deck on a background thread, so loading never blocks
+ * the message thread or the audio thread.
+ *
+ * The loader decodes or opens the file, prepares it, and then posts it for
+ * the audio thread to pick up at the start of a block. The track it replaces
+ * is handed back and deleted on the message thread, where the caller is also
+ * told the new track is ready.
+ */
+class DeckLoader : private juce::Timer
+{
+public:
+    /** Called on the message thread with whether the track was loaded. */
+    using ReadyCallback = std::function<void(bool loaded)>;
+
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app. Used to open tracks to stream.
+     * @param _trackCache    - Reference to the shared decoded track cache.
+     */
+    DeckLoader(juce::AudioFormatManager& _formatManager, DecodedTrackCache& _trackCache);
+
+    /** Destructor. Waits for any load in progress to finish. */
+    ~DeckLoader();
+
+    /**
+     * Starts loading a track in the background. Replaces any load still in
+     * progress. Call on the message thread.
+     *
+     * @param audioURL        - The URL of the audio file to load.
+     * @param decodeToMemory  - True to decode the track into the track cache,
+     *     false to stream it from disk.
+     * @param blockSize       - The expected audio block size.
+     * @param onReady         - Called when the audio thread has picked up the
+     *     track, or if it couldn't be loaded.
+     */
+    void load(const juce::URL& audioURL, bool decodeToMemory, int blockSize, ReadyCallback onReady);
+
+    /**
+     * Checks whether a loaded track is waiting to be taken. Call on the
+     * audio thread.
+     *
+     * @return True if takeLoadedTrack() may return a track.
+     */
+    bool hasLoadedTrack() const;
+
+    /**
+     * Takes the most recently loaded track, if there is one waiting. Call on
+     * the audio thread, and hand the track it replaces to retireTrack().
+     *
+     * @return The new track, or nullptr if there isn't one, it's for a load
+     *     that has since been replaced, or the last track retired hasn't
+     *     been deleted yet.
+     */
+    LoadedTrack* takeLoadedTrack();
+
+    /**
+     * Hands back a track the audio thread has finished with, to be deleted
+     * on the message thread. Call on the audio thread, straight after
+     * takeLoadedTrack() returns a track.
+     *
+     * @param track        - The track to delete. May be nullptr.
+     * @param newGeneration - The generation of the track that replaced it.
+     */
+    void retireTrack(LoadedTrack* track, int newGeneration);
+
+private:
+    /**
+     * Implements Timer: Deletes retired tracks and calls the ready callback.
+     */
+    void timerCallback() override;
+
+    /**
+     * Opens and prepares a track. Runs on the loader thread.
+     *
+     * @param audioURL       - The URL of the audio file to load.
+     * @param decodeToMemory - True to decode the track into the track cache.
+     * @param blockSize      - The expected audio block size.
+     * @param generation     - Which load request this is.
+     */
+    void openTrack(const juce::URL& audioURL, bool decodeToMemory, int blockSize, int generation);
+
+    // Shared format manager and track cache
+    juce::AudioFormatManager& formatManager;
+    DecodedTrackCache& trackCache;
+    // Opens streamed tracks, mapping them into memory where possible
+    AudioFileReaderFactory readerFactory{ formatManager };
+
+    // Track waiting for the audio thread to pick up
+    std::atomic<LoadedTrack*> pendingTrack{ nullptr };
+    // Track the audio thread has finished with, waiting to be deleted
+    std::atomic<LoadedTrack*> retiredTrack{ nullptr };
+
+    // The latest load request, the last one picked up by the audio thread,
+    // and the last one that failed
+    std::atomic<int> requestedGeneration{ 0 };
+    std::atomic<int> playingGeneration{ 0 };
+    std::atomic<int> failedGeneration{ 0 };
+    // Callback for the latest load request
+    ReadyCallback readyCallback;
+
+    // Samples buffered ahead of playback when streaming
+    static constexpr int readAheadSamples{ 96000 };
+
+    // Background thread for opening tracks. Declared last, so it is
+    // destroyed first, while the members its jobs use are still alive.
+    juce::ThreadPool loadPool{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckLoader)
+};
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <JuceHeader.h>
+#include "DeckManager.h"
+
+
+DeckManager::DeckManager(juce::AudioFormatManager& _formatManager,
+                         DecodedTrackCache& _trackCache,
+                         juce::AudioThumbnailCache& _thumbCache)
+    : formatManager{ _formatManager },
+      trackCache{ _trackCache },
+      thumbCache{ _thumbCache }
+{
+}
+
+DeckManager::~DeckManager()
+{
+    stopTimer();
+
+    // The audio device has stopped, so nothing is using the decks
+    delete activeDecks.exchange(nullptr);
+    retired.clear();
+    deckGUIs.clear();
+    decks.clear();
+}
+
+void DeckManager::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
+{
+    const juce::ScopedLock lock{ decksLock };
+
+    // Remember the settings for decks added later
+    prepared = true;
+    blockSize = samplesPerBlockExpected;
+    sampleRate = _sampleRate;
+
+    // Prepare the mixer, then every deck and its mixer channel
+    mixer.prepareToPlay(blockSize, sampleRate);
+    for (const std::unique_ptr<Deck>& deck : decks)
+    {
+        prepareDeck(*deck);
+    }
+}
+
+void DeckManager::releaseResources()
+{
+    const juce::ScopedLock lock{ decksLock };
+
+    prepared = false;
+    for (const std::unique_ptr<Deck>& deck : decks)
+    {
+        deck->player->releaseResources();
+        deck->mixerChannel.getInputBuffer().setSize(0, 0);
+    }
+    mixer.releaseResources();
+}
+
+// Blocks longer than the prepared size are rendered in pieces, so the
+// render buffers never need to grow on the audio thread
+void DeckManager::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const std::vector<Deck*>* deckList = activeDecks.load(std::memory_order_acquire);
+
+    if (deckList == nullptr || deckList->empty())
+    {
+        bufferToFill.clearActiveBufferRegion();
+    }
+    else
+    {
+        int maxChunk = juce::jmax(1, blockSize);
+        for (int offset = 0; offset < bufferToFill.numSamples; offset += maxChunk)
+        {
+            int numSamples = juce::jmin(maxChunk, bufferToFill.numSamples - offset);
+
+            // Render every deck into its own buffer, in parallel if the
+            // block is long enough to be worth it
+            renderingDecks = deckList;
+            renderingNumSamples = numSamples;
+            renderPool.run(*this, static_cast<int>(deckList->size()), numSamples >= minParallelBlockSize);
+
+            // Mix the decks into the output
+            for (size_t i = 0; i < deckList->size(); ++i)
+            {
+                mixerChannels[i] = &(*deckList)[i]->mixerChannel;
+            }
+            mixer.process(mixerChannels.data(), static_cast<int>(deckList->size()),
+                          { bufferToFill.buffer, bufferToFill.startSample + offset, numSamples });
+        }
+    }
+
+    // Let the message thread know this block no longer uses any old list
+    blocksRendered.fetch_add(1);
+}
+
+DeckGUI* DeckManager::addDeck()
+{
+    DeckGUI* deckGUI;
+    {
+        const juce::ScopedLock lock{ decksLock };
+        if (static_cast<int>(decks.size()) >= maxDecks)
+        {
+            return nullptr;
+        }
+
+        // Create the deck, and prepare it if the audio device is running.
+        // The audio thread can't see it yet, so this doesn't disturb playback.
+        auto deck = std::make_unique<Deck>();
+        deck->player = std::make_unique<DJAudioPlayer>(formatManager, trackCache);
+        if (prepared)
+        {
+            prepareDeck(*deck);
+        }
+
+        // Put decks on alternate sides of the crossfader, starting on the left
+        deck->mixerChannel.setCrossfaderSide(decks.size() % 2 == 0 ? MixerBus::CrossfaderSide::left
+                                                                   : MixerBus::CrossfaderSide::right);
+
+        // Create its GUI
+        deckGUI = deckGUIs.add(new DeckGUI{ deck->player.get(), &deck->mixerChannel, 
+                                            formatManager, thumbCache });
+        decks.push_back(std::move(deck));
+
+        // Hand the new list to the audio thread
+        publishDecks(nullptr);
+    }
+
+    listeners.call([deckGUI](Listener& l) { l.deckAdded(deckGUI); });
+    return deckGUI;
+}
+
+void DeckManager::removeDeck(int index)
+{
+    if (index < 0 || index >= getNumDecks())
+    {
+        return;
+    }
+
+    // Let listeners let go of the GUI, then delete it. Only the message
+    // thread uses it.
+    DeckGUI* deckGUI = deckGUIs[index];
+    listeners.call([deckGUI](Listener& l) { l.deckRemoved(deckGUI); });
+    deckGUIs.remove(index);
+
+    // Take the deck out of the list. The player is kept until the audio
+    // thread has finished with it.
+    const juce::ScopedLock lock{ decksLock };
+    std::unique_ptr<Deck> removedDeck = std::move(decks[static_cast<size_t>(index)]);
+    decks.erase(decks.begin() + index);
+    publishDecks(std::move(removedDeck));
+}
+
+int DeckManager::getNumDecks() const
+{
+    return static_cast<int>(decks.size());
+}
+
+DeckGUI* DeckManager::getDeckGUI(int index) const
+{
+    return deckGUIs[index];
+}
+
+DJAudioPlayer* DeckManager::getPlayer(int index) const
+{
+    if (index < 0 || index >= getNumDecks())
+    {
+        return nullptr;
+    }
+    return decks[static_cast<size_t>(index)]->player.get();
+}
+
+double DeckManager::getDeckLoad(int index) const
+{
+    if (index < 0 || index >= getNumDecks())
+    {
+        return 0;
+    }
+    return decks[static_cast<size_t>(index)]->loadMeasurer.getLoadAsProportion();
+}
+
+MixerBus& DeckManager::getMixer()
+{
+    return mixer;
+}
+
+void DeckManager::addListener(Listener* listener)
+{
+    listeners.add(listener);
+}
+
+void DeckManager::removeListener(Listener* listener)
+{
+    listeners.remove(listener);
+}
+
+// A block that started with an old list has finished once the block count
+// has moved on from when the list was replaced. If the device has stopped,
+// no block is using it.
+void DeckManager::timerCallback()
+{
+    juce::uint64 blockCount = blocksRendered.load();
+    bool audioRunning;
+    {
+        const juce::ScopedLock lock{ decksLock };
+        audioRunning = prepared;
+    }
+
+    retired.erase(std::remove_if(retired.begin(), retired.end(),
+        [blockCount, audioRunning](const Retired& r) 
+        { 
+            return !audioRunning || blockCount > r.blocksRenderedWhenRetired; 
+        }),
+        retired.end());
+
+    if (retired.empty())
+    {
+        stopTimer();
+    }
+}
+
+// Runs on the audio thread or a render worker. Each deck is only ever
+// rendered by one thread at a time.
+void DeckManager::runTask(int taskIndex)
+{
+    Deck* deck = (*renderingDecks)[static_cast<size_t>(taskIndex)];
+    juce::AudioProcessLoadMeasurer::ScopedTimer timer{ deck->loadMeasurer, renderingNumSamples };
+    deck->player->getNextAudioBlock({ &deck->mixerChannel.getInputBuffer(), 0, renderingNumSamples });
+}
+
+void DeckManager::prepareDeck(Deck& deck)
+{
+    deck.player->prepareToPlay(blockSize, sampleRate);
+    deck.loadMeasurer.reset(sampleRate, blockSize);
+    mixer.prepareChannel(deck.mixerChannel);
+}
+
+void DeckManager::publishDecks(std::unique_ptr<Deck> removedDeck)
+{
+    // Build the new list for the audio thread
+    auto deckList = std::make_unique<std::vector<Deck*>>();
+    for (const std::unique_ptr<Deck>& deck : decks)
+    {
+        deckList->push_back(deck.get());
+    }
+
+    // Swap it in, and keep the old list and removed deck until the audio
+    // thread is done with them
+    const std::vector<Deck*>* oldList = activeDecks.exchange(deckList.release());
+    retired.push_back({ std::unique_ptr<const std::vector<Deck*>>{ oldList }, 
+                        std::move(removedDeck), 
+                        blocksRendered.load() });
+    startTimerHz(30);
+}
\ No newline at end of file
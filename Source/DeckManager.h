@@ -0,0 +1,257 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "DecodedTrackCache.h"
+#include "DJAudioPlayer.h"
+#include "DeckGUI.h"
+#include "DeckRenderPool.h"
+#include "MixerBus.h"
+
+
+/**
+ * Owns the app's decks, each an audio player with its GUI, and mixes their
+ * output through the mixer bus. Decks can be added and removed at any
+ * time, without stopping or reopening the audio device.
+ *
+ * The audio thread reads the list of decks through an atomic pointer, so
+ * changing it never blocks playback. Removed decks are kept until the
+ * audio thread has finished a block without them, then deleted on the
+ * message thread.
+ *
+ * Decks are rendered in parallel on a pool of real-time workers, each into
+ * its mixer channel's preallocated buffer, and then mixed. Small blocks
+ * are rendered one deck after another on the audio thread, where sharing
+ * them out would cost more than it saves.
+ *
+ * The time each deck takes to render is measured, as a proportion of the
+ * time available for each block.
+ */
+class DeckManager : public juce::AudioSource,
+                    private juce::Timer,
+                    private DeckRenderPool::Job
+{
+public:
+    /**
+     * Receives notifications when decks are added or removed. All callbacks
+     * are made on the message thread.
+     */
+    class Listener
+    {
+    public:
+        /** Destructor */
+        virtual ~Listener() = default;
+
+        /**
+         * Called after a deck has been added.
+         *
+         * @param deckGUI - The new deck's GUI.
+         */
+        virtual void deckAdded(DeckGUI* deckGUI) = 0;
+
+        /**
+         * Called just before a deck is removed, while its GUI still exists.
+         *
+         * @param deckGUI - The GUI of the deck being removed.
+         */
+        virtual void deckRemoved(DeckGUI* deckGUI) = 0;
+    };
+
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app, for the decks to use.
+     * @param _trackCache    - Reference to the shared decoded track cache.
+     * @param _thumbCache    - Reference to the shared thumbnail cache.
+     */
+    DeckManager(juce::AudioFormatManager& _formatManager,
+                DecodedTrackCache& _trackCache,
+                juce::AudioThumbnailCache& _thumbCache);
+
+    /** Destructor. Call after the audio device has stopped. */
+    ~DeckManager() override;
+
+    /**
+     * Implements AudioSource: Prepares every deck to play.
+     *
+     * @param samplesPerBlockExpected - The expected block size.
+     * @param sampleRate - The sample rate of the output.
+     */
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+    /**
+     * Implements AudioSource: Releases every deck's resources.
+     */
+    void releaseResources() override;
+
+    /**
+     * Implements AudioSource: Mixes the output of every deck through the
+     * mixer bus.
+     *
+     * @param bufferToFill - The audio source buffer.
+     */
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    /**
+     * Adds a deck. Call on the message thread.
+     *
+     * @return The new deck's GUI, or nullptr if there are already maxDecks.
+     */
+    DeckGUI* addDeck();
+
+    /**
+     * Removes a deck. Call on the message thread.
+     *
+     * @param index - The index of the deck to remove.
+     */
+    void removeDeck(int index);
+
+    /**
+     * Gets the number of decks.
+     *
+     * @return The number of decks.
+     */
+    int getNumDecks() const;
+
+    /**
+     * Gets a deck's GUI.
+     *
+     * @param index - The index of the deck.
+     * @return The deck's GUI, or nullptr if there's no deck at the index.
+     */
+    DeckGUI* getDeckGUI(int index) const;
+
+    /**
+     * Gets a deck's audio player.
+     *
+     * @param index - The index of the deck.
+     * @return The deck's player, or nullptr if there's no deck at the index.
+     */
+    DJAudioPlayer* getPlayer(int index) const;
+
+    /**
+     * Gets how much of the audio thread's time a deck takes.
+     *
+     * @param index - The index of the deck.
+     * @return The deck's load, as a proportion of the time available for
+     *     each block, or 0 if there's no deck at the index.
+     */
+    double getDeckLoad(int index) const;
+
+    /**
+     * Gets the mixer the decks play through, for its crossfader.
+     *
+     * @return The mixer bus.
+     */
+    MixerBus& getMixer();
+
+    /**
+     * Registers a listener for deck notifications.
+     *
+     * @param listener - The listener to add.
+     */
+    void addListener(Listener* listener);
+
+    /**
+     * Deregisters a listener for deck notifications.
+     *
+     * @param listener - The listener to remove.
+     */
+    void removeListener(Listener* listener);
+
+    // The most decks there can be at once
+    static constexpr int maxDecks{ 8 };
+
+private:
+    /** A deck's audio, as seen by the audio thread. */
+    struct Deck
+    {
+        std::unique_ptr<DJAudioPlayer> player;
+        juce::AudioProcessLoadMeasurer loadMeasurer;
+        // The deck's channel on the mixer, which it renders into
+        MixerBus::Channel mixerChannel;
+    };
+
+    /** A list of decks the audio thread may still be using. */
+    struct Retired
+    {
+        std::unique_ptr<const std::vector<Deck*>> deckList;
+        std::unique_ptr<Deck> deck;
+        juce::uint64 blocksRenderedWhenRetired;
+    };
+
+    /**
+     * Implements Timer: Deletes retired decks once the audio thread has
+     * finished with them.
+     */
+    void timerCallback() override;
+
+    /**
+     * Implements DeckRenderPool::Job: Renders one deck's output for the
+     * current block into its render buffer.
+     *
+     * @param taskIndex - The index of the deck in the current list.
+     */
+    void runTask(int taskIndex) override;
+
+    /**
+     * Prepares a deck to play at the current settings. Call with the lock held.
+     *
+     * @param deck - The deck to prepare.
+     */
+    void prepareDeck(Deck& deck);
+
+    /**
+     * Publishes the current decks to the audio thread, retiring the last
+     * list published along with a removed deck, if there is one.
+     *
+     * @param removedDeck - The deck that was removed, if any.
+     */
+    void publishDecks(std::unique_ptr<Deck> removedDeck);
+
+    // Shared format manager and caches, for new decks
+    juce::AudioFormatManager& formatManager;
+    DecodedTrackCache& trackCache;
+    juce::AudioThumbnailCache& thumbCache;
+
+    // The decks and their GUIs, in order. Only used on the message thread.
+    std::vector<std::unique_ptr<Deck>> decks;
+    juce::OwnedArray<DeckGUI> deckGUIs;
+    // Lock protecting the deck list and the settings below from
+    // prepareToPlay() and releaseResources()
+    juce::CriticalSection decksLock;
+    // Whether the audio device is running, and its settings
+    bool prepared{ false };
+    int blockSize{ 0 };
+    double sampleRate{ 0 };
+
+    // The decks the audio thread mixes
+    std::atomic<const std::vector<Deck*>*> activeDecks{ nullptr };
+    // Blocks mixed so far, for telling when retired decks are safe to delete
+    std::atomic<juce::uint64> blocksRendered{ 0 };
+    // Decks and deck lists waiting to be deleted
+    std::vector<Retired> retired;
+    // Faders, crossfader and limiter between the decks and the output
+    MixerBus mixer;
+    // The decks and length of the block being rendered. Only used on the
+    // audio thread, and by the workers while it waits for them.
+    const std::vector<Deck*>* renderingDecks{ nullptr };
+    int renderingNumSamples{ 0 };
+    // The current decks' mixer channels. Only used on the audio thread.
+    std::array<MixerBus::Channel*, maxDecks> mixerChannels{};
+    // Blocks shorter than this are rendered on the audio thread alone
+    static constexpr int minParallelBlockSize{ 64 };
+    // Workers for rendering decks in parallel, one per spare CPU core, up
+    // to one fewer than the most decks. Each block wakes only one fewer
+    // than the number of decks playing, as the audio thread renders too.
+    DeckRenderPool renderPool{ juce::jlimit(0, maxDecks - 1, juce::SystemStats::getNumCpus() - 1) };
+
+    // Listeners for deck notifications
+    juce::ListenerList<Listener> listeners;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckManager)
+};
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <JuceHeader.h>
+#include "DeckProcessor.h"
+
+
+DeckProcessor::DeckProcessor()
+    : inputBuffer{ 2, static_cast<int>(maxOutputChunk * maxRatio) + historyLength + lookaheadLength + 2 }
+{
+    // Make sure the shared sinc tables are built here, not on the audio thread
+    SincTable::forRatio(1.0);
+
+    reset();
+}
+
+DeckProcessor::~DeckProcessor()
+{
+}
+
+void DeckProcessor::reset()
+{
+    // Forget the buffered input, leaving silence behind the playhead
+    inputBuffer.clear();
+    numBuffered = historyLength;
+    inputPosition = historyLength;
+
+    // Clear the filter history, keeping the coefficients
+    for (Biquad& filter : filters)
+    {
+        std::fill(std::begin(filter.s1), std::end(filter.s1), 0.0f);
+        std::fill(std::begin(filter.s2), std::end(filter.s2), 0.0f);
+    }
+}
+
+void DeckProcessor::setFilterCoefficients(Filter filter, const juce::IIRCoefficients& coefficients)
+{
+    // IIRCoefficients are already normalised by a0
+    Biquad& biquad = filters[filter];
+    std::copy(std::begin(coefficients.coefficients), std::end(coefficients.coefficients),
+              std::begin(biquad.c));
+
+    // A shelf at 0 dB has the same numerator as denominator, so it passes
+    // audio through unchanged and can be skipped once it stops ringing
+    const float tolerance = 1.0e-6f;
+    biquad.flat = std::abs(biquad.c[0] - 1.0f) < tolerance
+                  && std::abs(biquad.c[1] - biquad.c[3]) < tolerance
+                  && std::abs(biquad.c[2] - biquad.c[4]) < tolerance;
+}
+
+void DeckProcessor::setInterpolation(Interpolation _interpolation)
+{
+    interpolation = _interpolation;
+}
+
+void DeckProcessor::process(juce::AudioSource& input,
+                            const juce::AudioSourceChannelInfo& output,
+                            double startRatio,
+                            double endRatio,
+                            float startGain,
+                            float endGain)
+{
+    // Denormals in the filter feedback can be very slow on some CPUs
+    juce::ScopedNoDenormals noDenormals;
+
+    auto* buffer = output.buffer;
+    if (buffer->getNumChannels() == 0 || output.numSamples <= 0)
+    {
+        return;
+    }
+
+    // Keep the ratio in the range the input buffer is sized for
+    startRatio = juce::jlimit(0.0, maxRatio, startRatio);
+    endRatio = juce::jlimit(0.0, maxRatio, endRatio);
+
+    // Near a standstill the interpolators hold the last input sample, which
+    // comes out as DC. Fade the deck out as it slows below minRatio, so it
+    // is silent once stopped, the way the time stretcher goes quiet below
+    // its slowest tempo.
+    startGain *= static_cast<float>(juce::jmin(1.0, startRatio / minRatio));
+    endGain *= static_cast<float>(juce::jmin(1.0, endRatio / minRatio));
+
+    // How much the ratio and gain change per sample
+    double ratioStep = (endRatio - startRatio) / output.numSamples;
+    float gainStep = (endGain - startGain) / static_cast<float>(output.numSamples);
+
+    // Work through the block in chunks the input buffer can hold
+    for (int offset = 0; offset < output.numSamples; offset += maxOutputChunk)
+    {
+        int numSamples = juce::jmin(maxOutputChunk, output.numSamples - offset);
+        int startSample = output.startSample + offset;
+
+        float* left = buffer->getWritePointer(0, startSample);
+        float* right = buffer->getNumChannels() > 1 ? buffer->getWritePointer(1, startSample)
+                                                    : discardedChannel;
+
+        double chunkRatio = startRatio + ratioStep * offset;
+        float chunkGain = startGain + gainStep * offset;
+
+        switch (interpolation)
+        {
+            case Interpolation::linear:
+                processChunk(LinearInterpolator{}, input, left, right, numSamples,
+                             chunkRatio, ratioStep, chunkGain, gainStep);
+                break;
+            case Interpolation::cubic:
+                processChunk(CubicInterpolator{}, input, left, right, numSamples,
+                             chunkRatio, ratioStep, chunkGain, gainStep);
+                break;
+            case Interpolation::sinc:
+            default:
+            {
+                // Use a filter with a low enough cutoff for the fastest ratio in the chunk
+                double fastestRatio = juce::jmax(chunkRatio, chunkRatio + ratioStep * numSamples);
+                processChunk(SincInterpolator{ SincTable::forRatio(fastestRatio) }, input, 
+                             left, right, numSamples, chunkRatio, ratioStep, chunkGain, gainStep);
+                break;
+            }
+        }
+    }
+
+    // Silence any channels beyond the stereo pair
+    for (int channel = 2; channel < buffer->getNumChannels(); ++channel)
+    {
+        buffer->clear(channel, output.startSample, output.numSamples);
+    }
+}
+
+template <typename Interpolator>
+void DeckProcessor::processChunk(const Interpolator& interpolate,
+                                 juce::AudioSource& input,
+                                 float* left,
+                                 float* right,
+                                 int numSamples,
+                                 double ratio,
+                                 double ratioStep,
+                                 float gain,
+                                 float gainStep)
+{
+    // Read enough input to reach the last output sample of the chunk
+    double furthestRatio = juce::jmax(ratio, ratio + ratioStep * numSamples);
+    int numRequired = static_cast<int>(inputPosition + furthestRatio * numSamples) 
+                      + lookaheadLength + 1;
+    fillInput(input, numRequired);
+
+    const float* inputLeft = inputBuffer.getReadPointer(0);
+    const float* inputRight = inputBuffer.getReadPointer(1);
+
+    // Interpolate between the input samples around the playhead, straight
+    // into the output
+    double position = inputPosition;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        int index = static_cast<int>(position);
+        float fraction = static_cast<float>(position - index);
+        left[i] = interpolate(inputLeft, index, fraction);
+        right[i] = interpolate(inputRight, index, fraction);
+
+        // Step the playhead and speed ramp on to the next sample
+        position += ratio;
+        ratio += ratioStep;
+    }
+
+    // Filter and scale the chunk while it's still in the cache
+    for (Biquad& filter : filters)
+    {
+        if (!filter.isIdle())
+        {
+            applyFilter(filter, left, right, numSamples);
+        }
+    }
+    applyGain(left, right, numSamples, gain, gainStep);
+
+    // Drop the input samples the playhead has passed, keeping enough
+    // history behind it for the interpolator
+    int numConsumed = juce::jlimit(0, numBuffered, static_cast<int>(position) - historyLength);
+    int numRemaining = numBuffered - numConsumed;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* samples = inputBuffer.getWritePointer(channel);
+        std::memmove(samples, samples + numConsumed, sizeof(float) * static_cast<size_t>(numRemaining));
+    }
+    numBuffered = numRemaining;
+    inputPosition = position - numConsumed;
+}
+
+// The recursion runs one sample at a time, so the two channels are run
+// side by side instead, with the state copied into locals so the compiler
+// can keep it in registers.
+void DeckProcessor::applyFilter(Biquad& filter, float* left, float* right, int numSamples)
+{
+    const float b0 = filter.c[0], b1 = filter.c[1], b2 = filter.c[2];
+    const float a1 = filter.c[3], a2 = filter.c[4];
+    float s1[2] = { filter.s1[0], filter.s1[1] };
+    float s2[2] = { filter.s2[0], filter.s2[1] };
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float x[2] = { left[i], right[i] };
+        float y[2];
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            y[channel] = b0 * x[channel] + s1[channel];
+            s1[channel] = b1 * x[channel] - a1 * y[channel] + s2[channel];
+            s2[channel] = b2 * x[channel] - a2 * y[channel];
+        }
+        left[i] = y[0];
+        right[i] = y[1];
+    }
+
+    // Save the state for the next chunk. Once a flat filter's ringing has
+    // died away, its state is cleared so it can be skipped.
+    std::copy(std::begin(s1), std::end(s1), std::begin(filter.s1));
+    std::copy(std::begin(s2), std::end(s2), std::begin(filter.s2));
+    if (filter.flat && std::abs(s1[0]) < ringingThreshold && std::abs(s1[1]) < ringingThreshold
+        && std::abs(s2[0]) < ringingThreshold && std::abs(s2[1]) < ringingThreshold)
+    {
+        std::fill(std::begin(filter.s1), std::end(filter.s1), 0.0f);
+        std::fill(std::begin(filter.s2), std::end(filter.s2), 0.0f);
+    }
+}
+
+// A steady gain is one vectorised multiply per channel. A ramp is written
+// out once and then multiplied into both channels.
+void DeckProcessor::applyGain(float* left, float* right, int numSamples, float gain, float gainStep)
+{
+    if (gainStep == 0.0f)
+    {
+        if (gain != 1.0f)
+        {
+            juce::FloatVectorOperations::multiply(left, gain, numSamples);
+            juce::FloatVectorOperations::multiply(right, gain, numSamples);
+        }
+        return;
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        gainRamp[i] = gain + gainStep * static_cast<float>(i);
+    }
+    juce::FloatVectorOperations::multiply(left, gainRamp, numSamples);
+    juce::FloatVectorOperations::multiply(right, gainRamp, numSamples);
+}
+
+void DeckProcessor::fillInput(juce::AudioSource& input, int numRequired)
+{
+    if (numBuffered >= numRequired)
+    {
+        return;
+    }
+
+    // Append the missing samples after the ones already buffered
+    juce::AudioSourceChannelInfo info{ &inputBuffer, numBuffered, numRequired - numBuffered };
+    input.getNextAudioBlock(info);
+    numBuffered = numRequired;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Interpolators.h"
+
+
+/**
+ * The signal chain for one deck, run in a single pass over each block.
+ *
+ * Audio is pulled from an input source at the track's own rate, resampled
+ * to the output rate and playback speed, then put through a
+ * low shelf filter, a high shelf filter and the deck gain. The block is
+ * worked through in short chunks that stay in the CPU cache, and every
+ * stage runs over a chunk before the next chunk is started. The left and
+ * right channels are processed side by side, the filter state is kept in
+ * registers, and the gain is applied with vectorised multiplies. Filters
+ * set to a flat response are skipped.
+ *
+ * The resampler can be switched between linear, cubic and band-limited sinc
+ * interpolation while playing, trading fidelity for CPU.
+ */
+class DeckProcessor
+{
+public:
+    /** The filters in the chain. */
+    enum Filter
+    {
+        lowShelf,
+        highShelf,
+        numFilters
+    };
+
+    /** How the resampler interpolates between input samples. */
+    enum class Interpolation
+    {
+        linear,     // Cheapest, but aliases and dulls high frequencies
+        cubic,      // Catmull-Rom, a good default for small speed changes
+        sinc        // Band-limited, for large speed and sample rate changes
+    };
+
+    /** Constructor */
+    DeckProcessor();
+
+    /** Destructor */
+    ~DeckProcessor();
+
+    /**
+     * Clears the input samples buffered for interpolation and the filter
+     * history. Used after a jump in the input, so old audio isn't blended
+     * into the new.
+     */
+    void reset();
+
+    /**
+     * Sets the coefficients for one of the filters. Only call this on the
+     * audio thread, between calls to process().
+     *
+     * @param filter       - The filter to update.
+     * @param coefficients - The new filter coefficients.
+     */
+    void setFilterCoefficients(Filter filter, const juce::IIRCoefficients& coefficients);
+
+    /**
+     * Sets how the resampler interpolates. Only call this on the audio
+     * thread, between calls to process().
+     *
+     * @param _interpolation - The interpolation to use.
+     */
+    void setInterpolation(Interpolation _interpolation);
+
+    /**
+     * Fills a block of output by pulling audio from the input source and
+     * running it through the chain. The speed ratio and gain are ramped
+     * linearly across the block. Ratios below minRatio fade the output
+     * out, to silence at a ratio of 0.
+     *
+     * @param input      - The source to pull audio from.
+     * @param output     - The section of the output buffer to fill.
+     * @param startRatio - The number of input samples per output sample
+     *     at the start of the block.
+     * @param endRatio   - The ratio at the end of the block.
+     * @param startGain  - The gain at the start of the block.
+     * @param endGain    - The gain at the end of the block.
+     */
+    void process(juce::AudioSource& input,
+                 const juce::AudioSourceChannelInfo& output,
+                 double startRatio,
+                 double endRatio,
+                 float startGain,
+                 float endGain);
+
+private:
+    /** Coefficients and per-channel state for one biquad filter. */
+    struct Biquad
+    {
+        // Normalised coefficients, in the order b0, b1, b2, a1, a2
+        float c[5]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        // Transposed direct form II state for the left and right channels
+        float s1[2]{};
+        float s2[2]{};
+        // True if the coefficients pass audio through unchanged
+        bool flat{ true };
+
+        /** True if the filter is flat and has finished ringing, so it can be skipped. */
+        bool isIdle() const
+        {
+            return flat && s1[0] == 0 && s1[1] == 0 && s2[0] == 0 && s2[1] == 0;
+        }
+    };
+
+    /**
+     * Processes up to maxOutputChunk samples of output.
+     *
+     * @tparam Interpolator - The interpolator to resample with.
+     * @param interpolate   - The interpolator object.
+     * @param input      - The source to pull audio from.
+     * @param left       - Where to write the left channel output.
+     * @param right      - Where to write the right channel output.
+     * @param numSamples - The number of samples to write.
+     * @param ratio      - The speed ratio at the first sample.
+     * @param ratioStep  - The change in speed ratio per sample.
+     * @param gain       - The gain at the first sample.
+     * @param gainStep   - The change in gain per sample.
+     */
+    template <typename Interpolator>
+    void processChunk(const Interpolator& interpolate,
+                      juce::AudioSource& input,
+                      float* left,
+                      float* right,
+                      int numSamples,
+                      double ratio,
+                      double ratioStep,
+                      float gain,
+                      float gainStep);
+
+    /**
+     * Runs a chunk of both channels through one filter, in place.
+     *
+     * @param filter     - The filter, whose state is updated.
+     * @param left       - The left channel.
+     * @param right      - The right channel.
+     * @param numSamples - The number of samples to filter.
+     */
+    static void applyFilter(Biquad& filter, float* left, float* right, int numSamples);
+
+    /**
+     * Applies a linearly ramped gain to a chunk of both channels, in place.
+     *
+     * @param left       - The left channel.
+     * @param right      - The right channel.
+     * @param numSamples - The number of samples to scale.
+     * @param gain       - The gain at the first sample.
+     * @param gainStep   - The change in gain per sample.
+     */
+    void applyGain(float* left, float* right, int numSamples, float gain, float gainStep);
+
+    /**
+     * Makes sure enough input samples are buffered to interpolate the
+     * next chunk of output, reading more from the input if not.
+     *
+     * @param input       - The source to pull audio from.
+     * @param numRequired - The number of buffered samples needed.
+     */
+    void fillInput(juce::AudioSource& input, int numRequired);
+
+    // The most output samples processed between input reads
+    static constexpr int maxOutputChunk{ 256 };
+    // Level below which a flat filter's ringing is cut off
+    static constexpr float ringingThreshold{ 1.0e-6f };
+    // The largest speed ratio, in input samples per output sample
+    static constexpr double maxRatio{ 16.0 };
+    // Below this ratio the output fades out, reaching silence at 0. Low
+    // enough that resampling a low-rate file to a high device rate isn't
+    // faded.
+    static constexpr double minRatio{ 0.02 };
+    // Input samples kept before and read beyond the playhead, enough for 
+    // any of the interpolators
+    static constexpr int historyLength{ SincInterpolator::lookbehind };
+    static constexpr int lookaheadLength{ SincInterpolator::lookahead };
+
+    // Input samples waiting to be interpolated, for the left and right channels
+    juce::AudioBuffer<float> inputBuffer;
+    // Number of valid samples in inputBuffer
+    int numBuffered{ 0 };
+    // Position of the next output sample, in input samples from the start of inputBuffer
+    double inputPosition{ 0 };
+    // How the resampler interpolates
+    Interpolation interpolation{ Interpolation::sinc };
+
+    // The shelf filters, in the order they are applied
+    Biquad filters[numFilters];
+    // Somewhere to write the right channel when the output is mono
+    float discardedChannel[maxOutputChunk]{};
+    // The gain for each sample of a chunk, while the gain is ramping
+    float gainRamp[maxOutputChunk]{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckProcessor)
+};
@@ -0,0 +1,228 @@
+#if defined (_WIN32)
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif defined (__APPLE__)
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+#include <JuceHeader.h>
+#include "DeckRenderPool.h"
+
+
+DeckRenderPool::DeckRenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        Worker* worker = workers.add(new Worker{ *this });
+#if JUCE_VERSION >= 0x70003
+        bool started = worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+#else
+        worker->startThread(10);
+        bool started = worker->isThreadRunning();
+#endif
+
+        // Carry on with the workers that did start, so the audio thread
+        // never counts on one that isn't running
+        if (!started)
+        {
+            DBG("DeckRenderPool::DeckRenderPool: could not start worker " << i);
+            workers.removeObject(worker);
+            break;
+        }
+    }
+}
+
+DeckRenderPool::~DeckRenderPool()
+{
+    // Ask every worker to stop, and wake the parked ones so they see it
+    for (Worker* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+    }
+    wakeSignal.post(workers.size());
+    for (Worker* worker : workers)
+    {
+        worker->stopThread(1000);
+    }
+}
+
+void DeckRenderPool::run(Job& job, int _numTasks, bool parallel)
+{
+    // Small jobs, and pools without workers, run on this thread alone
+    if (!parallel || workers.isEmpty() || _numTasks < 2)
+    {
+        for (int i = 0; i < _numTasks; ++i)
+        {
+            job.runTask(i);
+        }
+        return;
+    }
+
+    // Set up the job, then publish it by starting a new generation. Workers
+    // that are still spinning see it straight away.
+    currentJob.store(&job, std::memory_order_relaxed);
+    numTasks.store(_numTasks, std::memory_order_relaxed);
+    tasksDone.store(0, std::memory_order_relaxed);
+    juce::uint32 generation = getGeneration() + 1;
+    taskCounter.store(static_cast<juce::uint64>(generation) << 32);
+
+    // Wake parked workers, but no more than there are tasks to share with
+    // this thread
+    int numToWake = juce::jmin(numParked.load(), _numTasks - 1);
+    if (numToWake > 0)
+    {
+        wakeSignal.post(numToWake);
+    }
+
+    // Work on the tasks here too, then wait for the workers to finish theirs
+    runTasks(generation);
+    while (tasksDone.load(std::memory_order_acquire) < _numTasks)
+    {
+    }
+}
+
+int DeckRenderPool::getNumWorkers() const
+{
+    return workers.size();
+}
+
+void DeckRenderPool::runTasks(juce::uint32 generation)
+{
+    for (;;)
+    {
+        // Stop if the job has changed or every task has been claimed
+        juce::uint64 counter = taskCounter.load(std::memory_order_acquire);
+        int taskIndex = static_cast<int>(counter & 0xffffffff);
+        if ((counter >> 32) != generation || taskIndex >= numTasks.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        // Claim the task, unless another thread got there first
+        if (taskCounter.compare_exchange_weak(counter, counter + 1, std::memory_order_acq_rel))
+        {
+            currentJob.load(std::memory_order_relaxed)->runTask(taskIndex);
+            tasksDone.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+// Sequentially consistent, so a worker that counts itself as parked and
+// then finds no new job is always counted by the audio thread when it
+// publishes the next one
+juce::uint32 DeckRenderPool::getGeneration() const
+{
+    return static_cast<juce::uint32>(taskCounter.load() >> 32);
+}
+
+DeckRenderPool::Worker::Worker(DeckRenderPool& _pool)
+    : juce::Thread{ "Deck render worker" },
+      pool{ _pool }
+{
+}
+
+void DeckRenderPool::Worker::run()
+{
+    juce::uint32 lastGeneration = pool.getGeneration();
+
+    while (!threadShouldExit())
+    {
+        // Spin for a moment, in case the next job follows straight on
+        double spinStartMs = juce::Time::getMillisecondCounterHiRes();
+        juce::uint32 generation = pool.getGeneration();
+        while (generation == lastGeneration 
+               && juce::Time::getMillisecondCounterHiRes() - spinStartMs < spinTimeMs)
+        {
+            generation = pool.getGeneration();
+        }
+
+        // Park until the audio thread wakes this worker. It counts itself as
+        // parked before checking for a job once more, so a job published in
+        // between is either seen here or wakes it. A spare wake-up only
+        // costs one more spin.
+        if (generation == lastGeneration)
+        {
+            pool.numParked.fetch_add(1);
+            if (pool.getGeneration() == lastGeneration && !threadShouldExit())
+            {
+                pool.wakeSignal.wait();
+            }
+            pool.numParked.fetch_sub(1);
+            continue;
+        }
+
+        // Help with the new job
+        lastGeneration = generation;
+        pool.runTasks(generation);
+    }
+}
+
+#if defined (_WIN32)
+struct DeckRenderPool::Semaphore::Native
+{
+    HANDLE handle{ CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr) };
+};
+#elif defined (__APPLE__)
+struct DeckRenderPool::Semaphore::Native
+{
+    dispatch_semaphore_t semaphore{ dispatch_semaphore_create(0) };
+};
+#else
+struct DeckRenderPool::Semaphore::Native
+{
+    sem_t semaphore;
+};
+#endif
+
+DeckRenderPool::Semaphore::Semaphore()
+    : native{ std::make_unique<Native>() }
+{
+#if ! defined (_WIN32) && ! defined (__APPLE__)
+    sem_init(&native->semaphore, 0, 0);
+#endif
+}
+
+DeckRenderPool::Semaphore::~Semaphore()
+{
+#if defined (_WIN32)
+    CloseHandle(native->handle);
+#elif defined (__APPLE__)
+    dispatch_release(native->semaphore);
+#else
+    sem_destroy(&native->semaphore);
+#endif
+}
+
+void DeckRenderPool::Semaphore::post(int count)
+{
+#if defined (_WIN32)
+    ReleaseSemaphore(native->handle, count, nullptr);
+#else
+    for (int i = 0; i < count; ++i)
+    {
+ #if defined (__APPLE__)
+        dispatch_semaphore_signal(native->semaphore);
+ #else
+        sem_post(&native->semaphore);
+ #endif
+    }
+#endif
+}
+
+void DeckRenderPool::Semaphore::wait()
+{
+#if defined (_WIN32)
+    WaitForSingleObject(native->handle, INFINITE);
+#elif defined (__APPLE__)
+    dispatch_semaphore_wait(native->semaphore, DISPATCH_TIME_FOREVER);
+#else
+    // Carry on waiting if a signal interrupts the wait
+    while (sem_wait(&native->semaphore) != 0 && errno == EINTR)
+    {
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <JuceHeader.h>
+
+
+/**
+ * A pool of real-time worker threads for rendering independent tasks, such
+ * as decks, in parallel within one audio callback.
+ *
+ * The audio thread hands over a job and a number of tasks. The workers and
+ * the audio thread itself claim tasks from a shared atomic counter until
+ * none are left, and the audio thread waits until every task is finished.
+ * Nothing is allocated or locked while a job runs.
+ *
+ * The audio thread publishes each job through the atomic counter, which
+ * the workers watch. After finishing a job, each worker spins for a few
+ * tens of microseconds in case another follows straight on, then parks on
+ * a semaphore. The audio thread wakes only as many parked workers as the
+ * job has tasks to share, by posting to the semaphore, which takes no
+ * lock. Workers use no CPU between blocks.
+ */
+class DeckRenderPool
+{
+public:
+    /** Work made up of numbered tasks that can run in any order, at once. */
+    class Job
+    {
+    public:
+        /** Destructor */
+        virtual ~Job() = default;
+
+        /**
+         * Runs one task. Called on the audio thread or a worker thread.
+         *
+         * @param taskIndex - The task to run.
+         */
+        virtual void runTask(int taskIndex) = 0;
+    };
+
+    /**
+     * Constructor. Starts the workers.
+     *
+     * @param numWorkers - The number of worker threads, as well as the
+     *     audio thread. With 0, every job runs on the calling thread. Fewer
+     *     are used if some of the threads can't be started.
+     */
+    DeckRenderPool(int numWorkers);
+
+    /** Destructor. Stops the workers. */
+    ~DeckRenderPool();
+
+    /**
+     * Runs every task of a job, and returns when they are all finished.
+     * Only call this from one thread, usually the audio thread.
+     *
+     * @param job      - The job to run.
+     * @param numTasks - The number of tasks.
+     * @param parallel - False to run the tasks one after another on the
+     *     calling thread, for jobs too small to be worth sharing out.
+     */
+    void run(Job& job, int numTasks, bool parallel);
+
+    /**
+     * Gets the number of worker threads.
+     *
+     * @return The number of workers.
+     */
+    int getNumWorkers() const;
+
+private:
+    /** A thread that runs tasks from the pool's jobs. */
+    class Worker : public juce::Thread
+    {
+    public:
+        /**
+         * Constructor
+         *
+         * @param _pool - The pool to take tasks from.
+         */
+        Worker(DeckRenderPool& _pool);
+
+        /** Implements Thread: Waits for jobs and runs their tasks. */
+        void run() override;
+
+    private:
+        DeckRenderPool& pool;
+    };
+
+    /**
+     * A counting semaphore on the platform's own primitive. Posting never
+     * takes a lock, so the audio thread can wake workers.
+     */
+    class Semaphore
+    {
+    public:
+        /** Constructor. Starts with a count of 0. */
+        Semaphore();
+
+        /** Destructor */
+        ~Semaphore();
+
+        /**
+         * Raises the count, waking up to that many waiting threads.
+         *
+         * @param count - The amount to raise the count by.
+         */
+        void post(int count);
+
+        /** Waits until the count is above 0, then lowers it by 1. */
+        void wait();
+
+    private:
+        struct Native;
+        std::unique_ptr<Native> native;
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    /**
+     * Claims and runs tasks of the current job until there are none left.
+     *
+     * @param generation - The job the caller expects to be working on.
+     *     Tasks are only claimed while it's still the current job.
+     */
+    void runTasks(juce::uint32 generation);
+
+    /**
+     * Gets the generation of the current job.
+     *
+     * @return The current job's generation.
+     */
+    juce::uint32 getGeneration() const;
+
+    // The current job and its number of tasks. Written before the job's
+    // generation is published.
+    std::atomic<Job*> currentJob{ nullptr };
+    std::atomic<int> numTasks{ 0 };
+    // The current job's generation in the upper 32 bits, and the next task
+    // to claim in the lower 32. Claiming a task checks both at once, so a
+    // late worker can never claim a task from a newer job.
+    std::atomic<juce::uint64> taskCounter{ 0 };
+    // Number of the current job's tasks that are finished
+    std::atomic<int> tasksDone{ 0 };
+
+    // Parked workers wait on this, and count themselves in numParked
+    // before they do
+    Semaphore wakeSignal;
+    std::atomic<int> numParked{ 0 };
+
+    // How long a worker keeps checking for a new job after finishing one,
+    // before it parks
+    static constexpr double spinTimeMs{ 0.05 };
+
+    // The workers
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckRenderPool)
+};
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <limits>
+#include <JuceHeader.h>
+#include "DecodedTrackCache.h"
+
+
+DecodedTrackCache::DecodedTrackCache(juce::AudioFormatManager& _formatManager, size_t _memoryBudget)
+    : formatManager{ _formatManager },
+      memoryBudget{ _memoryBudget }
+{
+    readAheadThread.startThread();
+}
+
+DecodedTrackCache::~DecodedTrackCache()
+{
+    readAheadThread.stopThread(1000);
+}
+
+std::shared_ptr<const DecodedTrack> DecodedTrackCache::getTrack(const juce::File& file)
+{
+    juce::String key = getKey(file);
+
+    // Return the cached track if there is one
+    {
+        const juce::ScopedLock sl(lock);
+        for (Entry& entry : entries)
+        {
+            if (entry.key == key)
+            {
+                entry.lastUsed = ++useCounter;
+                return entry.track;
+            }
+        }
+    }
+
+    // Decode without holding the lock, so other decks aren't held up
+    std::shared_ptr<const DecodedTrack> track = decode(file);
+    if (track == nullptr)
+    {
+        return nullptr;
+    }
+
+    const juce::ScopedLock sl(lock);
+
+    // Another deck may have decoded the same track in the meantime
+    for (Entry& entry : entries)
+    {
+        if (entry.key == key)
+        {
+            entry.lastUsed = ++useCounter;
+            return entry.track;
+        }
+    }
+
+    // Make room for the track and add it
+    size_t size = static_cast<size_t>(track->samples.getNumChannels()) 
+                  * static_cast<size_t>(track->samples.getNumSamples()) * sizeof(float);
+    evictToFit(size);
+    entries.push_back({ key, track, size, ++useCounter });
+    memoryUsed += size;
+
+    return track;
+}
+
+void DecodedTrackCache::setMemoryBudget(size_t bytes)
+{
+    const juce::ScopedLock sl(lock);
+    memoryBudget = bytes;
+    evictToFit(0);
+}
+
+size_t DecodedTrackCache::getMemoryBudget() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryBudget;
+}
+
+size_t DecodedTrackCache::getMemoryUsed() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryUsed;
+}
+
+juce::TimeSliceThread& DecodedTrackCache::getReadAheadThread()
+{
+    return readAheadThread;
+}
+
+juce::String DecodedTrackCache::getKey(const juce::File& file)
+{
+    return file.getFullPathName() + "|" + juce::String(file.getLastModificationTime().toMilliseconds());
+}
+
+std::shared_ptr<const DecodedTrack> DecodedTrackCache::decode(const juce::File& file) const
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ readerFactory.createReaderFor(file) };
+    if (reader == nullptr)
+    {
+        DBG("DecodedTrackCache::decode: could not read " << file.getFullPathName());
+        return nullptr;
+    }
+
+    // Tracks too large for the budget are left to be streamed instead
+    int numChannels = static_cast<int>(juce::jmin(reader->numChannels, 2u));
+    size_t size = static_cast<size_t>(numChannels) * static_cast<size_t>(reader->lengthInSamples) * sizeof(float);
+    if (numChannels == 0 || reader->lengthInSamples > std::numeric_limits<int>::max()
+        || size > getMemoryBudget())
+    {
+        return nullptr;
+    }
+
+    // Decode the whole track
+    auto track = std::make_shared<DecodedTrack>();
+    track->sampleRate = reader->sampleRate;
+    track->samples.setSize(numChannels, static_cast<int>(reader->lengthInSamples));
+    if (!reader->read(&track->samples, 0, static_cast<int>(reader->lengthInSamples), 0, true, true))
+    {
+        DBG("DecodedTrackCache::decode: could not decode " << file.getFullPathName());
+        return nullptr;
+    }
+
+    return track;
+}
+
+void DecodedTrackCache::evictToFit(size_t bytesNeeded)
+{
+    // Oldest first
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    auto entry = entries.begin();
+    while (memoryUsed + bytesNeeded > memoryBudget && entry != entries.end())
+    {
+        // Skip tracks a deck is still playing. Their memory can't be freed yet.
+        if (entry->track.use_count() > 1)
+        {
+            ++entry;
+            continue;
+        }
+        memoryUsed -= entry->size;
+        entry = entries.erase(entry);
+    }
+}
+
+//==============================================================================
+
+DecodedTrackSource::DecodedTrackSource(std::shared_ptr<const DecodedTrack> _track)
+    : track{ std::move(_track) }
+{
+}
+
+DecodedTrackSource::~DecodedTrackSource()
+{
+}
+
+void DecodedTrackSource::prepareToPlay(int, double)
+{
+}
+
+void DecodedTrackSource::releaseResources()
+{
+}
+
+void DecodedTrackSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const juce::AudioBuffer<float>& samples = track->samples;
+    juce::int64 length = samples.getNumSamples();
+    auto* buffer = bufferToFill.buffer;
+
+    int numWritten = 0;
+    while (numWritten < bufferToFill.numSamples)
+    {
+        // Wrap around when looping
+        if (looping && position >= length)
+        {
+            position = 0;
+        }
+
+        // Copy as much of the track as is left, and silence the rest
+        int numToCopy = static_cast<int>(juce::jlimit(juce::int64{ 0 }, 
+            static_cast<juce::int64>(bufferToFill.numSamples - numWritten), length - position));
+        int startSample = bufferToFill.startSample + numWritten;
+
+        if (numToCopy == 0)
+        {
+            buffer->clear(startSample, bufferToFill.numSamples - numWritten);
+            position += bufferToFill.numSamples - numWritten;
+            break;
+        }
+
+        for (int channel = 0; channel < buffer->getNumChannels(); ++channel)
+        {
+            // Mono tracks play on every channel
+            int sourceChannel = juce::jmin(channel, samples.getNumChannels() - 1);
+            buffer->copyFrom(channel, startSample, samples, sourceChannel, 
+                             static_cast<int>(position), numToCopy);
+        }
+
+        position += numToCopy;
+        numWritten += numToCopy;
+    }
+}
+
+void DecodedTrackSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = juce::jmax(juce::int64{ 0 }, newPosition);
+}
+
+juce::int64 DecodedTrackSource::getNextReadPosition() const
+{
+    return position;
+}
+
+juce::int64 DecodedTrackSource::getTotalLength() const
+{
+    return track->samples.getNumSamples();
+}
+
+bool DecodedTrackSource::isLooping() const
+{
+    return looping;
+}
+
+void DecodedTrackSource::setLooping(bool shouldLoop)
+{
+    looping = shouldLoop;
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "AudioFileReaderFactory.h"
+
+
+/** A track decoded to PCM in memory. */
+struct DecodedTrack
+{
+    juce::AudioBuffer<float> samples;
+    double sampleRate;
+};
+
+
+/**
+ * A memory-resident cache of decoded tracks, shared by all the decks, so
+ * playback never has to read or decode the file on the audio thread.
+ *
+ * Tracks are decoded whole the first time they are requested and kept
+ * until the memory budget is needed for other tracks, when the least
+ * recently used ones are evicted. Tracks that a deck is still playing are
+ * never evicted.
+ *
+ * The cache also owns a read-ahead thread, for decks that stream tracks
+ * from disk instead of decoding them up front.
+ */
+class DecodedTrackCache
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app. Used to decode tracks.
+     * @param _memoryBudget  - The most memory to use for decoded audio, in bytes.
+     */
+    DecodedTrackCache(juce::AudioFormatManager& _formatManager,
+                      size_t _memoryBudget = defaultMemoryBudget);
+
+    /** Destructor */
+    ~DecodedTrackCache();
+
+    /**
+     * Gets a decoded track, decoding it if it isn't cached. Decoding can
+     * take a while, so don't call this on the audio thread.
+     *
+     * @param file - The audio file.
+     * @return The decoded track, or nullptr if the file can't be read or is
+     *     too large for the memory budget.
+     */
+    std::shared_ptr<const DecodedTrack> getTrack(const juce::File& file);
+
+    /**
+     * Sets the most memory to use for decoded audio. Evicts tracks if the
+     * cache is over the new budget.
+     *
+     * @param bytes - The memory budget, in bytes.
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /**
+     * Gets the most memory to use for decoded audio.
+     *
+     * @return The memory budget, in bytes.
+     */
+    size_t getMemoryBudget() const;
+
+    /**
+     * Gets the memory used by the cached tracks.
+     *
+     * @return The memory used, in bytes.
+     */
+    size_t getMemoryUsed() const;
+
+    /**
+     * Gets the shared thread for streaming tracks from disk ahead of playback.
+     *
+     * @return The read-ahead thread.
+     */
+    juce::TimeSliceThread& getReadAheadThread();
+
+    // Default memory budget, enough for about 25 minutes of stereo audio at 44.1kHz
+    static constexpr size_t defaultMemoryBudget{ 512 * 1024 * 1024 };
+
+private:
+    /** A cached track. */
+    struct Entry
+    {
+        juce::String key;
+        std::shared_ptr<const DecodedTrack> track;
+        size_t size;
+        juce::uint64 lastUsed;
+    };
+
+    /**
+     * Gets the cache key for a file. Includes the modification time, so
+     * edited files are decoded again.
+     *
+     * @param file - The audio file.
+     * @return The key.
+     */
+    static juce::String getKey(const juce::File& file);
+
+    /**
+     * Decodes a file into memory.
+     *
+     * @param file - The audio file.
+     * @return The decoded track, or nullptr if the file can't be read or is
+     *     too large for the memory budget.
+     */
+    std::shared_ptr<const DecodedTrack> decode(const juce::File& file) const;
+
+    /**
+     * Evicts the least recently used tracks until there is room for more.
+     * Tracks still held by a deck are skipped. Call with the lock held.
+     *
+     * @param bytesNeeded - The room to make, in bytes.
+     */
+    void evictToFit(size_t bytesNeeded);
+
+    // Shared format manager, and reader factory for decoding tracks
+    juce::AudioFormatManager& formatManager;
+    AudioFileReaderFactory readerFactory{ formatManager };
+    // The cached tracks
+    std::vector<Entry> entries;
+    // Memory budget and memory used, in bytes
+    size_t memoryBudget;
+    size_t memoryUsed{ 0 };
+    // Counter for ordering entries by when they were last used
+    juce::uint64 useCounter{ 0 };
+    // Lock protecting the entries and counters
+    juce::CriticalSection lock;
+    // Read-ahead thread for streamed tracks
+    juce::TimeSliceThread readAheadThread{ "Deck read-ahead" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedTrackCache)
+};
+
+
+/**
+ * Plays a track from the decoded track cache. Holds a reference to the
+ * decoded audio, so it stays in memory while the track is loaded.
+ */
+class DecodedTrackSource : public juce::PositionableAudioSource
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _track - The decoded track to play.
+     */
+    DecodedTrackSource(std::shared_ptr<const DecodedTrack> _track);
+
+    /** Destructor */
+    ~DecodedTrackSource();
+
+    /** Implements AudioSource: Nothing to prepare. */
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+    /** Implements AudioSource: Nothing to release. */
+    void releaseResources() override;
+
+    /**
+     * Implements AudioSource: Copies the next block of the track.
+     *
+     * @param bufferToFill - The audio source buffer.
+     */
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    /** Implements PositionableAudioSource: Sets the read position. */
+    void setNextReadPosition(juce::int64 newPosition) override;
+
+    /** Implements PositionableAudioSource: Gets the read position. */
+    juce::int64 getNextReadPosition() const override;
+
+    /** Implements PositionableAudioSource: Gets the track length in samples. */
+    juce::int64 getTotalLength() const override;
+
+    /** Implements PositionableAudioSource: Checks whether the track loops. */
+    bool isLooping() const override;
+
+    /** Implements PositionableAudioSource: Sets whether the track loops. */
+    void setLooping(bool shouldLoop) override;
+
+private:
+    // The decoded audio
+    std::shared_ptr<const DecodedTrack> track;
+    // Next sample to read
+    juce::int64 position{ 0 };
+    // Whether to loop back to the start at the end
+    bool looping{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedTrackSource)
+};
@@ -0,0 +1,43 @@
+#include <JuceHeader.h>
+#include "DisplayRefreshDriver.h"
+
+
+DisplayRefreshDriver::DisplayRefreshDriver(juce::Component& _component)
+{
+#if JUCE_MAJOR_VERSION >= 7
+    vBlankAttachment = std::make_unique<juce::VBlankAttachment>(&_component, [this] { refreshClients(); });
+#else
+    juce::ignoreUnused(_component);
+    startTimerHz(fallbackFrameRate);
+#endif
+}
+
+DisplayRefreshDriver::~DisplayRefreshDriver()
+{
+    stopTimer();
+}
+
+void DisplayRefreshDriver::addClient(Client* client)
+{
+    clients.addIfNotAlreadyThere(client);
+}
+
+void DisplayRefreshDriver::removeClient(Client* client)
+{
+    clients.removeFirstMatchingValue(client);
+}
+
+void DisplayRefreshDriver::timerCallback()
+{
+    refreshClients();
+}
+
+// Every client is given the same frame time, so decks stay in step
+void DisplayRefreshDriver::refreshClients()
+{
+    double frameTimeMs = juce::Time::getMillisecondCounterHiRes();
+    for (Client* client : clients)
+    {
+        client->refreshDisplay(frameTimeMs);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <JuceHeader.h>
+
+
+/**
+ * Drives the animated parts of the GUI once per screen refresh, so every
+ * deck's displays are updated together in one pass per frame.
+ *
+ * With JUCE 7 or later, frames are synchronised to the display's vertical
+ * blank through a VBlankAttachment. With older versions, a 60 Hz timer is
+ * used instead.
+ */
+class DisplayRefreshDriver : private juce::Timer
+{
+public:
+    /** Something updated once per frame. */
+    class Client
+    {
+    public:
+        /** Destructor */
+        virtual ~Client() = default;
+
+        /**
+         * Called on the message thread once per frame.
+         *
+         * @param frameTimeMs - The time of the frame, on the
+         *     Time::getMillisecondCounterHiRes() clock.
+         */
+        virtual void refreshDisplay(double frameTimeMs) = 0;
+    };
+
+    /**
+     * Constructor
+     *
+     * @param _component - The component whose display the frames are
+     *     synchronised to. Usually the main component.
+     */
+    DisplayRefreshDriver(juce::Component& _component);
+
+    /** Destructor */
+    ~DisplayRefreshDriver() override;
+
+    /**
+     * Registers a client to update each frame.
+     *
+     * @param client - The client to add.
+     */
+    void addClient(Client* client);
+
+    /**
+     * Deregisters a client.
+     *
+     * @param client - The client to remove.
+     */
+    void removeClient(Client* client);
+
+private:
+    /**
+     * Implements Timer: Refreshes the clients, when there's no VBlankAttachment.
+     */
+    void timerCallback() override;
+
+    /**
+     * Updates every client for a new frame.
+     */
+    void refreshClients();
+
+    // The clients to update each frame
+    juce::Array<Client*> clients;
+
+#if JUCE_MAJOR_VERSION >= 7
+    // Calls refreshClients() at each vertical blank of the component's display
+    std::unique_ptr<juce::VBlankAttachment> vBlankAttachment;
+#endif
+
+    // Frame rate when there's no VBlankAttachment
+    static constexpr int fallbackFrameRate{ 60 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DisplayRefreshDriver)
+};
@@ -0,0 +1,80 @@
+#include <cmath>
+#include <JuceHeader.h>
+#include "Interpolators.h"
+
+
+namespace
+{
+    // Highest ratio each shared table is used for, and the cutoff at a ratio of 1
+    const double tableRatios[]{ 1.0, 1.5, 2.25, 3.4, 5.0, 8.0, 16.0 };
+    constexpr double baseCutoff{ 0.46 };
+}
+
+SincTable::SincTable(double cutoff)
+    : taps(static_cast<size_t>(numPhases * 2 * numTaps))
+{
+    // Works out the taps for a fractional position, normalised to unity gain
+    auto makeTaps = [cutoff](double fraction, float* phaseTaps)
+    {
+        double sum = 0;
+        for (int i = 0; i < numTaps; ++i)
+        {
+            // Distance of the tap's sample from the read position
+            double x = (i - (halfLength - 1)) - fraction;
+
+            // Sinc low-pass at the cutoff
+            double sinc = x == 0 ? 1.0 
+                                 : std::sin(juce::MathConstants<double>::twoPi * cutoff * x) 
+                                   / (juce::MathConstants<double>::twoPi * cutoff * x);
+
+            // Blackman-Harris window over the taps
+            double w = juce::MathConstants<double>::pi * x / halfLength;
+            double window = std::abs(x) >= halfLength ? 0.0 
+                : 0.35875 + 0.48829 * std::cos(w) + 0.14128 * std::cos(2 * w) + 0.01168 * std::cos(3 * w);
+
+            phaseTaps[i] = static_cast<float>(sinc * window);
+            sum += phaseTaps[i];
+        }
+        for (int i = 0; i < numTaps; ++i)
+        {
+            phaseTaps[i] = static_cast<float>(phaseTaps[i] / sum);
+        }
+    };
+
+    // Build each phase, then the differences to the next one
+    float nextTaps[numTaps];
+    for (int phase = 0; phase < numPhases; ++phase)
+    {
+        float* row = taps.data() + phase * 2 * numTaps;
+        makeTaps(static_cast<double>(phase) / numPhases, row);
+        makeTaps(static_cast<double>(phase + 1) / numPhases, nextTaps);
+        for (int i = 0; i < numTaps; ++i)
+        {
+            row[numTaps + i] = nextTaps[i] - row[i];
+        }
+    }
+}
+
+const SincTable& SincTable::forRatio(double ratio)
+{
+    // Built once and shared by every deck
+    static const std::vector<SincTable> tables = []
+    {
+        std::vector<SincTable> built;
+        for (double tableRatio : tableRatios)
+        {
+            built.emplace_back(baseCutoff / tableRatio);
+        }
+        return built;
+    }();
+
+    // Use the first table whose ratio covers this one
+    for (size_t i = 0; i < tables.size(); ++i)
+    {
+        if (ratio <= tableRatios[i])
+        {
+            return tables[i];
+        }
+    }
+    return tables.back();
+}
\ No newline at end of file
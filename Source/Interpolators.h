@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+#include <JuceHeader.h>
+
+
+/*
+ * Interpolators for reading between the samples of a buffer, used by the
+ * DeckProcessor to resample at any ratio. Each reads the samples around an
+ * index, so the buffer must hold lookbehind samples before the index and
+ * lookahead samples after it.
+ */
+
+/** Straight-line interpolation between the two nearest samples. */
+struct LinearInterpolator
+{
+    static constexpr int lookbehind{ 0 };
+    static constexpr int lookahead{ 1 };
+
+    /**
+     * Interpolates between samples.
+     *
+     * @param samples  - The buffer to read.
+     * @param index    - Index of the sample before the read position.
+     * @param fraction - How far past the index to read, from 0 to 1.
+     * @return The interpolated sample.
+     */
+    float operator()(const float* samples, int index, float fraction) const
+    {
+        return samples[index] + fraction * (samples[index + 1] - samples[index]);
+    }
+};
+
+/** Catmull-Rom cubic interpolation through the four nearest samples. */
+struct CubicInterpolator
+{
+    static constexpr int lookbehind{ 1 };
+    static constexpr int lookahead{ 2 };
+
+    /**
+     * Interpolates between samples.
+     *
+     * @param samples  - The buffer to read.
+     * @param index    - Index of the sample before the read position.
+     * @param fraction - How far past the index to read, from 0 to 1.
+     * @return The interpolated sample.
+     */
+    float operator()(const float* samples, int index, float fraction) const
+    {
+        float y0 = samples[index - 1];
+        float y1 = samples[index];
+        float y2 = samples[index + 1];
+        float y3 = samples[index + 2];
+        return y1 + 0.5f * fraction * (y2 - y0 + fraction * (2.0f * y0 - 5.0f * y1 + 4.0f * y2 - y3
+                                       + fraction * (3.0f * (y1 - y2) + y3 - y0)));
+    }
+};
+
+/**
+ * A bank of windowed-sinc filters for band-limited interpolation. The
+ * filters are stored by phase: each row holds the taps for one fractional
+ * position between samples, along with the difference to the next row, so
+ * positions between rows can be interpolated. Rows are contiguous, so the
+ * dot product with the input vectorises.
+ */
+class SincTable
+{
+public:
+    // Taps either side of the read position
+    static constexpr int halfLength{ 16 };
+    static constexpr int numTaps{ 2 * halfLength };
+    // Number of fractional positions stored between samples
+    static constexpr int numPhases{ 128 };
+
+    /**
+     * Constructor. Builds the filter bank.
+     *
+     * @param cutoff - The cutoff frequency, as a fraction of the input
+     *     sample rate. Below 0.5 for anti-aliasing.
+     */
+    SincTable(double cutoff);
+
+    /**
+     * Gets the taps for a phase.
+     *
+     * @param phase - The phase, from 0 to numPhases - 1.
+     * @return Pointer to numTaps taps, then numTaps differences to the next phase.
+     */
+    const float* getPhase(int phase) const { return taps.data() + phase * 2 * numTaps; }
+
+    /**
+     * Gets the shared tables for resampling at a ratio. Faster ratios use
+     * tables with lower cutoffs, so the output doesn't alias. The tables are
+     * built the first time this is called.
+     *
+     * @param ratio - Input samples per output sample.
+     * @return The table with the right cutoff for the ratio.
+     */
+    static const SincTable& forRatio(double ratio);
+
+private:
+    // Taps and next-phase differences for each phase, interleaved by row
+    std::vector<float> taps;
+};
+
+/** Band-limited interpolation through a windowed-sinc filter bank. */
+struct SincInterpolator
+{
+    static constexpr int lookbehind{ SincTable::halfLength - 1 };
+    static constexpr int lookahead{ SincTable::halfLength };
+
+    // The filter bank to interpolate with
+    const SincTable& table;
+
+    /**
+     * Interpolates between samples.
+     *
+     * @param samples  - The buffer to read.
+     * @param index    - Index of the sample before the read position.
+     * @param fraction - How far past the index to read, from 0 to 1.
+     * @return The interpolated sample.
+     */
+    float operator()(const float* samples, int index, float fraction) const
+    {
+        // Find the stored phases either side of the fraction
+        float phasePosition = fraction * SincTable::numPhases;
+        int phase = juce::jmin(static_cast<int>(phasePosition), SincTable::numPhases - 1);
+        float phaseFraction = phasePosition - phase;
+
+        const float* taps = table.getPhase(phase);
+        const float* differences = taps + SincTable::numTaps;
+        const float* input = samples + index - lookbehind;
+
+        float sum = 0;
+        for (int i = 0; i < SincTable::numTaps; ++i)
+        {
+            sum += input[i] * (taps[i] + phaseFraction * differences[i]);
+        }
+        return sum;
+    }
+};
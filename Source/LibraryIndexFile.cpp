@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <JuceHeader.h>
+#include "LibraryIndexFile.h"
+
+namespace
+{
+    // Index file header: magic, format version, track count
+    const char indexMagic[4]{ 'D', 'J', 'L', 'I' };
+    // Journal file header: magic, format version
+    const char journalMagic[4]{ 'D', 'J', 'L', 'J' };
+    // Version 1 records are size-prefixed, so fields can be appended to the
+    // end of a record without changing the version. Only incompatible 
+    // layout changes need a new version number.
+    const int formatVersion{ 1 };
+    const size_t indexHeaderSize{ 12 };
+    const size_t journalHeaderSize{ 8 };
+    const size_t journalEntryHeaderSize{ 9 };
+
+    // Reads little-endian values from a record, keeping track of the position
+    struct RecordReader
+    {
+        const char* data;
+        size_t size;
+        size_t position{ 0 };
+
+        bool canRead(size_t numBytes) const { return position + numBytes <= size; }
+
+        int readInt()
+        {
+            int value = (int) juce::ByteOrder::littleEndianInt(data + position);
+            position += 4;
+            return value;
+        }
+
+        juce::int64 readInt64()
+        {
+            juce::int64 value = (juce::int64) juce::ByteOrder::littleEndianInt64(data + position);
+            position += 8;
+            return value;
+        }
+
+        double readDouble()
+        {
+            juce::int64 bits = readInt64();
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        bool readString(juce::String& value)
+        {
+            if (!canRead(4))
+            {
+                return false;
+            }
+            size_t numBytes = (size_t) readInt();
+            if (!canRead(numBytes))
+            {
+                return false;
+            }
+            value = juce::String::fromUTF8(data + position, (int) numBytes);
+            position += numBytes;
+            return true;
+        }
+    };
+}
+
+
+LibraryIndexFile::LibraryIndexFile(const juce::File& _indexFile, const juce::File& _journalFile)
+    : indexFile{ _indexFile },
+      journalFile{ _journalFile }
+{
+}
+
+LibraryIndexFile::~LibraryIndexFile()
+{
+}
+
+bool LibraryIndexFile::exists() const
+{
+    return indexFile.existsAsFile() || journalFile.existsAsFile();
+}
+
+// The index is memory-mapped and parsed straight out of the mapping. Audio
+// files are not checked here; missing files are reported when a track is
+// loaded to a deck instead.
+bool LibraryIndexFile::load(std::vector<MusicTrack>& tracks)
+{
+    bool indexRead{ true };
+
+    if (indexFile.existsAsFile())
+    {
+        // Map the whole index file into memory
+        juce::MemoryMappedFile mappedIndex{ indexFile, juce::MemoryMappedFile::readOnly };
+        const char* data = static_cast<const char*>(mappedIndex.getData());
+        size_t size = mappedIndex.getSize();
+
+        // Check the header
+        if (data == nullptr || size < indexHeaderSize 
+            || std::memcmp(data, indexMagic, 4) != 0)
+        {
+            DBG("The library index could not be read. File: " + indexFile.getFullPathName());
+            indexRead = false;
+        }
+        else if ((int) juce::ByteOrder::littleEndianInt(data + 4) != formatVersion)
+        {
+            DBG("The library index was written in an unsupported format version.");
+            indexRead = false;
+        }
+        else
+        {
+            // Read each size-prefixed track record
+            int numTracks = (int) juce::ByteOrder::littleEndianInt(data + 8);
+            tracks.reserve(tracks.size() + (size_t) numTracks);
+            size_t position{ indexHeaderSize };
+            for (int i = 0; i < numTracks && position + 4 <= size; ++i)
+            {
+                size_t recordSize = juce::ByteOrder::littleEndianInt(data + position);
+                position += 4;
+                if (position + recordSize > size 
+                    || !readTrackRecord(data + position, recordSize, tracks))
+                {
+                    DBG("The library index is truncated. Some tracks could not be loaded.");
+                    break;
+                }
+                position += recordSize;
+            }
+        }
+    }
+
+    // Apply the changes made since the index was written
+    replayJournal(tracks);
+    return indexRead;
+}
+
+void LibraryIndexFile::journalAdd(const MusicTrack& track)
+{
+    juce::MemoryOutputStream payload;
+    writeTrackRecord(track, payload);
+    appendJournalEntry(addOperation, payload.getMemoryBlock());
+}
+
+// The whole record is journalled, so replaying an update needs nothing
+// but the record
+void LibraryIndexFile::journalUpdate(const MusicTrack& track)
+{
+    juce::MemoryOutputStream payload;
+    writeTrackRecord(track, payload);
+    appendJournalEntry(updateOperation, payload.getMemoryBlock());
+}
+
+void LibraryIndexFile::journalRemove(int trackID)
+{
+    juce::MemoryOutputStream payload;
+    payload.writeInt(trackID);
+    appendJournalEntry(removeOperation, payload.getMemoryBlock());
+}
+
+void LibraryIndexFile::journalClear()
+{
+    appendJournalEntry(clearOperation, {});
+}
+
+int LibraryIndexFile::getNumJournalEntries() const
+{
+    return numJournalEntries;
+}
+
+// The old journal is only deleted once the new index is in place. If the 
+// app stops in between, replaying the old journal over the new index gives 
+// the same tracks again, since replayed adds and removes are idempotent.
+bool LibraryIndexFile::compact(const std::vector<MusicTrack>& tracks)
+{
+    // Write the new index to a temporary file next to the old one
+    juce::TemporaryFile tempIndex{ indexFile };
+    {
+        juce::FileOutputStream output{ tempIndex.getFile() };
+        if (!output.openedOk())
+        {
+            DBG("The library index could not be written. File: " + indexFile.getFullPathName());
+            return false;
+        }
+
+        // Write the header, then every track record
+        output.write(indexMagic, 4);
+        output.writeInt(formatVersion);
+        output.writeInt((int) tracks.size());
+        for (const MusicTrack& track : tracks)
+        {
+            writeTrackRecord(track, output);
+        }
+
+        output.flush();
+        if (output.getStatus().failed())
+        {
+            return false;
+        }
+    }
+
+    // Swap the new index in place of the old one
+    if (!tempIndex.overwriteTargetFileWithTemporary())
+    {
+        return false;
+    }
+
+    // Empty the journal, since the index now contains every change
+    journalStream.reset();
+    journalFile.deleteFile();
+    numJournalEntries = 0;
+    return true;
+}
+
+void LibraryIndexFile::appendJournalEntry(JournalOperation operation, const juce::MemoryBlock& payload)
+{
+    if (!openJournal())
+    {
+        DBG("The library journal could not be opened. File: " + journalFile.getFullPathName());
+        return;
+    }
+
+    // Write the entry header, then the payload
+    journalStream->writeByte((char) operation);
+    journalStream->writeInt((int) payload.getSize());
+    journalStream->writeInt((int) checksum(payload.getData(), payload.getSize()));
+    if (payload.getSize() > 0)
+    {
+        journalStream->write(payload.getData(), payload.getSize());
+    }
+
+    // Push the entry out to the file straight away
+    journalStream->flush();
+    ++numJournalEntries;
+}
+
+void LibraryIndexFile::replayJournal(std::vector<MusicTrack>& tracks)
+{
+    if (!journalFile.existsAsFile())
+    {
+        return;
+    }
+
+    // The length of the journal up to the end of the last complete entry
+    juce::int64 validLength{ 0 };
+    {
+        // Map the whole journal into memory
+        juce::MemoryMappedFile mappedJournal{ journalFile, juce::MemoryMappedFile::readOnly };
+        const char* data = static_cast<const char*>(mappedJournal.getData());
+        size_t size = mappedJournal.getSize();
+
+        // Check the header
+        if (data == nullptr || size < journalHeaderSize 
+            || std::memcmp(data, journalMagic, 4) != 0
+            || (int) juce::ByteOrder::littleEndianInt(data + 4) != formatVersion)
+        {
+            DBG("The library journal could not be read. File: " + journalFile.getFullPathName());
+            journalFile.deleteFile();
+            return;
+        }
+
+        validLength = (juce::int64) journalHeaderSize;
+
+        // Look up each loaded track's position by its ID, so every entry is
+        // replayed in constant time, and replaying an entry twice has no
+        // effect. Removed tracks are dropped from the lookup table, and
+        // from the vector once the whole journal has been replayed.
+        std::unordered_map<int, size_t> trackSlots;
+        for (size_t i = 0; i < tracks.size(); ++i)
+        {
+            trackSlots.emplace(tracks[i].getTrackID(), i);
+        }
+
+        size_t position{ journalHeaderSize };
+        while (position + journalEntryHeaderSize <= size)
+        {
+            // Read the entry header
+            int operation = data[position];
+            size_t payloadSize = juce::ByteOrder::littleEndianInt(data + position + 1);
+            juce::uint32 entryChecksum = juce::ByteOrder::littleEndianInt(data + position + 5);
+            const char* payload = data + position + journalEntryHeaderSize;
+
+            // Stop at an entry that was only partly written
+            if (position + journalEntryHeaderSize + payloadSize > size
+                || checksum(payload, payloadSize) != entryChecksum)
+            {
+                DBG("The library journal ends with an incomplete entry, which was discarded.");
+                break;
+            }
+
+            // Apply the change
+            if (operation == addOperation)
+            {
+                std::vector<MusicTrack> added;
+                if (readTrackRecord(payload, payloadSize, added) 
+                    && trackSlots.emplace(added[0].getTrackID(), tracks.size()).second)
+                {
+                    tracks.push_back(added[0]);
+                }
+            }
+            else if (operation == updateOperation)
+            {
+                // Replace the loaded track with the same ID
+                std::vector<MusicTrack> updated;
+                if (readTrackRecord(payload, payloadSize, updated))
+                {
+                    auto slot = trackSlots.find(updated[0].getTrackID());
+                    if (slot != trackSlots.end())
+                    {
+                        tracks[slot->second] = updated[0];
+                    }
+                }
+            }
+            else if (operation == removeOperation && payloadSize >= 4)
+            {
+                trackSlots.erase((int) juce::ByteOrder::littleEndianInt(payload));
+            }
+            else if (operation == clearOperation)
+            {
+                tracks.clear();
+                trackSlots.clear();
+            }
+
+            position += journalEntryHeaderSize + payloadSize;
+            validLength = (juce::int64) position;
+            ++numJournalEntries;
+        }
+
+        // Drop the removed tracks in one pass, keeping the rest in order. A
+        // track is kept only if its ID still leads to its own position.
+        size_t numKept = 0;
+        for (size_t i = 0; i < tracks.size(); ++i)
+        {
+            auto slot = trackSlots.find(tracks[i].getTrackID());
+            if (slot != trackSlots.end() && slot->second == i)
+            {
+                if (numKept != i)
+                {
+                    tracks[numKept] = std::move(tracks[i]);
+                }
+                ++numKept;
+            }
+        }
+        tracks.erase(tracks.begin() + (std::ptrdiff_t) numKept, tracks.end());
+    }
+
+    // Cut off any incomplete entry, so new entries follow the last good one
+    if (openJournal() && journalStream->getPosition() > validLength)
+    {
+        journalStream->setPosition(validLength);
+        journalStream->truncate();
+    }
+}
+
+bool LibraryIndexFile::openJournal()
+{
+    if (journalStream != nullptr)
+    {
+        return true;
+    }
+
+    // Open the journal. The stream starts at the end of an existing file.
+    bool isNewJournal = !journalFile.existsAsFile() || journalFile.getSize() == 0;
+    journalStream = std::make_unique<juce::FileOutputStream>(journalFile);
+    if (!journalStream->openedOk())
+    {
+        journalStream.reset();
+        return false;
+    }
+
+    // Write the header for a new journal
+    if (isNewJournal)
+    {
+        journalStream->write(journalMagic, 4);
+        journalStream->writeInt(formatVersion);
+        journalStream->flush();
+    }
+    return true;
+}
+
+// Record layout, all little-endian:
+//   int32 record size (not including itself)
+//   int32 track ID, int64 length in samples, double sample rate,
+//   int32 channels, int32 bits per sample, then the file name, path,
+//   title, artist, album and genre as int32 byte counts and UTF-8 bytes,
+//   then the beatgrid's double BPM and int64 first beat sample.
+void LibraryIndexFile::writeTrackRecord(const MusicTrack& track, juce::OutputStream& output)
+{
+    // Writes a string as a byte count followed by UTF-8 bytes
+    juce::MemoryOutputStream record;
+    auto writeString = [&record](const juce::String& value) {
+        size_t numBytes = value.getNumBytesAsUTF8();
+        record.writeInt((int) numBytes);
+        record.write(value.toRawUTF8(), numBytes);
+    };
+
+    // Encode the record
+    const TrackMetadata& metadata = track.getMetadata();
+    record.writeInt(track.getTrackID());
+    record.writeInt64(metadata.lengthInSamples);
+    record.writeDouble(metadata.sampleRate);
+    record.writeInt(metadata.numChannels);
+    record.writeInt(metadata.bitsPerSample);
+    writeString(track.getFileName());
+    writeString(track.getAudioURL().getLocalFile().getFullPathName());
+    writeString(metadata.title);
+    writeString(metadata.artist);
+    writeString(metadata.album);
+    writeString(metadata.genre);
+    const BeatGrid& beatGrid = track.getBeatGrid();
+    record.writeDouble(beatGrid.bpm);
+    record.writeInt64(beatGrid.firstBeatSample);
+
+    // Write the size-prefixed record to the output
+    output.writeInt((int) record.getDataSize());
+    output.write(record.getData(), record.getDataSize());
+}
+
+bool LibraryIndexFile::readTrackRecord(const void* data, size_t size, std::vector<MusicTrack>& tracks)
+{
+    RecordReader reader{ static_cast<const char*>(data), size };
+
+    // Read the fixed-size fields
+    if (!reader.canRead(28))
+    {
+        return false;
+    }
+    TrackMetadata metadata;
+    int trackID = reader.readInt();
+    metadata.lengthInSamples = reader.readInt64();
+    metadata.sampleRate = reader.readDouble();
+    metadata.numChannels = reader.readInt();
+    metadata.bitsPerSample = reader.readInt();
+
+    // Read the strings
+    juce::String fileName;
+    juce::String path;
+    if (!reader.readString(fileName) || !reader.readString(path)
+        || !reader.readString(metadata.title) || !reader.readString(metadata.artist)
+        || !reader.readString(metadata.album) || !reader.readString(metadata.genre))
+    {
+        return false;
+    }
+
+    // Read the beatgrid. Records written before beatgrids were added end
+    // here, and their tracks have no beatgrid.
+    BeatGrid beatGrid;
+    if (reader.canRead(16))
+    {
+        beatGrid.bpm = reader.readDouble();
+        beatGrid.firstBeatSample = reader.readInt64();
+    }
+
+    // Any fields after these were added by a later version, and are skipped
+    tracks.emplace_back(trackID, fileName, juce::URL{ juce::File{ path } }, metadata, beatGrid);
+    return true;
+}
+
+juce::uint32 LibraryIndexFile::checksum(const void* data, size_t size)
+{
+    const juce::uint8* bytes = static_cast<const juce::uint8*>(data);
+    juce::uint32 hash{ 2166136261u };
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vector>
+#include <JuceHeader.h>
+#include "MusicTrack.h"
+
+
+/**
+ * Stores the music library in a versioned binary index file, with an
+ * append-only journal of the changes made since the index was last written.
+ *
+ * The index is memory-mapped when it is loaded, so startup does not need to
+ * parse text or touch the audio files. Each add, update, remove or clear is
+ * appended to the journal as it happens, so a crash loses at most the change
+ * being written. The journal is folded back into the index by compact().
+ */
+class LibraryIndexFile
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _indexFile   - The file holding the binary track index.
+     * @param _journalFile - The file holding the journal of changes.
+     */
+    LibraryIndexFile(const juce::File& _indexFile, const juce::File& _journalFile);
+
+    /**
+     * Destructor
+     */
+    ~LibraryIndexFile();
+
+    /**
+     * Checks whether an index file or a journal has been written before.
+     *
+     * @return True if either file exists.
+     */
+    bool exists() const;
+
+    /**
+     * Loads the tracks from the index, then replays the journal over them.
+     *
+     * @param tracks - The vector to add the loaded tracks to.
+     * @return True if the index could be read, or if there is no index yet.
+     */
+    bool load(std::vector<MusicTrack>& tracks);
+
+    /**
+     * Appends a newly added track to the journal.
+     *
+     * @param track - The track that was added to the library.
+     */
+    void journalAdd(const MusicTrack& track);
+
+    /**
+     * Appends a change to a track already in the library to the journal,
+     * such as a newly analysed beatgrid.
+     *
+     * @param track - The track as it is now.
+     */
+    void journalUpdate(const MusicTrack& track);
+
+    /**
+     * Appends a track removal to the journal.
+     *
+     * @param trackID - The ID of the track that was removed.
+     */
+    void journalRemove(int trackID);
+
+    /**
+     * Appends the clearing of the whole library to the journal.
+     */
+    void journalClear();
+
+    /**
+     * Gets the number of changes appended to the journal since the index 
+     * was last written.
+     *
+     * @return The number of journal entries.
+     */
+    int getNumJournalEntries() const;
+
+    /**
+     * Writes all the tracks to a new index file, replacing the old index,
+     * and empties the journal. The new index is written to a temporary file 
+     * first, so the old index survives if writing fails.
+     *
+     * @param tracks - All the tracks in the library.
+     * @return True if the index was written.
+     */
+    bool compact(const std::vector<MusicTrack>& tracks);
+
+private:
+    /** The kinds of change recorded in the journal */
+    enum JournalOperation
+    {
+        addOperation = 1,
+        removeOperation = 2,
+        clearOperation = 3,
+        updateOperation = 4
+    };
+
+    /**
+     * Appends an entry to the journal and flushes it to the file.
+     *
+     * @param operation - The kind of change.
+     * @param payload   - The data for the change.
+     */
+    void appendJournalEntry(JournalOperation operation, const juce::MemoryBlock& payload);
+
+    /**
+     * Replays the journal entries over the loaded tracks. Stops at the first
+     * incomplete or corrupt entry, which is where a crash interrupted a write.
+     *
+     * @param tracks - The tracks loaded from the index.
+     */
+    void replayJournal(std::vector<MusicTrack>& tracks);
+
+    /**
+     * Opens the journal for appending, writing its header if it is new.
+     *
+     * @return True if the journal is ready to append to.
+     */
+    bool openJournal();
+
+    /**
+     * Encodes a track as a binary record.
+     *
+     * @param track  - The track to encode.
+     * @param output - The stream to write the record to.
+     */
+    static void writeTrackRecord(const MusicTrack& track, juce::OutputStream& output);
+
+    /**
+     * Decodes a binary track record and adds the track to a vector.
+     *
+     * @param data   - Pointer to the start of the record.
+     * @param size   - The size of the record in bytes.
+     * @param tracks - The vector to add the decoded track to.
+     * @return True if the record was complete.
+     */
+    static bool readTrackRecord(const void* data, size_t size, std::vector<MusicTrack>& tracks);
+
+    /**
+     * Calculates a 32-bit FNV-1a checksum, used to detect torn journal writes.
+     *
+     * @param data - Pointer to the data.
+     * @param size - The size of the data in bytes.
+     * @return The checksum.
+     */
+    static juce::uint32 checksum(const void* data, size_t size);
+
+    // The binary track index
+    juce::File indexFile;
+    // The journal of changes since the index was written
+    juce::File journalFile;
+    // Stream for appending to the journal, opened on the first change
+    std::unique_ptr<juce::FileOutputStream> journalStream;
+    // The number of entries in the journal
+    int numJournalEntries{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryIndexFile)
+};
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <iterator>
+#include <JuceHeader.h>
+#include "LibrarySearchIndex.h"
+
+
+LibrarySearchIndex::LibrarySearchIndex()
+{
+}
+
+LibrarySearchIndex::~LibrarySearchIndex()
+{
+}
+
+void LibrarySearchIndex::addTrack(int trackID, const juce::String& text)
+{
+    // Replace any text already indexed for this track
+    removeTrack(trackID);
+
+    // Store the lower-cased text, for checking candidate matches
+    std::string key = text.toLowerCase().toStdString();
+
+    // Add the track to the list for each of its trigrams
+    for (juce::uint32 trigram : getTrigrams(key))
+    {
+        insertSorted(postings[trigram], trackID);
+    }
+    insertSorted(allTrackIDs, trackID);
+    trackText.emplace(trackID, std::move(key));
+}
+
+void LibrarySearchIndex::removeTrack(int trackID)
+{
+    // Find the track's text
+    auto text = trackText.find(trackID);
+    if (text == trackText.end())
+    {
+        return;
+    }
+
+    // Remove the track from the list for each of its trigrams
+    for (juce::uint32 trigram : getTrigrams(text->second))
+    {
+        auto posting = postings.find(trigram);
+        if (posting != postings.end())
+        {
+            eraseSorted(posting->second, trackID);
+            if (posting->second.empty())
+            {
+                postings.erase(posting);
+            }
+        }
+    }
+    eraseSorted(allTrackIDs, trackID);
+    trackText.erase(text);
+}
+
+void LibrarySearchIndex::clear()
+{
+    trackText.clear();
+    postings.clear();
+    allTrackIDs.clear();
+}
+
+// Terms of three or more bytes narrow the candidates down through their
+// trigram lists, starting with the shortest list. Every candidate is then
+// checked against all terms, since having all the trigrams of a term does 
+// not mean the term itself appears.
+std::vector<int> LibrarySearchIndex::search(const juce::String& query) const
+{
+    // Split the lower-cased query into terms
+    juce::StringArray terms;
+    terms.addTokens(query.toLowerCase(), " \t*?", "");
+    terms.removeEmptyStrings();
+    if (terms.isEmpty())
+    {
+        return allTrackIDs;
+    }
+
+    // Collect the trigram lists for every term
+    std::vector<std::string> keyTerms;
+    std::vector<const std::vector<int>*> lists;
+    for (const juce::String& term : terms)
+    {
+        keyTerms.push_back(term.toStdString());
+        for (juce::uint32 trigram : getTrigrams(keyTerms.back()))
+        {
+            auto posting = postings.find(trigram);
+            if (posting == postings.end())
+            {
+                // No track contains this trigram, so nothing can match
+                return {};
+            }
+            lists.push_back(&posting->second);
+        }
+    }
+
+    // Intersect the lists, shortest first, to get the candidates.
+    // Queries with only short terms have to check every track.
+    std::vector<int> candidates;
+    if (lists.empty())
+    {
+        candidates = allTrackIDs;
+    }
+    else
+    {
+        std::sort(lists.begin(), lists.end(), 
+            [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+        candidates = *lists[0];
+        std::vector<int> intersection;
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+        {
+            intersection.clear();
+            std::set_intersection(candidates.begin(), candidates.end(),
+                                  lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+    }
+
+    // Terms of exactly three bytes are already matched by their trigram list
+    keyTerms.erase(std::remove_if(keyTerms.begin(), keyTerms.end(), 
+        [](const std::string& term) { return term.size() == 3; }), keyTerms.end());
+    if (keyTerms.empty())
+    {
+        return candidates;
+    }
+
+    // Keep the candidates whose text contains every other term
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int trackID) {
+        const std::string& text = trackText.at(trackID);
+        for (const std::string& term : keyTerms)
+        {
+            if (text.find(term) == std::string::npos)
+            {
+                return true;
+            }
+        }
+        return false;
+    }), candidates.end());
+
+    return candidates;
+}
+
+std::vector<juce::uint32> LibrarySearchIndex::getTrigrams(const std::string& text)
+{
+    std::vector<juce::uint32> trigrams;
+    if (text.size() < 3)
+    {
+        return trigrams;
+    }
+
+    // Pack each run of three bytes into an integer
+    trigrams.reserve(text.size() - 2);
+    for (size_t i = 0; i + 2 < text.size(); ++i)
+    {
+        trigrams.push_back(((juce::uint32) (unsigned char) text[i] << 16)
+                         | ((juce::uint32) (unsigned char) text[i + 1] << 8)
+                         | (juce::uint32) (unsigned char) text[i + 2]);
+    }
+
+    // Remove repeats
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+// New tracks get the highest ID so far, so this is usually an append
+void LibrarySearchIndex::insertSorted(std::vector<int>& ids, int trackID)
+{
+    if (ids.empty() || ids.back() < trackID)
+    {
+        ids.push_back(trackID);
+        return;
+    }
+    auto position = std::lower_bound(ids.begin(), ids.end(), trackID);
+    if (position == ids.end() || *position != trackID)
+    {
+        ids.insert(position, trackID);
+    }
+}
+
+void LibrarySearchIndex::eraseSorted(std::vector<int>& ids, int trackID)
+{
+    auto position = std::lower_bound(ids.begin(), ids.end(), trackID);
+    if (position != ids.end() && *position == trackID)
+    {
+        ids.erase(position);
+    }
+}
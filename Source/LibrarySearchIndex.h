@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <JuceHeader.h>
+
+
+/**
+ * A trigram index over the searchable text of each library track, such as 
+ * its file name and tags. Each three-byte sequence of lower-cased text maps 
+ * to a sorted list of the IDs of the tracks that contain it, so a search only
+ * has to intersect a few short lists and check the remaining candidates.
+ * The index is updated incrementally as tracks are added and removed.
+ */
+class LibrarySearchIndex
+{
+public:
+    /** Constructor */
+    LibrarySearchIndex();
+
+    /** Destructor */
+    ~LibrarySearchIndex();
+
+    /**
+     * Adds a track's searchable text to the index.
+     *
+     * @param trackID - The unique ID of the track.
+     * @param text    - The text to search, such as the file name and tags.
+     */
+    void addTrack(int trackID, const juce::String& text);
+
+    /**
+     * Removes a track from the index.
+     *
+     * @param trackID - The unique ID of the track.
+     */
+    void removeTrack(int trackID);
+
+    /**
+     * Removes every track from the index.
+     */
+    void clear();
+
+    /**
+     * Finds the tracks whose text contains every term of the query. Terms are
+     * separated by spaces or by the wildcard characters * and ?, and matching
+     * ignores case.
+     *
+     * @param query - The search query.
+     * @return The IDs of the matching tracks in ascending order. An empty 
+     *     query matches every track.
+     */
+    std::vector<int> search(const juce::String& query) const;
+
+private:
+    /**
+     * Gets the distinct trigrams of a string, packed into integers.
+     *
+     * @param text - The lower-cased text.
+     * @return The sorted, distinct trigrams.
+     */
+    static std::vector<juce::uint32> getTrigrams(const std::string& text);
+
+    /**
+     * Inserts an ID into a sorted list of IDs, if not already there.
+     *
+     * @param ids     - The sorted list.
+     * @param trackID - The ID to insert.
+     */
+    static void insertSorted(std::vector<int>& ids, int trackID);
+
+    /**
+     * Removes an ID from a sorted list of IDs.
+     *
+     * @param ids     - The sorted list.
+     * @param trackID - The ID to remove.
+     */
+    static void eraseSorted(std::vector<int>& ids, int trackID);
+
+    // Lower-cased searchable text for each track ID
+    std::unordered_map<int, std::string> trackText;
+    // Sorted track IDs for each trigram
+    std::unordered_map<juce::uint32, std::vector<int>> postings;
+    // Sorted IDs of every track in the index
+    std::vector<int> allTrackIDs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibrarySearchIndex)
+};
@@ -12,18 +12,49 @@ MainComponent::MainComponent()
         && ! juce::RuntimePermissions::isGranted (juce::RuntimePermissions::recordAudio))
     {
         juce::RuntimePermissions::request (juce::RuntimePermissions::recordAudio,
-                                           [&] (bool granted) { setAudioChannels (granted ? 2 : 0, 2); });
+                                           [&] (bool granted) { setAudioChannels (granted ? 2 : 0, 4); });
     }
     else
     {
-        // Specify the number of input and output channels that we want to open
-        setAudioChannels (0, 2);
+        // Specify the number of input and output channels that we want to open.
+        // Channels 1 and 2 play the master mix, and 3 and 4 the cue bus, if
+        // the device has them.
+        setAudioChannels (0, 4);
     }
 
     // Add components
-    addAndMakeVisible(deckGUI1);            // left deck
-    addAndMakeVisible(deckGUI2);            // right deck
+    addAndMakeVisible(addDeckButton);       // deck buttons
+    addAndMakeVisible(removeDeckButton);
     addAndMakeVisible(playlistComponent);   // playlist 
+    addDeckButton.addListener(this);
+    removeDeckButton.addListener(this);
+
+    // Set up the crossfader, centred, and its curves. Curve item IDs are
+    // the curves, offset by 1, as IDs can't be 0.
+    addAndMakeVisible(crossfaderSlider);
+    addAndMakeVisible(crossfaderCurveBox);
+    crossfaderSlider.setRange(0.0, 1.0);
+    crossfaderSlider.setValue(0.5, juce::dontSendNotification);
+    crossfaderSlider.setDoubleClickReturnValue(true, 0.5);
+    crossfaderCurveBox.addItem("Smooth", static_cast<int>(MixerBus::CrossfaderCurve::smooth) + 1);
+    crossfaderCurveBox.addItem("Linear", static_cast<int>(MixerBus::CrossfaderCurve::linear) + 1);
+    crossfaderCurveBox.addItem("Cut", static_cast<int>(MixerBus::CrossfaderCurve::cut) + 1);
+    crossfaderCurveBox.setSelectedId(static_cast<int>(MixerBus::CrossfaderCurve::smooth) + 1,
+                                     juce::dontSendNotification);
+    crossfaderSlider.addListener(this);
+    crossfaderCurveBox.addListener(this);
+
+    // Set up the split cue toggle
+    addAndMakeVisible(splitCueButton);
+    splitCueButton.addListener(this);
+
+    // Create the starting decks. Each is shown, and has its displays
+    // updated on each screen refresh, as it's added.
+    deckManager.addListener(this);
+    for (int i = 0; i < initialNumDecks; ++i)
+    {
+        deckManager.addDeck();
+    }
 
     // Register basic formats in the formatManager
     formatManager.registerBasicFormats();
@@ -33,37 +64,28 @@ MainComponent::~MainComponent()
 {
     // Shut down the audio device and clears the audio source
     shutdownAudio();
+    // Stop receiving deck notifications
+    deckManager.removeListener(this);
 }
 
 
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
-    // Set up player audio sources
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
-
-    // Set up mixer audio source
-    mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-
-    // Add both players to the mixer audio source
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
+    // Set up the decks
+    deckManager.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    // Mixer source will manage each audio block
-    mixerSource.getNextAudioBlock(bufferToFill);
+    // The deck manager mixes the decks for each audio block
+    deckManager.getNextAudioBlock(bufferToFill);
 }
 
 
 void MainComponent::releaseResources()
 {
-    // Clear player resources
-    mixerSource.removeAllInputs(); 
-    mixerSource.releaseResources();
-    player1.releaseResources();
-    player2.releaseResources();
+    // Clear deck resources
+    deckManager.releaseResources();
 }
 
 
@@ -75,13 +97,102 @@ void MainComponent::paint (juce::Graphics& g)
 
 void MainComponent::resized()
 {
-    // Set bounds on deck GUI components
+    // Set bounds on deck GUI components. Decks are laid out two to a row,
+    // sharing the deck area between the rows.
     int deckHeight = getHeight() * 0.65;
-    deckGUI1.setBounds(0, 0, getWidth()/2, deckHeight);
-    deckGUI2.setBounds(getWidth() / 2, 0, getWidth() / 2, deckHeight);
+    int numDecks = deckManager.getNumDecks();
+    int numRows = juce::jmax(1, (numDecks + 1) / 2);
+    int rowHeight = deckHeight / numRows;
+    for (int i = 0; i < numDecks; ++i)
+    {
+        // A deck alone on the last row takes its full width
+        bool aloneOnRow = i == numDecks - 1 && i % 2 == 0;
+        int deckWidth = aloneOnRow ? getWidth() : getWidth() / 2;
+        deckManager.getDeckGUI(i)->setBounds((i % 2) * (getWidth() / 2), (i / 2) * rowHeight, 
+                                             deckWidth, rowHeight);
+    }
+
+    // Set bounds on deck buttons, in a strip under the decks
+    juce::Rectangle<int> buttonStrip{ 0, deckHeight, getWidth(), deckButtonHeight };
+    addDeckButton.setBounds(buttonStrip.removeFromLeft(120).reduced(2));
+    removeDeckButton.setBounds(buttonStrip.removeFromLeft(120).reduced(2));
+    // Crossfader in the middle of the rest of the strip, its curve at the end
+    crossfaderCurveBox.setBounds(buttonStrip.removeFromRight(120).reduced(2));
+    splitCueButton.setBounds(buttonStrip.removeFromRight(100).reduced(2));
+    crossfaderSlider.setBounds(buttonStrip.withSizeKeepingCentre(buttonStrip.getWidth() / 2, 
+                                                                 buttonStrip.getHeight()));
 
     // Set bounds on playlist component
-    playlistComponent.setBounds(0, deckHeight, getWidth(), getHeight() - deckHeight);
+    int playlistY = deckHeight + deckButtonHeight;
+    playlistComponent.setBounds(0, playlistY, getWidth(), getHeight() - playlistY);
+}
+
+void MainComponent::buttonClicked(juce::Button* button)
+{
+    if (button == &addDeckButton)
+    {
+        deckManager.addDeck();
+    }
+    if (button == &removeDeckButton)
+    {
+        // Remove the last deck
+        deckManager.removeDeck(deckManager.getNumDecks() - 1);
+    }
+    if (button == &splitCueButton)
+    {
+        // Cue in the left ear, master mix in the right
+        deckManager.getMixer().setSplitCue(splitCueButton.getToggleState());
+    }
+}
+
+void MainComponent::sliderValueChanged(juce::Slider* slider)
+{
+    if (slider == &crossfaderSlider)
+    {
+        deckManager.getMixer().setCrossfader(static_cast<float>(slider->getValue()));
+    }
+}
+
+void MainComponent::comboBoxChanged(juce::ComboBox* comboBox)
+{
+    if (comboBox == &crossfaderCurveBox)
+    {
+        // Item IDs are the curves, offset by 1
+        auto curve = static_cast<MixerBus::CrossfaderCurve>(comboBox->getSelectedId() - 1);
+        deckManager.getMixer().setCrossfaderCurve(curve);
+    }
+}
+
+void MainComponent::deckAdded(DeckGUI* deckGUI)
+{
+    // Show the deck, and update its displays on each screen refresh
+    addAndMakeVisible(deckGUI);
+    displayRefreshDriver.addClient(deckGUI);
+    resized();
+
+    // Only allow as many decks as the manager can hold
+    addDeckButton.setEnabled(deckManager.getNumDecks() < DeckManager::maxDecks);
+    removeDeckButton.setEnabled(true);
+}
+
+void MainComponent::deckRemoved(DeckGUI* deckGUI)
+{
+    // Stop updating and showing the deck
+    displayRefreshDriver.removeClient(deckGUI);
+    removeChildComponent(deckGUI);
+
+    // The deck is still counted until it's gone, so lay out and update the
+    // buttons once it has been removed
+    juce::Component::SafePointer<MainComponent> safeThis{ this };
+    juce::MessageManager::callAsync([safeThis]
+    {
+        if (safeThis != nullptr)
+        {
+            safeThis->resized();
+            safeThis->addDeckButton.setEnabled(true);
+            safeThis->removeDeckButton.setEnabled(safeThis->deckManager.getNumDecks() > 0);
+        }
+    });
 }
 
 
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "DJAudioPlayer.h"
-#include "DeckGUI.h"
+#include "DecodedTrackCache.h"
+#include "PersistentThumbnailCache.h"
+#include "DeckManager.h"
 #include "PlaylistComponent.h"
+#include "DisplayRefreshDriver.h"
 
 
-class MainComponent  : public juce::AudioAppComponent
+class MainComponent  : public juce::AudioAppComponent,
+                       public juce::Button::Listener,
+                       public juce::Slider::Listener,
+                       public juce::ComboBox::Listener,
+                       public DeckManager::Listener
 {
 public:
     /** Constructor */
@@ -50,25 +56,77 @@ public:
      */
     void resized() override;
 
+    /**
+     * Implements Button::Listener: Adds or removes a deck, or turns split
+     * cue on or off.
+     *
+     * @param button - The button that was clicked.
+     */
+    void buttonClicked(juce::Button* button) override;
+
+    /**
+     * Implements Slider::Listener: Moves the crossfader.
+     *
+     * @param slider - The slider whose value changed.
+     */
+    void sliderValueChanged(juce::Slider* slider) override;
+
+    /**
+     * Implements ComboBox::Listener: Sets the crossfader curve.
+     *
+     * @param comboBox - The combo box whose selection changed.
+     */
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
+
+    /**
+     * Implements DeckManager::Listener: Shows a new deck.
+     *
+     * @param deckGUI - The new deck's GUI.
+     */
+    void deckAdded(DeckGUI* deckGUI) override;
+
+    /**
+     * Implements DeckManager::Listener: Stops showing a deck that is being
+     * removed.
+     *
+     * @param deckGUI - The GUI of the deck being removed.
+     */
+    void deckRemoved(DeckGUI* deckGUI) override;
+
 private:
     // Shared AudioFormatManager for all audio players and thumbnails
     juce::AudioFormatManager formatManager;
-    // Shared AudioThumbnailCache for all deck waveform AudioThumbnail objects
-    juce::AudioThumbnailCache thumbCache{ 100 };
+    // Shared AudioThumbnailCache for all deck waveform AudioThumbnail objects,
+    // saved to disk so waveforms don't need rebuilding next time
+    PersistentThumbnailCache thumbCache{ formatManager, 100,
+        juce::File::getCurrentWorkingDirectory().getChildFile("thumbnails") };
 
-    // Audio source players
-    DJAudioPlayer player1{ formatManager };
-    DJAudioPlayer player2{ formatManager };
+    // Shared cache of decoded tracks for all audio players
+    DecodedTrackCache trackCache{ formatManager };
 
-    // Mixer audio source to handle combination of deck players
-    juce::MixerAudioSource mixerSource;
+    // The decks, each an audio player with its GUI, and the mix of their output
+    DeckManager deckManager{ formatManager, trackCache, thumbCache };
+    // Number of decks to start with
+    static constexpr int initialNumDecks{ 2 };
 
-    // Deck GUI components
-    DeckGUI deckGUI1{ &player1, formatManager, thumbCache };
-    DeckGUI deckGUI2{ &player2, formatManager, thumbCache };
+    // Buttons for adding and removing decks
+    juce::TextButton addDeckButton{ "Add Deck" };
+    juce::TextButton removeDeckButton{ "Remove Deck" };
+    static constexpr int deckButtonHeight{ 28 };
+
+    // Crossfader and its curve, beside the deck buttons
+    juce::Slider crossfaderSlider{ juce::Slider::SliderStyle::LinearHorizontal,
+                                   juce::Slider::TextEntryBoxPosition::NoTextBox };
+    juce::ComboBox crossfaderCurveBox;
+    // Split cue toggle, for headphones on output channels 3 and 4
+    juce::ToggleButton splitCueButton{ "Split Cue" };
 
     // Track playlist component to display under the deck GUIs
-    PlaylistComponent playlistComponent{ formatManager, &deckGUI1, &deckGUI2 };
+    PlaylistComponent playlistComponent{ formatManager, thumbCache, deckManager };
+
+    // Updates the decks' displays once per screen refresh. Declared after
+    // the decks, so it stops before they are destroyed.
+    DisplayRefreshDriver displayRefreshDriver{ *this };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,369 @@
+#include <cmath>
+#include <JuceHeader.h>
+#include "MixerBus.h"
+
+
+void MixerBus::Channel::setFader(float level)
+{
+    // Make sure the level is in the expected range
+    if (level < 0 || level > 1.0f)
+    {
+        DBG("MixerBus::Channel::setFader: level should be between 0 and 1");
+    }
+    else
+    {
+        // Picked up by the audio thread at the start of the next block
+        fader.store(level, std::memory_order_relaxed);
+    }
+}
+
+void MixerBus::Channel::setTrim(float decibels)
+{
+    // Make sure the trim is in the expected range
+    if (decibels < -12.0f || decibels > 12.0f)
+    {
+        DBG("MixerBus::Channel::setTrim: trim should be between -12 and 12 dB");
+    }
+    else
+    {
+        trimGain.store(juce::Decibels::decibelsToGain(decibels), std::memory_order_relaxed);
+    }
+}
+
+void MixerBus::Channel::setCrossfaderSide(CrossfaderSide side)
+{
+    crossfaderSide.store(static_cast<int>(side), std::memory_order_relaxed);
+}
+
+MixerBus::CrossfaderSide MixerBus::Channel::getCrossfaderSide() const
+{
+    return static_cast<CrossfaderSide>(crossfaderSide.load(std::memory_order_relaxed));
+}
+
+void MixerBus::Channel::setCue(bool shouldCue)
+{
+    cue.store(shouldCue, std::memory_order_relaxed);
+}
+
+juce::AudioBuffer<float>& MixerBus::Channel::getInputBuffer()
+{
+    return inputBuffer;
+}
+
+MixerBus::MixerBus()
+{
+}
+
+MixerBus::~MixerBus()
+{
+}
+
+void MixerBus::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
+{
+    sampleRate = _sampleRate;
+
+    // Allocate the bus, and start the limiter with no gain reduction
+    busBuffer.setSize(numBusChannels, samplesPerBlockExpected);
+    limiter.prepare(sampleRate);
+}
+
+void MixerBus::prepareChannel(Channel& channel)
+{
+    // Stereo, one block long
+    channel.inputBuffer.setSize(2, busBuffer.getNumSamples());
+    channel.inputBuffer.clear();
+
+    // Start the gain ramp at the channel's current gain, ignoring the
+    // crossfader until the first block
+    channel.smoothedGain.reset(sampleRate, gainRampSeconds);
+    channel.smoothedGain.setCurrentAndTargetValue(channel.fader.load(std::memory_order_relaxed)
+                                                  * channel.trimGain.load(std::memory_order_relaxed));
+    channel.smoothedCueGain.reset(sampleRate, gainRampSeconds);
+    channel.smoothedCueGain.setCurrentAndTargetValue(0.0f);
+}
+
+void MixerBus::releaseResources()
+{
+    busBuffer.setSize(0, 0);
+}
+
+void MixerBus::setCrossfader(float position)
+{
+    // Make sure the position is in the expected range
+    if (position < 0 || position > 1.0f)
+    {
+        DBG("MixerBus::setCrossfader: position should be between 0 and 1");
+    }
+    else
+    {
+        crossfader.store(position, std::memory_order_relaxed);
+    }
+}
+
+void MixerBus::setCrossfaderCurve(CrossfaderCurve curve)
+{
+    crossfaderCurve.store(static_cast<int>(curve), std::memory_order_relaxed);
+}
+
+void MixerBus::setSplitCue(bool shouldSplit)
+{
+    splitCueEnabled.store(shouldSplit, std::memory_order_relaxed);
+}
+
+// Sums the channels into the bus, limits it, then copies it to the output.
+// The cue bus is only mixed when the output has channels for it.
+void MixerBus::process(Channel* const* channels, int numChannels, const juce::AudioSourceChannelInfo& output)
+{
+    int numSamples = output.numSamples;
+    jassert(numSamples <= busBuffer.getNumSamples());
+
+    // Work out the crossfader's gain for each side once for the block
+    float position = crossfader.load(std::memory_order_relaxed);
+    auto curve = static_cast<CrossfaderCurve>(crossfaderCurve.load(std::memory_order_relaxed));
+    float leftGain = getCrossfaderGain(1.0f - position, curve);
+    float rightGain = getCrossfaderGain(position, curve);
+
+    // Sum the channels, each with its fader, trim and crossfader gain
+    // combined into one
+    for (int i = 0; i < numChannels; ++i)
+    {
+        Channel& channel = *channels[i];
+        float gain = channel.fader.load(std::memory_order_relaxed)
+                   * channel.trimGain.load(std::memory_order_relaxed);
+        switch (channel.getCrossfaderSide())
+        {
+            case CrossfaderSide::left:  gain *= leftGain;  break;
+            case CrossfaderSide::right: gain *= rightGain; break;
+            case CrossfaderSide::through: break;
+        }
+        addChannel(channel, gain, numSamples, i == 0);
+    }
+    if (numChannels == 0)
+    {
+        busBuffer.clear(masterLeft, 0, numSamples);
+        busBuffer.clear(masterRight, 0, numSamples);
+    }
+
+    // Keep the mix under full scale
+    limiter.process(busBuffer.getWritePointer(masterLeft), busBuffer.getWritePointer(masterRight), numSamples);
+
+    // Sum the cued channels, pre-fader, into the cue bus
+    juce::AudioBuffer<float>& outputBuffer = *output.buffer;
+    bool cueOutput = outputBuffer.getNumChannels() >= numBusChannels;
+    bool anyCued = false;
+    for (int i = 0; i < numChannels; ++i)
+    {
+        if (cueOutput)
+        {
+            anyCued = addCueChannel(*channels[i], numSamples, !anyCued) || anyCued;
+        }
+        else
+        {
+            // Keep the cue ramp in step with the audio
+            channels[i]->smoothedCueGain.skip(numSamples);
+        }
+    }
+    if (cueOutput)
+    {
+        if (!anyCued)
+        {
+            busBuffer.clear(cueLeft, 0, numSamples);
+            busBuffer.clear(cueRight, 0, numSamples);
+        }
+        if (splitCueEnabled.load(std::memory_order_relaxed))
+        {
+            splitCue(numSamples);
+        }
+    }
+
+    // Copy the bus to the output, mixing down to mono if there's only one
+    // output channel. Output channels map straight onto bus channels, and
+    // any the bus isn't filling, including a lone third channel with no
+    // room for the cue bus, are silenced.
+    if (outputBuffer.getNumChannels() == 1)
+    {
+        float* destination = outputBuffer.getWritePointer(0, output.startSample);
+        juce::FloatVectorOperations::copyWithMultiply(destination, busBuffer.getReadPointer(masterLeft), 0.5f, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(destination, busBuffer.getReadPointer(masterRight), 0.5f, numSamples);
+    }
+    else
+    {
+        int numFilledChannels = cueOutput ? numBusChannels : cueLeft;
+        for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+        {
+            if (channel < numFilledChannels)
+            {
+                outputBuffer.copyFrom(channel, output.startSample, busBuffer, channel, 0, numSamples);
+            }
+            else
+            {
+                outputBuffer.clear(channel, output.startSample, numSamples);
+            }
+        }
+    }
+}
+
+float MixerBus::getCrossfaderGain(float position, CrossfaderCurve curve)
+{
+    switch (curve)
+    {
+        case CrossfaderCurve::smooth:
+            // Quarter sine, so the two sides' powers always add up to 1
+            return std::sin(position * juce::MathConstants<float>::halfPi);
+        case CrossfaderCurve::linear:
+            return position;
+        case CrossfaderCurve::cut:
+            // Full level except in a narrow fade at the far end
+            return juce::jmin(1.0f, position / cutCurveWidth);
+    }
+    return 1.0f;
+}
+
+// The channel's fader, trim and crossfader gains are applied as one gain,
+// so each side of the channel is scaled and summed in a single pass
+void MixerBus::addChannel(Channel& channel, float gain, int numSamples, bool first)
+{
+    channel.smoothedGain.setTargetValue(gain);
+    float startGain = channel.smoothedGain.getCurrentValue();
+    float endGain = channel.smoothedGain.skip(numSamples);
+
+    addToBus(masterLeft, channel.inputBuffer.getReadPointer(0), numSamples, startGain, endGain, first);
+    addToBus(masterRight, channel.inputBuffer.getReadPointer(1), numSamples, startGain, endGain, first);
+}
+
+// The cue is taken before the fader and crossfader, so only the trim
+// applies. A channel that isn't cued and has finished fading out is
+// skipped without touching its buffer.
+bool MixerBus::addCueChannel(Channel& channel, int numSamples, bool first)
+{
+    bool cued = channel.cue.load(std::memory_order_relaxed);
+    channel.smoothedCueGain.setTargetValue(cued ? channel.trimGain.load(std::memory_order_relaxed) : 0.0f);
+    float startGain = channel.smoothedCueGain.getCurrentValue();
+    float endGain = channel.smoothedCueGain.skip(numSamples);
+    if (startGain == 0 && endGain == 0)
+    {
+        return false;
+    }
+
+    addToBus(cueLeft, channel.inputBuffer.getReadPointer(0), numSamples, startGain, endGain, first);
+    addToBus(cueRight, channel.inputBuffer.getReadPointer(1), numSamples, startGain, endGain, first);
+    return true;
+}
+
+// Replacing the bus channel's contents saves clearing it first. The gain is
+// only ramped per sample while it's changing, otherwise the whole range is
+// scaled and summed in one vectorised call.
+void MixerBus::addToBus(int busChannel, const float* source, int numSamples,
+                        float startGain, float endGain, bool first)
+{
+    if (startGain != endGain)
+    {
+        if (first)
+        {
+            busBuffer.copyFromWithRamp(busChannel, 0, source, numSamples, startGain, endGain);
+        }
+        else
+        {
+            busBuffer.addFromWithRamp(busChannel, 0, source, numSamples, startGain, endGain);
+        }
+    }
+    else if (first)
+    {
+        juce::FloatVectorOperations::copyWithMultiply(busBuffer.getWritePointer(busChannel), source, 
+                                                      endGain, numSamples);
+    }
+    else
+    {
+        juce::FloatVectorOperations::addWithMultiply(busBuffer.getWritePointer(busChannel), source, 
+                                                     endGain, numSamples);
+    }
+}
+
+void MixerBus::splitCue(int numSamples)
+{
+    // Cue in mono on the left
+    juce::FloatVectorOperations::add(busBuffer.getWritePointer(cueLeft), busBuffer.getReadPointer(cueRight), numSamples);
+    juce::FloatVectorOperations::multiply(busBuffer.getWritePointer(cueLeft), 0.5f, numSamples);
+    // Master mix in mono on the right
+    juce::FloatVectorOperations::copyWithMultiply(busBuffer.getWritePointer(cueRight), 
+                                                  busBuffer.getReadPointer(masterLeft), 0.5f, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(busBuffer.getWritePointer(cueRight), 
+                                                 busBuffer.getReadPointer(masterRight), 0.5f, numSamples);
+}
+
+void MixerBus::Limiter::prepare(double sampleRate)
+{
+    lookahead = juce::jmax(1, juce::roundToInt(sampleRate * limiterLookaheadSeconds));
+    releaseCoefficient = static_cast<float>(1.0 - std::exp(-1.0 / (sampleRate * limiterReleaseSeconds)));
+
+    // Start with silence waiting to play, and no gain reduction
+    delay.setSize(2, lookahead);
+    delay.clear();
+    gainHistory.assign(static_cast<size_t>(lookahead), 1.0f);
+    gainSum = lookahead;
+    position = 0;
+
+    // The window holds one more sample than the look-ahead, so it covers
+    // every gain averaged into a sample's output gain
+    heldGains.assign(static_cast<size_t>(lookahead + 1), 1.0f);
+    heldTimes.assign(static_cast<size_t>(lookahead + 1), 0);
+    heldStart = 0;
+    numHeld = 0;
+    sampleCount = 0;
+    envelope = 1.0f;
+}
+
+// A sample's output gain is the average of the gains for the look-ahead
+// after it arrives. Each of those is at most the smallest gain needed in
+// the window before it, which includes the sample, so the sample always
+// plays under the ceiling.
+void MixerBus::Limiter::process(float* left, float* right, int numSamples)
+{
+    float* delayLeft = delay.getWritePointer(0);
+    float* delayRight = delay.getWritePointer(1);
+    int windowSize = lookahead + 1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // The gain this sample needs to stay under the ceiling
+        float peak = juce::jmax(std::abs(left[i]), std::abs(right[i]));
+        float gainNeeded = peak > limiterCeiling ? limiterCeiling / peak : 1.0f;
+
+        // Hold the smallest gain needed in the window. The gain that has
+        // just left the window is dropped, and so are larger gains held
+        // from earlier, which can never be the smallest again.
+        if (numHeld > 0 && sampleCount - heldTimes[static_cast<size_t>(heldStart)] > static_cast<juce::uint32>(lookahead))
+        {
+            heldStart = (heldStart + 1) % windowSize;
+            --numHeld;
+        }
+        while (numHeld > 0 && heldGains[static_cast<size_t>((heldStart + numHeld - 1) % windowSize)] >= gainNeeded)
+        {
+            --numHeld;
+        }
+        int end = (heldStart + numHeld) % windowSize;
+        heldGains[static_cast<size_t>(end)] = gainNeeded;
+        heldTimes[static_cast<size_t>(end)] = sampleCount;
+        ++numHeld;
+        float heldGain = heldGains[static_cast<size_t>(heldStart)];
+
+        // Drop to the held gain straight away, and recover from it gradually
+        envelope = heldGain < envelope ? heldGain : envelope + (heldGain - envelope) * releaseCoefficient;
+
+        // Average the gain over the look-ahead, so it ramps into each peak
+        gainSum += envelope - gainHistory[static_cast<size_t>(position)];
+        gainHistory[static_cast<size_t>(position)] = envelope;
+        float gain = juce::jmin(1.0f, static_cast<float>(gainSum / lookahead));
+
+        // Play the sample from a look-ahead ago, and keep this one
+        float delayedLeft = delayLeft[position];
+        float delayedRight = delayRight[position];
+        delayLeft[position] = left[i];
+        delayRight[position] = right[i];
+        left[i] = delayedLeft * gain;
+        right[i] = delayedRight * gain;
+
+        position = position + 1 < lookahead ? position + 1 : 0;
+        ++sampleCount;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <JuceHeader.h>
+
+
+/**
+ * The mixer stage between the decks and the output. Each deck plays into a
+ * mixer channel with its own fader and trim, and can be assigned to either
+ * side of a crossfader. The channels are summed into a stereo bus, which is
+ * run through a look-ahead limiter before it reaches the output.
+ *
+ * Any channel can also be sent to the cue bus, for listening to it on
+ * headphones before it is brought into the mix. The cue bus is taken
+ * before the fader, straight from the channel's input buffer, and plays on
+ * output channels 3 and 4 alongside the master mix on 1 and 2. In split
+ * cue mode, the cue plays in the left ear and the master mix in the right,
+ * both in mono.
+ *
+ * Each channel's fader, trim and crossfader gains are combined into one
+ * gain, so summing and gain are applied in a single vectorised pass per
+ * channel over preallocated buffers. Gain changes are ramped across a
+ * block to avoid zipper noise.
+ *
+ * The setters are called from the message thread and publish their values
+ * through atomics, which the audio thread picks up at the start of a block.
+ */
+class MixerBus
+{
+public:
+    /** How the crossfader fades between its two sides. */
+    enum class CrossfaderCurve
+    {
+        smooth,     // Constant power, so the level holds steady across the fade
+        linear,     // Straight line, dipping in the middle
+        cut         // Both sides at full level until the fader nears either end, for scratching
+    };
+
+    /** Which side of the crossfader a channel is on. */
+    enum class CrossfaderSide
+    {
+        left,
+        through,    // Not affected by the crossfader
+        right
+    };
+
+    /** One deck's input to the mixer. */
+    class Channel
+    {
+    public:
+        /**
+         * Sets the channel fader.
+         *
+         * @param level - The fader level, as a gain between 0 and 1.
+         */
+        void setFader(float level);
+
+        /**
+         * Sets the channel trim, for matching the level of tracks.
+         *
+         * @param decibels - The trim, between -12 and 12 dB.
+         */
+        void setTrim(float decibels);
+
+        /**
+         * Sets which side of the crossfader the channel is on.
+         *
+         * @param side - The crossfader side.
+         */
+        void setCrossfaderSide(CrossfaderSide side);
+
+        /**
+         * Gets which side of the crossfader the channel is on.
+         *
+         * @return The crossfader side.
+         */
+        CrossfaderSide getCrossfaderSide() const;
+
+        /**
+         * Sends the channel to the cue bus or takes it off.
+         *
+         * @param shouldCue - True to hear the channel on the cue bus.
+         */
+        void setCue(bool shouldCue);
+
+        /**
+         * Gets the buffer the channel's audio is rendered into before it is
+         * mixed. Stereo, and as long as the mixer's prepared block size.
+         *
+         * @return The channel's input buffer.
+         */
+        juce::AudioBuffer<float>& getInputBuffer();
+
+    private:
+        friend class MixerBus;
+
+        // Settings last set by the user
+        std::atomic<float> fader{ 1.0f };
+        std::atomic<float> trimGain{ 1.0f };
+        std::atomic<int> crossfaderSide{ static_cast<int>(CrossfaderSide::through) };
+        std::atomic<bool> cue{ false };
+        // The channel's audio for the current block
+        juce::AudioBuffer<float> inputBuffer;
+        // The channel's total gain into the master mix and the cue bus,
+        // ramped by the audio thread
+        juce::SmoothedValue<float> smoothedGain{ 1.0f };
+        juce::SmoothedValue<float> smoothedCueGain{ 0.0f };
+    };
+
+    /** Constructor */
+    MixerBus();
+
+    /** Destructor */
+    ~MixerBus();
+
+    /**
+     * Prepares the mixer to play. Channels must be prepared separately.
+     *
+     * @param samplesPerBlockExpected - The longest block the mixer processes.
+     * @param sampleRate - The sample rate of the output.
+     */
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+
+    /**
+     * Prepares a channel to play, allocating its input buffer. Call after
+     * prepareToPlay(), and before the channel is first mixed.
+     *
+     * @param channel - The channel to prepare.
+     */
+    void prepareChannel(Channel& channel);
+
+    /**
+     * Releases the mixer's buffers after playback has stopped.
+     */
+    void releaseResources();
+
+    /**
+     * Sets the crossfader position.
+     *
+     * @param position - The position, from 0 (fully left) to 1 (fully right).
+     */
+    void setCrossfader(float position);
+
+    /**
+     * Sets how the crossfader fades between its sides.
+     *
+     * @param curve - The crossfader curve.
+     */
+    void setCrossfaderCurve(CrossfaderCurve curve);
+
+    /**
+     * Turns split cue on or off. With split cue on, the cue outputs play the
+     * cue bus in the left ear and the master mix in the right.
+     *
+     * @param shouldSplit - True to turn split cue on.
+     */
+    void setSplitCue(bool shouldSplit);
+
+    /**
+     * Mixes the channels' input buffers into the output. Only called on the
+     * audio thread.
+     *
+     * @param channels    - The channels to mix.
+     * @param numChannels - The number of channels.
+     * @param output      - The section of the output buffer to fill. No
+     *     longer than the prepared block size. The master mix plays on the
+     *     first two channels, and the cue bus on the next two, if there are
+     *     any.
+     */
+    void process(Channel* const* channels, int numChannels, const juce::AudioSourceChannelInfo& output);
+
+private:
+    /**
+     * A look-ahead peak limiter for the master mix. The mix is delayed by a
+     * short look-ahead, so the gain can start coming down before a peak
+     * arrives and reach the level needed just as it plays. The gain is
+     * worked out sample by sample, so it ramps smoothly whatever the block
+     * size, and recovers at a steady rate once the peak has passed.
+     *
+     * Each sample's gain is the smallest gain needed anywhere in the
+     * look-ahead window, followed by the release, then averaged over the
+     * window. Every gain in the average is low enough for the peak, so the
+     * output never goes over the ceiling.
+     */
+    class Limiter
+    {
+    public:
+        /**
+         * Allocates the limiter's buffers and clears its state.
+         *
+         * @param sampleRate - The sample rate of the output.
+         */
+        void prepare(double sampleRate);
+
+        /**
+         * Limits a stereo block in place. Only called on the audio thread.
+         *
+         * @param left       - The left channel.
+         * @param right      - The right channel.
+         * @param numSamples - The number of samples to limit.
+         */
+        void process(float* left, float* right, int numSamples);
+
+    private:
+        // Length of the look-ahead, in samples
+        int lookahead{ 0 };
+        // The last look-ahead of input, waiting to be played
+        juce::AudioBuffer<float> delay;
+        // The last look-ahead of gains, and their sum, for the average
+        std::vector<float> gainHistory;
+        double gainSum{ 0 };
+        // Where the next sample goes in delay and gainHistory
+        int position{ 0 };
+        // Gains needed over the window, and when each was needed, kept in
+        // rising order of gain so the smallest is at the front
+        std::vector<float> heldGains;
+        std::vector<juce::uint32> heldTimes;
+        int heldStart{ 0 };
+        int numHeld{ 0 };
+        // Number of samples processed, for expiring held gains
+        juce::uint32 sampleCount{ 0 };
+        // The gain after the release
+        float envelope{ 1.0f };
+        // How far the gain recovers towards the held gain per sample
+        float releaseCoefficient{ 0 };
+    };
+
+    /** The channels of the bus buffer, in the order they are sent to the output. */
+    enum BusChannel
+    {
+        masterLeft,
+        masterRight,
+        cueLeft,
+        cueRight,
+        numBusChannels
+    };
+
+    /**
+     * Gets the gain for one side of the crossfader.
+     *
+     * @param position - How far the crossfader is towards the side, from 0 to 1.
+     * @param curve    - The crossfader curve.
+     * @return The side's gain.
+     */
+    static float getCrossfaderGain(float position, CrossfaderCurve curve);
+
+    /**
+     * Adds a channel's input into the bus, with its gain ramped across the
+     * block.
+     *
+     * @param channel    - The channel to add.
+     * @param gain       - The channel's target gain.
+     * @param numSamples - The number of samples to add.
+     * @param first      - True if this is the first channel, so it replaces
+     *     the bus's contents instead of adding to them.
+     */
+    void addChannel(Channel& channel, float gain, int numSamples, bool first);
+
+    /**
+     * Adds a channel's input into the cue bus, if it's cued, with its cue
+     * gain ramped across the block.
+     *
+     * @param channel    - The channel to add.
+     * @param numSamples - The number of samples to add.
+     * @param first      - True if nothing has been added to the cue bus yet,
+     *     so it replaces the cue bus's contents instead of adding to them.
+     * @return True if anything was added.
+     */
+    bool addCueChannel(Channel& channel, int numSamples, bool first);
+
+    /**
+     * Adds a range of a source into a bus channel, with a gain ramp.
+     *
+     * @param busChannel - The bus channel to add to.
+     * @param source     - The samples to add.
+     * @param numSamples - The number of samples to add.
+     * @param startGain  - The gain at the start of the range.
+     * @param endGain    - The gain at the end of the range.
+     * @param first      - True to replace the bus channel's contents.
+     */
+    void addToBus(int busChannel, const float* source, int numSamples,
+                  float startGain, float endGain, bool first);
+
+    /**
+     * Folds the cue bus and master mix into mono, with the cue on the left
+     * and the master mix on the right.
+     *
+     * @param numSamples - The number of samples to fold.
+     */
+    void splitCue(int numSamples);
+
+    // Settings last set by the user
+    std::atomic<float> crossfader{ 0.5f };
+    std::atomic<int> crossfaderCurve{ static_cast<int>(CrossfaderCurve::smooth) };
+    std::atomic<bool> splitCueEnabled{ false };
+
+    // The master mix and cue bus, in the BusChannel layout
+    juce::AudioBuffer<float> busBuffer;
+    double sampleRate{ 0 };
+
+    // Keeps the master mix under full scale
+    Limiter limiter;
+
+    // How long channel gain changes are ramped over, in seconds
+    static constexpr double gainRampSeconds{ 0.02 };
+    // Width of the cut curve's fade at each end of the crossfader
+    static constexpr float cutCurveWidth{ 0.05f };
+    // Highest level the limiter lets through, just under full scale
+    static constexpr float limiterCeiling{ 0.98f };
+    // Time constant of the limiter's recovery after a peak, in seconds
+    static constexpr double limiterReleaseSeconds{ 0.1 };
+    // How far ahead the limiter looks for peaks, in seconds. Delays the
+    // master mix by this much.
+    static constexpr double limiterLookaheadSeconds{ 0.0015 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MixerBus)
+};
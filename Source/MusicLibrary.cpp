@@ -2,29 +2,62 @@
 #include "MusicLibrary.h"
 
 
-MusicLibrary::MusicLibrary(juce::AudioFormatManager& _formatManager)
-    : sourceReader{ _formatManager }
+MusicLibrary::MusicLibrary(juce::AudioFormatManager& _formatManager, PersistentThumbnailCache& _thumbCache)
+    : formatManager{ _formatManager },
+      thumbCache{ _thumbCache }
 {
-    // Load any previously saved library CSV file
-    loadLibrary();
+    if (libraryIndex.exists())
+    {
+        // Load the binary library index and replay its journal
+        libraryIndex.load(libraryTracks);
+    }
+    else if (tracksFile.exists())
+    {
+        // Move a library saved as CSV by an earlier version to the index
+        readCSV(tracksFile, libraryTracks);
+        libraryIndex.compact(libraryTracks);
+    }
+
+    // Build the lookup table for the loaded tracks
+    rebuildTrackSlots();
 
     // Initialise the trackID counter
-    // If tracks loaded from the saved library, it starts at the last known ID
-    if (!libraryTracks.empty())
+    // If tracks loaded from the saved library, it starts at the highest known ID
+    for (const MusicTrack& track : libraryTracks)
     {
-        int lastID = libraryTracks[libraryTracks.size() - 1].getTrackID();
-        trackIDCount = lastID;
+        trackIDCount = std::max(trackIDCount, track.getTrackID());
     }
+
+    // Clear out thumbnails left behind by removed and edited tracks
+    juce::Array<juce::File> files;
+    for (const MusicTrack& track : libraryTracks)
+    {
+        files.add(track.getAudioURL().getLocalFile());
+    }
+    importPool.addJob([this, files] { removeStaleThumbnails(files); });
 }
 
 MusicLibrary::~MusicLibrary()
 {
-    // Save the library playlist to CSV
-    saveLibrary();
+    // Stop any running import. Jobs that are still running may queue more
+    // before they see the flag, so keep clearing the pool until it's empty.
+    importCancelled = true;
+    while (importPool.getNumJobs() > 0)
+    {
+        importPool.removeAllJobs(true, 10000);
+    }
+
+    // Keep the tracks probed so far, without starting to analyse them
+    cancelPendingUpdate();
+    addImportResults(false);
+
+    // Every change is already in the journal, so the index only needs
+    // rewriting if the journal has grown long
+    compactIndexIfNeeded();
 }
 
 
-std::vector<MusicTrack> MusicLibrary::getTracks()
+const std::vector<MusicTrack>& MusicLibrary::getTracks() const
 {
     // Return the full library of tracks
     return libraryTracks;
@@ -32,22 +65,12 @@ std::vector<MusicTrack> MusicLibrary::getTracks()
 
 // Called when a track is being loaded to a deck from the playlist. 
 // If the track is not found for some reason, throws an exception.
-MusicTrack MusicLibrary::getTrack(int _trackID)
+const MusicTrack& MusicLibrary::getTrack(int _trackID) const
 {
-    // Initialize a MusicTrack pointer to nullptr, in the event the track is not found
-    const MusicTrack* matchedTrack{ nullptr };
-    
-    // Search the music library for the track with the right ID
-    for (const MusicTrack& track : libraryTracks)
-    {
-        if (track.getTrackID() == _trackID)
-        {
-            // assign the pointer to the track
-            matchedTrack = &track;      
-        }
-    }
+    // Look up the track's slot by its ID
+    const MusicTrack* matchedTrack = findTrack(_trackID);
     
-    // If still nullptr, no match was found
+    // If nullptr, no match was found
     if (matchedTrack == nullptr)
     {
         throw std::invalid_argument{ "Track could not be found" };
@@ -57,6 +80,17 @@ MusicTrack MusicLibrary::getTrack(int _trackID)
     return *matchedTrack;
 }
 
+const MusicTrack* MusicLibrary::findTrack(int _trackID) const
+{
+    // Look up the track's slot in the table
+    auto slot = trackSlots.find(_trackID);
+    if (slot == trackSlots.end())
+    {
+        return nullptr;
+    }
+    return &libraryTracks[slot->second];
+}
+
 void MusicLibrary::addTrack(const juce::URL& audioURL)
 {
     // Get the next trackID number and increment the counter
@@ -65,131 +99,521 @@ void MusicLibrary::addTrack(const juce::URL& audioURL)
     // Get the filename from the URL
     juce::String fileName = audioURL.getFileName();
 
-    // Read the URL into the audio source reader and get its length
-    sourceReader.loadURL(audioURL);
-    std::string length{ sourceReader.getTrackLength() };
+    // Read the track info from the file header
+    TrackMetadata metadata;
+    if (!metadataProber.probe(audioURL.getLocalFile(), metadata))
+    {
+        DBG("Could not read the track info. File: " + fileName);
+    }
 
-    // Create a new track object and add to the libraryTracks vector
-    MusicTrack track{ trackID, fileName, audioURL, length };
-    libraryTracks.push_back(track);
+    // Create a new track object and add it to the library
+    insertTrack({ trackID, fileName, audioURL, metadata });
+
+    // Find its tempo and beats in the background
+    juce::File file = audioURL.getLocalFile();
+    importPool.addJob([this, trackID, file] { analyseImportFile(trackID, file); });
+}
+
+// Starts a background import. Folders are expanded on a worker thread, 
+// then each audio file is probed as a separate job so the pool can spread
+// the header reads over all its threads.
+void MusicLibrary::importFiles(const juce::Array<juce::File>& filesOrFolders)
+{
+    // Reset the progress counters if the previous import has finished
+    if (!isImporting())
+    {
+        importFilesFound = 0;
+        importFilesProbed = 0;
+        importTracksAdded = 0;
+    }
+    importNotifyPending = true;
+
+    // Scan the selection for audio files in the background
+    ++importScansPending;
+    importPool.addJob([this, filesOrFolders] { scanImportFiles(filesOrFolders); });
+}
+
+bool MusicLibrary::isImporting() const
+{
+    return importScansPending > 0 || importFilesProbed < importFilesFound;
 }
 
-// Removes a track from the music library.
-// Method from https://stackoverflow.com/questions/8628951/remove-elements-of-a-vector-inside-the-loop
+void MusicLibrary::addListener(Listener* listener)
+{
+    listeners.add(listener);
+}
+
+void MusicLibrary::removeListener(Listener* listener)
+{
+    listeners.remove(listener);
+}
+
+// Removes a track from the music library in constant time. The last track
+// is moved into the removed track's slot, so no other tracks have to shift.
 void MusicLibrary::removeTrack(int _trackID)
 {
-    if (!libraryTracks.empty())
+    // Look up the track's slot by its ID
+    auto slot = trackSlots.find(_trackID);
+    if (slot == trackSlots.end())
     {
-        // loop over the libraryTracks vector and check if the trackID matches
-        for (int i = libraryTracks.size() - 1; i >= 0; i--)
-        {
-            if (libraryTracks.at(i).getTrackID() == _trackID)
-            {
-                // erase the track using an iterator to this position
-                libraryTracks.erase(libraryTracks.begin() + i);
-                break;
-            }
-        }
+        return;
     }
+    size_t removedSlot = slot->second;
+    trackSlots.erase(slot);
+
+    // Move the last track into the freed slot and update its lookup entry
+    if (removedSlot != libraryTracks.size() - 1)
+    {
+        libraryTracks[removedSlot] = std::move(libraryTracks.back());
+        trackSlots[libraryTracks[removedSlot].getTrackID()] = removedSlot;
+    }
+    libraryTracks.pop_back();
+
+    // Remove the track from the search index
+    if (searchIndexBuilt)
+    {
+        searchIndex.removeTrack(_trackID);
+    }
+
+    // Record the removal in the journal
+    libraryIndex.journalRemove(_trackID);
 }
 
 void MusicLibrary::clearLibrary()
 {
     // Remove all tracks from the library
     libraryTracks.clear();
+    trackSlots.clear();
+    searchIndex.clear();
+    libraryIndex.journalClear();
 }
 
-// Returns a vector of tracks which contain the keyword in their filename
-// The keyword is treated as a wildcard pattern
-std::vector<MusicTrack> MusicLibrary::searchLibrary(juce::String& keyword)
+// Returns the IDs of the tracks which contain the keyword in their file name 
+// or tags. The search index is built here the first time it is needed.
+std::vector<int> MusicLibrary::searchLibrary(const juce::String& keyword)
 {
-    // Convert keyword to a wildcard pattern
-    keyword = "*" + keyword + "*";
-    juce::StringRef pattern{ keyword };
+    // Build the search index from the whole library
+    if (!searchIndexBuilt)
+    {
+        for (const MusicTrack& track : libraryTracks)
+        {
+            searchIndex.addTrack(track.getTrackID(), getSearchText(track));
+        }
+        searchIndexBuilt = true;
+    }
 
-    // Set up an empty vector of matching tracks to return
-    std::vector<MusicTrack> matchedTracks;
+    // Look up the matching tracks in the index
+    return searchIndex.search(keyword);
+}
 
-    // Add any tracks that contain the keyword pattern
-    for (const MusicTrack& track : libraryTracks)
+// Called on the message thread after worker threads have queued probed tracks.
+void MusicLibrary::handleAsyncUpdate()
+{
+    // Read the progress before taking the queue. Workers queue a track before
+    // counting it as probed, so every counted track is already in the queue.
+    int tracksProcessed = importFilesProbed;
+    int tracksTotal = importFilesFound;
+    bool importing = isImporting();
+
+    // Add the queued tracks and store the beatgrids found so far
+    if (addImportResults(true))
+    {
+        listeners.call([](Listener& l) { l.beatGridsChanged(); });
+    }
+
+    // Let listeners know how far the import has got. Beat analysis carries
+    // on after the import has finished, and doesn't count towards it.
+    if (importNotifyPending)
+    {
+        listeners.call([=](Listener& l) { l.importProgressChanged(tracksProcessed, tracksTotal); });
+    }
+
+    // Let listeners know once every file has been processed
+    if (!importing && importNotifyPending)
+    {
+        importNotifyPending = false;
+        compactIndexIfNeeded();
+        int tracksAdded = importTracksAdded;
+        listeners.call([=](Listener& l) { l.importFinished(tracksAdded); });
+    }
+}
+
+// Tracks are given their IDs here so that the ID counter is only ever 
+// touched by the message thread.
+bool MusicLibrary::addImportResults(bool queueAnalysis)
+{
+    // Take the queued tracks and beatgrids while holding the lock as briefly
+    // as possible. Tracks are only analysed once they have an ID, so every
+    // beatgrid taken is for a track already in the library, unless it has
+    // been removed since.
+    std::vector<ProbedTrack> newTracks;
+    std::vector<AnalysedTrack> newBeatGrids;
     {
-        if (track.getFileName().matchesWildcard(pattern, true))
+        const juce::ScopedLock lock{ probedTracksLock };
+        newTracks.swap(probedTracks);
+        newBeatGrids.swap(analysedTracks);
+    }
+
+    // Add each probed track to the library, then find its beats in the
+    // background
+    for (ProbedTrack& probedTrack : newTracks)
+    {
+        int trackID = ++trackIDCount;
+        insertTrack({ trackID, probedTrack.fileName, 
+                      probedTrack.audioURL, probedTrack.metadata });
+
+        if (queueAnalysis)
         {
-            matchedTracks.push_back(track);
+            juce::File file = probedTrack.audioURL.getLocalFile();
+            importPool.addJob([this, trackID, file] { analyseImportFile(trackID, file); });
         }
     }
-    return matchedTracks;
+    importTracksAdded += (int) newTracks.size();
+
+    // Store the beatgrids with their tracks
+    if (newBeatGrids.empty())
+    {
+        return false;
+    }
+    storeBeatGrids(newBeatGrids);
+    return true;
 }
 
-void MusicLibrary::saveLibrary()
+// Runs on a worker thread. Expands folders recursively and queues a probe 
+// job for every supported audio file that was found.
+void MusicLibrary::scanImportFiles(const juce::Array<juce::File>& filesOrFolders)
 {
-    // Create the CSV file if not already done
-    tracksFile.create();
+    for (const juce::File& fileOrFolder : filesOrFolders)
+    {
+        // Collect the audio files for this entry
+        juce::Array<juce::File> audioFiles;
+        if (fileOrFolder.isDirectory())
+        {
+            audioFiles = fileOrFolder.findChildFiles(juce::File::findFiles, true,
+                formatManager.getWildcardForAllFormats());
+        }
+        else if (isSupportedAudioFile(fileOrFolder))
+        {
+            audioFiles.add(fileOrFolder);
+        }
 
-    // Convert file to an output stream to write to
-    juce::FileOutputStream output{ tracksFile };
-    if (output.openedOk()) // File opened successfully
+        // Stop queuing work once the library is closing
+        if (importCancelled)
+        {
+            break;
+        }
+
+        // Queue a probe job for each audio file
+        importFilesFound += audioFiles.size();
+        for (const juce::File& audioFile : audioFiles)
+        {
+            importPool.addJob([this, audioFile] { probeImportFile(audioFile); });
+        }
+    }
+
+    // The scan is finished, so the total number of files is now known
+    --importScansPending;
+    triggerAsyncUpdate();
+}
+
+// Runs on a worker thread. Unreadable files are counted as processed but 
+// are not added to the library.
+void MusicLibrary::probeImportFile(const juce::File& file)
+{
+    // Read the track info from the file header
+    TrackMetadata metadata;
+    if (metadataProber.probe(file, metadata))
     {
-        // Set to beginning of the stream and clear the file
-        output.setPosition(0);
-        output.truncate();
+        // Queue the track to be added on the message thread
+        {
+            const juce::ScopedLock lock{ probedTracksLock };
+            probedTracks.push_back({ juce::URL{ file }, file.getFileName(), metadata });
+        }
 
-        // Save each track to the CSV file
-        for (const MusicTrack& track : libraryTracks)
+        // Build the track's thumbnail once the files queued before it have
+        // been probed. Its beats are found once it's been given an ID.
+        if (!importCancelled)
         {
-            // Convert the trackID to a string
-            juce::String trackID{ track.getTrackID() };
-            // Convert the URL to a string
-            juce::String audioURL = track.getAudioURL().getLocalFile().getFullPathName();
-            // Make a comma-delimited string for the track's properties
-            juce::String line = trackID + "," + track.getFileName() + "," 
-                                + audioURL + "," + track.getLength() + "\n";
-            // Write the line to the CSV file
-            output.writeText(line, false, false, "\n");
+            importPool.addJob([this, file] { buildImportThumbnail(file); });
         }
     }
+    else
+    {
+        DBG("File could not be imported. It is not a readable audio file. File: " + file.getFullPathName());
+    }
+
+    // Update the import progress
+    ++importFilesProbed;
+    triggerAsyncUpdate();
 }
 
-// Loads the music library from previously saved CSV file. 
-// Checks that the audio files still exist before adding them back to the library.
-void MusicLibrary::loadLibrary()
+// Runs on a worker thread. Decodes the whole track, so it stops early if the
+// import is cancelled.
+void MusicLibrary::buildImportThumbnail(const juce::File& file)
 {
-    // If a library CSV file exists..
-    if (tracksFile.exists())
+    juce::ThreadPoolJob* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+    thumbCache.buildThumbnail(file, [job] { return job != nullptr && job->shouldExit(); });
+}
+
+// Runs on a worker thread. Stops early if the library is closed.
+void MusicLibrary::removeStaleThumbnails(const juce::Array<juce::File>& files)
+{
+    juce::ThreadPoolJob* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+    thumbCache.removeStaleThumbnails(files, [job] { return job != nullptr && job->shouldExit(); });
+}
+
+// Runs on a worker thread. Decodes the whole track, so it stops early if the
+// import is cancelled. Tracks without a steady beat are left without a
+// beatgrid.
+void MusicLibrary::analyseImportFile(int trackID, const juce::File& file)
+{
+    juce::ThreadPoolJob* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+    BeatGrid beatGrid;
+    if (beatAnalyser.analyse(file, beatGrid, [job] { return job != nullptr && job->shouldExit(); }))
     {
-        // Convert to an input stream
-        juce::FileInputStream input{ tracksFile };
-        if (input.openedOk()) // File opened successfully
+        // Queue the beatgrid to be stored on the message thread
         {
-            // Read line by line to end
-            while (!input.isExhausted())
-            {
-                // Tokenise the line
-                juce::String line = input.readNextLine();
-                juce::StringArray tokens = juce::StringArray::fromTokens(line, ",", "\"");
+            const juce::ScopedLock lock{ probedTracksLock };
+            analysedTracks.push_back({ trackID, beatGrid });
+        }
+        triggerAsyncUpdate();
+    }
+}
 
-                // Convert the URL string to a JUCE File object and verify it exists
-                juce::File audioFile{ tokens[2] };
-                if (audioFile.exists())     // File still exists
-                {
-                    // Convert tokens to Music Track data member data types
-                    int trackID = tokens[0].getIntValue();
-                    juce::String fileName{ tokens[1] };
-                    juce::URL audioURL{ audioFile };
-                    std::string length = tokens[3].toStdString();
+void MusicLibrary::storeBeatGrids(const std::vector<AnalysedTrack>& newBeatGrids)
+{
+    for (const AnalysedTrack& analysedTrack : newBeatGrids)
+    {
+        // The track may have been removed while it was analysed
+        auto slot = trackSlots.find(analysedTrack.trackID);
+        if (slot != trackSlots.end())
+        {
+            MusicTrack& track = libraryTracks[slot->second];
+            track.setBeatGrid(analysedTrack.beatGrid);
+            libraryIndex.journalUpdate(track);
+        }
+    }
+}
+
+bool MusicLibrary::isSupportedAudioFile(const juce::File& file) const
+{
+    return formatManager.findFormatForFileExtension(file.getFileExtension()) != nullptr;
+}
+
+void MusicLibrary::importCSV(const juce::File& csvFile)
+{
+    // Read the tracks listed in the file
+    std::vector<MusicTrack> csvTracks;
+    readCSV(csvFile, csvTracks);
+
+    // Add them to the library with new IDs, so they can't clash with existing tracks
+    for (const MusicTrack& csvTrack : csvTracks)
+    {
+        insertTrack({ ++trackIDCount, csvTrack.getFileName(), 
+                      csvTrack.getAudioURL(), csvTrack.getMetadata(), csvTrack.getBeatGrid() });
+    }
+}
 
-                    // Create the Music Track
-                    MusicTrack track{ trackID, fileName, audioURL, length };
+bool MusicLibrary::exportCSV(const juce::File& csvFile) const
+{
+    // Create the CSV file if not already done
+    csvFile.create();
+
+    // Convert file to an output stream to write to
+    juce::FileOutputStream output{ csvFile };
+    if (!output.openedOk()) // File could not be opened
+    {
+        return false;
+    }
 
-                    // Add the track to the libraryTracks vector
-                    libraryTracks.push_back(track);
+    // Set to beginning of the stream and clear the file
+    output.setPosition(0);
+    output.truncate();
+
+    // Save each track to the CSV file
+    for (const MusicTrack& track : libraryTracks)
+    {
+        // Convert the trackID to a string
+        juce::String trackID{ track.getTrackID() };
+        // Convert the URL to a string
+        juce::String audioURL = track.getAudioURL().getLocalFile().getFullPathName();
+        // Make a comma-delimited string for the track's properties.
+        // Text fields are quoted, since they may contain commas or quotes.
+        const TrackMetadata& metadata = track.getMetadata();
+        const BeatGrid& beatGrid = track.getBeatGrid();
+        juce::String line = trackID + "," + quoteCSVField(track.getFileName()) + "," 
+                            + quoteCSVField(audioURL) + "," 
+                            + juce::String{ metadata.lengthInSamples } + ","
+                            + juce::String{ metadata.sampleRate } + ","
+                            + juce::String{ metadata.numChannels } + ","
+                            + juce::String{ metadata.bitsPerSample } + ","
+                            + quoteCSVField(metadata.title) + ","
+                            + quoteCSVField(metadata.artist) + ","
+                            + quoteCSVField(metadata.album) + ","
+                            + quoteCSVField(metadata.genre) + ","
+                            + juce::String{ beatGrid.bpm } + ","
+                            + juce::String{ beatGrid.firstBeatSample } + "\n";
+        // Write the line to the CSV file
+        output.writeText(line, false, false, "\n");
+    }
+
+    output.flush();
+    return !output.getStatus().failed();
+}
+
+// Reads a library CSV file, as written by exportCSV() or by earlier versions.
+// Checks that the audio files still exist before adding them.
+void MusicLibrary::readCSV(const juce::File& csvFile, std::vector<MusicTrack>& tracks)
+{
+    // Convert to an input stream
+    juce::FileInputStream input{ csvFile };
+    if (input.openedOk()) // File opened successfully
+    {
+        // Read line by line to end
+        while (!input.isExhausted())
+        {
+            // Tokenise the line
+            juce::String line = input.readNextLine();
+            juce::StringArray tokens = parseCSVLine(line);
+
+            // Convert the URL string to a JUCE File object and verify it exists
+            juce::File audioFile{ tokens[2] };
+            if (audioFile.exists())     // File still exists
+            {
+                // Convert tokens to Music Track data member data types
+                int trackID = tokens[0].getIntValue();
+                juce::String fileName{ tokens[1] };
+                juce::URL audioURL{ audioFile };
+                TrackMetadata metadata;
+                if (tokens.size() >= 11)
+                {
+                    metadata.lengthInSamples = tokens[3].getLargeIntValue();
+                    metadata.sampleRate = tokens[4].getDoubleValue();
+                    metadata.numChannels = tokens[5].getIntValue();
+                    metadata.bitsPerSample = tokens[6].getIntValue();
+                    metadata.title = tokens[7];
+                    metadata.artist = tokens[8];
+                    metadata.album = tokens[9];
+                    metadata.genre = tokens[10];
+                }
+                else
+                {
+                    // Older libraries only saved a formatted length string,
+                    // so read the track info from the file header again
+                    metadataProber.probe(audioFile, metadata);
                 }
-                else    // File has been moved or deleted
+
+                // Read the beatgrid, if the library was saved with one
+                BeatGrid beatGrid;
+                if (tokens.size() >= 13)
                 {
-                    DBG("File could not be loaded. It no longer exists at this location. File: " + tokens[1]);
+                    beatGrid.bpm = tokens[11].getDoubleValue();
+                    beatGrid.firstBeatSample = tokens[12].getLargeIntValue();
                 }
 
+                // Create the Music Track and add it to the tracks vector
+                tracks.push_back({ trackID, fileName, audioURL, metadata, beatGrid });
+            }
+            else    // File has been moved or deleted
+            {
+                DBG("File could not be loaded. It no longer exists at this location. File: " + tokens[1]);
             }
         }
     }
+}
+
+juce::String MusicLibrary::quoteCSVField(const juce::String& text)
+{
+    return "\"" + text.replace("\"", "\"\"") + "\"";
+}
+
+// Fields are read one character at a time. Inside quotes, a doubled quote
+// is a quote in the text and a single one ends the quoted part. Fields
+// written unquoted by earlier versions are read up to the next comma.
+juce::StringArray MusicLibrary::parseCSVLine(const juce::String& line)
+{
+    juce::StringArray fields;
+    juce::String field;
+    bool inQuotes{ false };
+    for (juce::String::CharPointerType c = line.getCharPointer(); !c.isEmpty(); ++c)
+    {
+        juce::juce_wchar character = *c;
+        if (inQuotes)
+        {
+            if (character != '"')
+            {
+                field += character;
+            }
+            else if (*(c + 1) == '"')
+            {
+                // A doubled quote, so keep one and skip the other
+                field += character;
+                ++c;
+            }
+            else
+            {
+                inQuotes = false;
+            }
+        }
+        else if (character == '"')
+        {
+            inQuotes = true;
+        }
+        else if (character == ',')
+        {
+            fields.add(field);
+            field.clear();
+        }
+        else
+        {
+            field += character;
+        }
+    }
+    fields.add(field);
+    return fields;
+}
+
+void MusicLibrary::insertTrack(const MusicTrack& track)
+{
+    // Store the track in the next slot and record the slot for its ID
+    trackSlots[track.getTrackID()] = libraryTracks.size();
+    libraryTracks.push_back(track);
+
+    // Add the track to the search index
+    if (searchIndexBuilt)
+    {
+        searchIndex.addTrack(track.getTrackID(), getSearchText(track));
+    }
+
+    // Record the addition in the journal
+    libraryIndex.journalAdd(track);
+}
+
+void MusicLibrary::rebuildTrackSlots()
+{
+    trackSlots.clear();
+    trackSlots.reserve(libraryTracks.size());
+    for (size_t slot = 0; slot < libraryTracks.size(); ++slot)
+    {
+        trackSlots[libraryTracks[slot].getTrackID()] = slot;
+    }
+}
+
+juce::String MusicLibrary::getSearchText(const MusicTrack& track)
+{
+    // Separate the fields with new lines, so matches can't span two fields
+    const TrackMetadata& metadata = track.getMetadata();
+    return track.getFileName() + "\n" + metadata.title + "\n" + metadata.artist 
+           + "\n" + metadata.album + "\n" + metadata.genre;
+}
+
+void MusicLibrary::compactIndexIfNeeded()
+{
+    // Replaying a journal entry costs about as much as reading an index
+    // record, so rewrite the index once the journal is a sizeable fraction of it
+    int journalLimit = juce::jmax(1000, (int) libraryTracks.size() / 4);
+    if (libraryIndex.getNumJournalEntries() > journalLimit)
+    {
+        libraryIndex.compact(libraryTracks);
+    }
 }
\ No newline at end of file
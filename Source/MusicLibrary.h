@@ -1,21 +1,61 @@
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include <JuceHeader.h>
 #include "MusicTrack.h"
-#include "DJAudioPlayer.h"
+#include "TrackMetadataProber.h"
+#include "BeatAnalyser.h"
+#include "PersistentThumbnailCache.h"
+#include "LibraryIndexFile.h"
+#include "LibrarySearchIndex.h"
 
 
-class MusicLibrary 
+class MusicLibrary : private juce::AsyncUpdater
 {
 public:
+    /**
+     * Receives notifications from the library about background imports.
+     * All callbacks are made on the message thread.
+     */
+    class Listener
+    {
+    public:
+        /** Destructor */
+        virtual ~Listener() = default;
+
+        /**
+         * Called whenever a batch of imported tracks has been added to the
+         * library, or when the number of files found to import changes.
+         *
+         * @param tracksProcessed - The number of files probed so far.
+         * @param tracksTotal     - The number of files found to import so far.
+         */
+        virtual void importProgressChanged(int tracksProcessed, int tracksTotal) = 0;
+
+        /**
+         * Called once every file in the current import has been processed.
+         *
+         * @param tracksAdded - The number of tracks added to the library.
+         */
+        virtual void importFinished(int tracksAdded) = 0;
+
+        /**
+         * Called when tracks' beatgrids have been found by the background
+         * beat analysis.
+         */
+        virtual void beatGridsChanged() = 0;
+    };
+
     /** 
      * Constructor 
      *
      * @param _formatManager - Reference to the shared audio format manager
-     *      for the app. Used to create an audio source to read track info, 
-     *      mainly track lengths.
+     *      for the app. Used to read track info from file headers.
+     * @param _thumbCache    - Reference to the shared thumbnail cache. Waveform
+     *      thumbnails are built for imported tracks ahead of time.
      */
-    MusicLibrary(juce::AudioFormatManager& _formatManager);
+    MusicLibrary(juce::AudioFormatManager& _formatManager, PersistentThumbnailCache& _thumbCache);
 
     /** 
      * Destructor 
@@ -23,27 +63,77 @@ public:
     ~MusicLibrary();
 
     /** 
-     * Gets all the tracks in the music library. 
+     * Gets all the tracks in the music library, without copying them. 
      * 
-     * @return The entire music library, as a vector of MusicTrack objects
+     * @return The entire music library, as a vector of MusicTrack objects.
+     *     Tracks are in storage order, which changes as tracks are removed;
+     *     sort by track ID to get the order they were added.
      */
-    std::vector<MusicTrack> getTracks();
+    const std::vector<MusicTrack>& getTracks() const;
 
     /** 
-     * Looks up a track in the library by trackID. 
+     * Looks up a track in the library by trackID. Track IDs are stable 
+     * handles: a track keeps its ID for as long as it is in the library,
+     * and the lookup takes constant time.
      *
      * @param _trackID - The unique ID of the track in the music library
-     * @return A music track object
+     * @return A reference to the music track object. This is valid until
+     *     the next track is added or removed.
+     * @throws std::invalid_argument if there is no track with the ID.
      */
-    MusicTrack getTrack(int _trackID);
+    const MusicTrack& getTrack(int _trackID) const;
+
+    /**
+     * Looks up a track in the library by trackID, without throwing.
+     *
+     * @param _trackID - The unique ID of the track in the music library
+     * @return A pointer to the music track object, or nullptr if there is 
+     *     no track with the ID. This is valid until the next track is added
+     *     or removed.
+     */
+    const MusicTrack* findTrack(int _trackID) const;
 
     /** 
-     * Adds a track to the music library.
+     * Adds a track to the music library. Its beatgrid is found in the
+     * background.
      *
      * @param audioURL - The URL of the track to add to the library
      */
     void addTrack(const juce::URL& audioURL);
 
+    /**
+     * Imports a batch of files and folders into the music library in the
+     * background. Folders are searched recursively for supported audio files.
+     * Track headers are probed on a pool of worker threads, and tracks are 
+     * added to the library on the message thread as they are probed. Once
+     * probed, each track's waveform thumbnail is built and stored, and once
+     * added, its tempo and beats are analysed.
+     *
+     * @param filesOrFolders - The audio files and folders to import.
+     */
+    void importFiles(const juce::Array<juce::File>& filesOrFolders);
+
+    /**
+     * Checks whether a background import is still running.
+     *
+     * @return True if files are still being scanned or probed.
+     */
+    bool isImporting() const;
+
+    /**
+     * Registers a listener for import notifications.
+     *
+     * @param listener - The listener to add.
+     */
+    void addListener(Listener* listener);
+
+    /**
+     * Deregisters a listener for import notifications.
+     *
+     * @param listener - The listener to remove.
+     */
+    void removeListener(Listener* listener);
+
     /** 
      * Removes a track from the music library.
      *
@@ -57,33 +147,224 @@ public:
     void clearLibrary();
 
     /** 
-     * Returns a vector of tracks matching the search keyword. 
+     * Finds the tracks matching the search keyword, using the library's 
+     * search index. A track matches if its file name or tags contain every
+     * word of the keyword, ignoring case.
      *
      * @param keyword - The search term to search for tracks
-     * @return A vector of music track objects
+     * @return The IDs of the matching tracks, in the order they were added
+     */
+    std::vector<int> searchLibrary(const juce::String& keyword);
+
+    /**
+     * Adds the tracks listed in a library CSV file to the music library.
+     * Tracks are given new IDs, and files that no longer exist are skipped.
+     *
+     * @param csvFile - The CSV file to import.
      */
-    std::vector<MusicTrack> searchLibrary(juce::String& keyword);
+    void importCSV(const juce::File& csvFile);
+
+    /**
+     * Writes the music library track list to a CSV file.
+     *
+     * @param csvFile - The CSV file to write.
+     * @return True if the file was written.
+     */
+    bool exportCSV(const juce::File& csvFile) const;
 
 private:
-    /** 
-     * Saves the music library track list to CSV.
+    /** A track that has been probed on a worker thread, waiting to be added. */
+    struct ProbedTrack
+    {
+        juce::URL audioURL;
+        juce::String fileName;
+        TrackMetadata metadata;
+    };
+
+    /** A beatgrid found on a worker thread, waiting to be stored with its track. */
+    struct AnalysedTrack
+    {
+        int trackID;
+        BeatGrid beatGrid;
+    };
+
+    /**
+     * Implements AsyncUpdater: Moves probed tracks into the library on the
+     * message thread and notifies listeners of the import progress.
      */
-    void saveLibrary();
+    void handleAsyncUpdate() override;
 
-    /** 
-     * Loads the music library track list from CSV. 
+    /**
+     * Adds the tracks probed by the workers to the library, and stores the
+     * beatgrids they have found. Runs on the message thread.
+     *
+     * @param queueAnalysis - True to queue a job to find each added track's
+     *     beats. False when the library is closing.
+     * @return True if any beatgrids were stored.
      */
-    void loadLibrary();
+    bool addImportResults(bool queueAnalysis);
 
-    // Audio player to read meta info about tracks
-    DJAudioPlayer sourceReader;
-    // The music library
+    /**
+     * Searches the files and folders of an import for supported audio files
+     * and queues a probe job for each one. Runs on a worker thread.
+     *
+     * @param filesOrFolders - The audio files and folders to import.
+     */
+    void scanImportFiles(const juce::Array<juce::File>& filesOrFolders);
+
+    /**
+     * Reads the header of an audio file and queues the result to be added
+     * to the library. Runs on a worker thread.
+     *
+     * @param file - The audio file to probe.
+     */
+    void probeImportFile(const juce::File& file);
+
+    /**
+     * Builds and stores the waveform thumbnail for an imported track, if it
+     * doesn't have one yet. Runs on a worker thread.
+     *
+     * @param file - The audio file.
+     */
+    void buildImportThumbnail(const juce::File& file);
+
+    /**
+     * Deletes stored waveform thumbnails that no longer belong to any track
+     * in the library. Runs on a worker thread.
+     *
+     * @param files - The audio files of the library's tracks.
+     */
+    void removeStaleThumbnails(const juce::Array<juce::File>& files);
+
+    /**
+     * Finds the tempo and beats of a track and queues them to be stored
+     * with the track. Runs on a worker thread.
+     *
+     * @param trackID - The unique ID of the track in the music library.
+     * @param file    - The track's audio file.
+     */
+    void analyseImportFile(int trackID, const juce::File& file);
+
+    /**
+     * Stores newly found beatgrids with their tracks, and records them in
+     * the library journal.
+     *
+     * @param analysedTracks - The beatgrids and the IDs of their tracks.
+     */
+    void storeBeatGrids(const std::vector<AnalysedTrack>& analysedTracks);
+
+    /**
+     * Checks whether a file has the extension of a registered audio format.
+     *
+     * @param file - The file to check.
+     * @return True if the file can be opened by the format manager.
+     */
+    bool isSupportedAudioFile(const juce::File& file) const;
+
+    /**
+     * Adds a track to the library's track store and ID lookup table, and
+     * records it in the library journal.
+     *
+     * @param track - The track to add.
+     */
+    void insertTrack(const MusicTrack& track);
+
+    /**
+     * Rebuilds the ID lookup table from the track store.
+     */
+    void rebuildTrackSlots();
+
+    /**
+     * Gets the text a track can be found by in searches.
+     *
+     * @param track - The track.
+     * @return The track's file name and tags.
+     */
+    static juce::String getSearchText(const MusicTrack& track);
+
+    /**
+     * Quotes a text field for a CSV file, doubling any quotes inside it, so
+     * commas and quotes in the text are read back as part of the field.
+     *
+     * @param text - The field's text.
+     * @return The quoted field.
+     */
+    static juce::String quoteCSVField(const juce::String& text);
+
+    /**
+     * Splits a line of a CSV file into its fields. Quoted fields are
+     * unquoted, and doubled quotes inside them are read as one.
+     *
+     * @param line - The line to split.
+     * @return The line's fields.
+     */
+    static juce::StringArray parseCSVLine(const juce::String& line);
+
+    /**
+     * Reads the tracks listed in a library CSV file. Checks that the audio 
+     * files still exist before adding them.
+     *
+     * @param csvFile - The CSV file to read.
+     * @param tracks  - The vector to add the tracks to.
+     */
+    void readCSV(const juce::File& csvFile, std::vector<MusicTrack>& tracks);
+
+    /**
+     * Rewrites the library index if enough changes have built up in its 
+     * journal to make replaying them at startup slower than reading the index.
+     */
+    void compactIndexIfNeeded();
+
+    // Shared format manager, used to find supported audio files
+    juce::AudioFormatManager& formatManager;
+    // Header-only reader for track info, shared by the import threads
+    TrackMetadataProber metadataProber{ formatManager };
+    // Tempo and beat finder, shared by the import threads
+    BeatAnalyser beatAnalyser{ formatManager };
+    // Shared thumbnail cache, filled in ahead of time as tracks are imported
+    PersistentThumbnailCache& thumbCache;
+    // The music library. Tracks are stored densely, so a removed track's 
+    // slot is filled by moving the last track into it.
     std::vector<MusicTrack> libraryTracks;
+    // Lookup table from track ID to the track's slot in libraryTracks
+    std::unordered_map<int, size_t> trackSlots;
+    // Trigram index for searches. Built on the first search rather than at
+    // startup, then kept up to date as tracks are added and removed.
+    LibrarySearchIndex searchIndex;
+    bool searchIndexBuilt{ false };
     // A counter for incrementing track IDs in the library
     int trackIDCount{ 0 };
-    // Local file object to store library CSV data
+    // Local file object for library CSV data saved by earlier versions
     juce::File tracksFile{ juce::File::getCurrentWorkingDirectory().getFullPathName() 
         + "\\libraryTracks.csv" };
+    // Binary library index and its journal of changes
+    LibraryIndexFile libraryIndex{
+        juce::File::getCurrentWorkingDirectory().getChildFile("libraryTracks.djlib"),
+        juce::File::getCurrentWorkingDirectory().getChildFile("libraryTracks.journal") };
+
+    /*------------- Background Import ------------*/
+    // Tracks probed by the workers, waiting to be added on the message thread
+    std::vector<ProbedTrack> probedTracks;
+    // Beatgrids found by the workers, waiting to be stored on the message thread
+    std::vector<AnalysedTrack> analysedTracks;
+    // Lock protecting probedTracks and analysedTracks
+    juce::CriticalSection probedTracksLock;
+    // Import progress counters, written by the worker threads
+    std::atomic<int> importFilesFound{ 0 };
+    std::atomic<int> importFilesProbed{ 0 };
+    std::atomic<int> importScansPending{ 0 };
+    // Number of tracks added to the library during the current import
+    int importTracksAdded{ 0 };
+    // Whether listeners still need to be told the current import has finished
+    bool importNotifyPending{ false };
+    // Listeners for import notifications
+    juce::ListenerList<Listener> listeners;
+    // Set when the library is closing, so workers stop queuing more jobs
+    std::atomic<bool> importCancelled{ false };
+    // Worker threads for scanning folders and probing track headers. 
+    // Declared last, so it is destroyed first, while everything its jobs
+    // use still exists.
+    juce::ThreadPool importPool{ juce::jmax(1, juce::SystemStats::getNumCpus() - 1) };
 };
 
 
@@ -1,11 +1,14 @@
+#include <cmath>
 #include "MusicTrack.h"
 
 
-MusicTrack::MusicTrack(int _trackID, juce::String _fileName, juce::URL _audioURL, std::string _length)
+MusicTrack::MusicTrack(int _trackID, juce::String _fileName, juce::URL _audioURL, TrackMetadata _metadata,
+                       BeatGrid _beatGrid)
     : trackID{ _trackID },
       fileName { _fileName },
       audioURL{ _audioURL }, 
-      length{ _length }
+      metadata{ _metadata },
+      beatGrid{ _beatGrid }
 {
 }
 
@@ -24,7 +27,52 @@ juce::URL MusicTrack::getAudioURL() const
     return audioURL;
 }
 
-std::string MusicTrack::getLength() const
+const TrackMetadata& MusicTrack::getMetadata() const
 {
-    return length;
-}
\ No newline at end of file
+    return metadata;
+}
+
+const BeatGrid& MusicTrack::getBeatGrid() const
+{
+    return beatGrid;
+}
+
+void MusicTrack::setBeatGrid(const BeatGrid& _beatGrid)
+{
+    beatGrid = _beatGrid;
+}
+
+// Each beat is worked out from the first, rather than by adding up beat
+// lengths, so rounding errors don't build up along the track
+juce::int64 MusicTrack::getBeatPosition(int beatNumber) const
+{
+    if (beatGrid.bpm <= 0)
+    {
+        return 0;
+    }
+    double samplesPerBeat = 60.0 * metadata.sampleRate / beatGrid.bpm;
+    return beatGrid.firstBeatSample + (juce::int64) std::round(beatNumber * samplesPerBeat);
+}
+
+double MusicTrack::getLengthInSeconds() const
+{
+    // Avoid dividing by zero for tracks with no known sample rate
+    if (metadata.sampleRate <= 0)
+    {
+        return 0;
+    }
+    return metadata.lengthInSamples / metadata.sampleRate;
+}
+
+std::string MusicTrack::formatLength(double lengthInSeconds)
+{
+    // Get the total whole seconds of the track
+    int totalSeconds = (int) std::round(lengthInSeconds);
+
+    // Convert to minutes and seconds
+    int secondsLong = totalSeconds % 60;
+    int minutesLong = totalSeconds / 60;
+
+    // Return a formatted string
+    return std::to_string(minutesLong) + "m " + std::to_string(secondsLong) + "s";
+}
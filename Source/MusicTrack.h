@@ -3,6 +3,35 @@
 #include <JuceHeader.h>
 
 
+/**
+ * Format and tag information read from an audio file header. Numeric values 
+ * are kept as numbers so that tracks can be sorted and filtered without 
+ * parsing display strings.
+ */
+struct TrackMetadata
+{
+    juce::int64 lengthInSamples{ 0 };   // the length of the file in samples
+    double sampleRate{ 0 };             // the sample rate of the file
+    int numChannels{ 0 };               // the number of audio channels
+    int bitsPerSample{ 0 };             // the bit depth of the file
+    juce::String title;                 // the title tag, if any
+    juce::String artist;                // the artist tag, if any
+    juce::String album;                 // the album tag, if any
+    juce::String genre;                 // the genre tag, if any
+};
+
+
+/**
+ * A constant-tempo beatgrid, found by analysing a track. Beats fall every
+ * 60 / bpm seconds, counting from the first beat.
+ */
+struct BeatGrid
+{
+    double bpm{ 0 };                    // the tempo, or 0 if it hasn't been found
+    juce::int64 firstBeatSample{ 0 };   // the position of the first beat, in samples
+};
+
+
 class MusicTrack
 {
 public:
@@ -13,12 +42,14 @@ public:
      *                     the library.
      * @param _fileName  - The name of the audio file for the track.
      * @param _audioURL  - A JUCE URL for the audio file of the track.
-     * @param _length    - A formatted string containing the track length.
+     * @param _metadata  - The format and tag information of the track.
+     * @param _beatGrid  - The tempo and beats of the track, if analysed.
      */
     MusicTrack(int _trackID, 
                juce::String _fileName, 
                juce::URL _audioURL, 
-               std::string _length);
+               TrackMetadata _metadata,
+               BeatGrid _beatGrid = {});
 
     /**
      * Gets the track ID.
@@ -42,15 +73,55 @@ public:
     juce::URL getAudioURL() const;
 
     /**
-     * Gets the track length as a formatted string in minutes and seconds.
+     * Gets the format and tag information of the track.
+     *
+     * @return The track metadata.
+     */
+    const TrackMetadata& getMetadata() const;
+
+    /**
+     * Gets the tempo and beats of the track.
+     *
+     * @return The beatgrid. Its BPM is 0 if the track hasn't been analysed.
+     */
+    const BeatGrid& getBeatGrid() const;
+
+    /**
+     * Sets the tempo and beats of the track, once it has been analysed.
+     *
+     * @param _beatGrid - The beatgrid.
+     */
+    void setBeatGrid(const BeatGrid& _beatGrid);
+
+    /**
+     * Gets the position of a beat on the track's beatgrid.
+     *
+     * @param beatNumber - The beat, counting from 0 at the first beat.
+     *     Negative beats fall before the first beat.
+     * @return The position of the beat in samples, or 0 if the track
+     *     has no beatgrid.
+     */
+    juce::int64 getBeatPosition(int beatNumber) const;
+
+    /**
+     * Gets the track length in seconds.
+     *
+     * @return The track length in seconds, or 0 if the sample rate is unknown.
+     */
+    double getLengthInSeconds() const;
+
+    /**
+     * Formats a track length as a string of minutes and seconds.
      *
+     * @param lengthInSeconds - The track length in seconds.
      * @return A formatted string of the track length in minutes and seconds.
      */
-    std::string getLength() const;
+    static std::string formatLength(double lengthInSeconds);
 
 private:
     int trackID;                // the unique track ID
     juce::String fileName;      // the track file name
     juce::URL audioURL;         // the track file URL
-    std::string length;         // the track length
-};
\ No newline at end of file
+    TrackMetadata metadata;     // the track format and tag information
+    BeatGrid beatGrid;          // the track tempo and beats
+};
@@ -0,0 +1,155 @@
+#include <unordered_set>
+#include <JuceHeader.h>
+#include "PersistentThumbnailCache.h"
+
+
+PersistentThumbnailCache::PersistentThumbnailCache(juce::AudioFormatManager& _formatManager,
+                                                   int maxThumbsInMemory,
+                                                   const juce::File& _directory)
+    : juce::AudioThumbnailCache{ maxThumbsInMemory },
+      formatManager{ _formatManager },
+      directory{ _directory }
+{
+    // Make sure the thumbnail folder exists
+    if (!directory.createDirectory())
+    {
+        DBG("PersistentThumbnailCache: could not create " << directory.getFullPathName());
+    }
+}
+
+PersistentThumbnailCache::~PersistentThumbnailCache()
+{
+}
+
+juce::int64 PersistentThumbnailCache::getHashForFile(const juce::File& file)
+{
+    return (file.getFullPathName() 
+            + "|" + juce::String(file.getSize()) 
+            + "|" + juce::String(file.getLastModificationTime().toMilliseconds())).hashCode64();
+}
+
+// The thumbnail is filled in block by block on this thread, rather than
+// handed to the cache's own thread, so builds on different threads run in
+// parallel and never hold up the decks' thumbnails.
+bool PersistentThumbnailCache::buildThumbnail(const juce::File& file, 
+                                              const std::function<bool()>& shouldStop)
+{
+    // Nothing to do if the thumbnail is already stored
+    juce::int64 hashCode = getHashForFile(file);
+    if (getThumbnailFile(hashCode).existsAsFile())
+    {
+        return true;
+    }
+
+    // Create a reader for the track
+    std::unique_ptr<juce::AudioFormatReader> reader = readerFactory.createReaderFor(file);
+    if (reader == nullptr)
+    {
+        return false;
+    }
+
+    // Read the whole track into the thumbnail
+    int numChannels = static_cast<int>(reader->numChannels);
+    juce::AudioThumbnail thumbnail{ thumbnailResolution, formatManager, *this };
+    thumbnail.reset(numChannels, reader->sampleRate, reader->lengthInSamples);
+    juce::AudioBuffer<float> buffer{ numChannels, chunkSize };
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += chunkSize)
+    {
+        if (shouldStop != nullptr && shouldStop())
+        {
+            return false;
+        }
+
+        int numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(chunkSize), 
+                                                     reader->lengthInSamples - position));
+        if (!reader->read(&buffer, 0, numSamples, position, true, true))
+        {
+            DBG("PersistentThumbnailCache: could not read " << file.getFullPathName());
+            return false;
+        }
+        thumbnail.addBlock(position, buffer, 0, numSamples);
+    }
+
+    return saveThumbnailFile(thumbnail, hashCode);
+}
+
+// Only thumbnails older than the call are deleted, so one built by an import
+// running alongside is never lost.
+void PersistentThumbnailCache::removeStaleThumbnails(const juce::Array<juce::File>& filesToKeep, 
+                                                     const std::function<bool()>& shouldStop)
+{
+    juce::Time startTime = juce::Time::getCurrentTime();
+
+    // Work out which thumbnail files are still in use
+    std::unordered_set<juce::int64> hashesToKeep;
+    for (const juce::File& file : filesToKeep)
+    {
+        if (shouldStop != nullptr && shouldStop())
+        {
+            return;
+        }
+        hashesToKeep.insert(getHashForFile(file));
+    }
+
+    // Delete the rest
+    for (const juce::File& thumbnailFile : directory.findChildFiles(juce::File::findFiles, false, "*.thumb"))
+    {
+        if (shouldStop != nullptr && shouldStop())
+        {
+            return;
+        }
+        juce::int64 hashCode = thumbnailFile.getFileNameWithoutExtension().getHexValue64();
+        if (hashesToKeep.count(hashCode) == 0 
+            && thumbnailFile.getLastModificationTime() < startTime)
+        {
+            thumbnailFile.deleteFile();
+        }
+    }
+}
+
+bool PersistentThumbnailCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    // Look for the thumbnail on disk
+    juce::FileInputStream input{ getThumbnailFile(hashCode) };
+    if (!input.openedOk())
+    {
+        return false;
+    }
+
+    return thumb.loadFrom(input);
+}
+
+void PersistentThumbnailCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, 
+                                                          juce::int64 hashCode)
+{
+    saveThumbnailFile(thumb, hashCode);
+}
+
+bool PersistentThumbnailCache::saveThumbnailFile(const juce::AudioThumbnailBase& thumb, 
+                                                 juce::int64 hashCode) const
+{
+    // Write to a temporary file first, so a half-written thumbnail is
+    // never loaded
+    juce::TemporaryFile tempFile{ getThumbnailFile(hashCode) };
+    {
+        juce::FileOutputStream output{ tempFile.getFile() };
+        if (!output.openedOk())
+        {
+            DBG("PersistentThumbnailCache: could not save thumbnail " << tempFile.getFile().getFullPathName());
+            return false;
+        }
+        thumb.saveTo(output);
+    }
+
+    if (!tempFile.overwriteTargetFileWithTemporary())
+    {
+        DBG("PersistentThumbnailCache: could not save thumbnail " << tempFile.getTargetFile().getFullPathName());
+        return false;
+    }
+    return true;
+}
+
+juce::File PersistentThumbnailCache::getThumbnailFile(juce::int64 hashCode) const
+{
+    return directory.getChildFile(juce::String::toHexString(hashCode) + ".thumb");
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <functional>
+#include <JuceHeader.h>
+#include "AudioFileReaderFactory.h"
+
+
+/**
+ * A thumbnail cache that keeps finished waveform thumbnails on disk as well
+ * as in memory, so a track's waveform appears straight away whenever it is
+ * loaded again, even after the app is restarted.
+ *
+ * Thumbnails are stored one file per track, named by a hash of the track's
+ * path, size and modification time, so an edited file gets a new thumbnail.
+ * Thumbnails can also be built ahead of time, during library import.
+ */
+class PersistentThumbnailCache : public juce::AudioThumbnailCache
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _formatManager     - Reference to the shared audio format manager
+     *      for the app. Used to read tracks when building thumbnails.
+     * @param maxThumbsInMemory  - The most thumbnails to keep in memory.
+     * @param _directory         - The folder to store thumbnails in.
+     */
+    PersistentThumbnailCache(juce::AudioFormatManager& _formatManager,
+                             int maxThumbsInMemory,
+                             const juce::File& _directory);
+
+    /**
+     * Destructor
+     */
+    ~PersistentThumbnailCache() override;
+
+    /**
+     * Gets the hash a track's thumbnail is stored under.
+     *
+     * @param file - The audio file.
+     * @return The hash of the file's path, size and modification time.
+     */
+    static juce::int64 getHashForFile(const juce::File& file);
+
+    /**
+     * Builds and stores the thumbnail for a track, unless one is already
+     * stored. The track is read on the calling thread, so only call this on
+     * a background thread. Safe to call from several threads at once.
+     *
+     * @param file       - The audio file.
+     * @param shouldStop - Checked between chunks. Return true to give up.
+     * @return True if a thumbnail is stored for the file.
+     */
+    bool buildThumbnail(const juce::File& file, const std::function<bool()>& shouldStop);
+
+    /**
+     * Deletes stored thumbnails that don't belong to any of the given
+     * tracks, such as those of removed or edited tracks. Thumbnails stored
+     * after this is called are kept. Only call this on a background thread.
+     *
+     * @param filesToKeep - The audio files whose thumbnails are still needed.
+     * @param shouldStop  - Checked between files. Return true to give up.
+     */
+    void removeStaleThumbnails(const juce::Array<juce::File>& filesToKeep, 
+                               const std::function<bool()>& shouldStop);
+
+    // Source samples per thumbnail sample, shared by every thumbnail so
+    // stored thumbnails can be reused by any display
+    static constexpr int thumbnailResolution{ 1000 };
+
+private:
+    /**
+     * Implements AudioThumbnailCache: Loads a thumbnail from disk, when it
+     * isn't in memory.
+     *
+     * @param thumb    - The thumbnail to load into.
+     * @param hashCode - The hash the thumbnail is stored under.
+     * @return True if the thumbnail was found and loaded.
+     */
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+    /**
+     * Implements AudioThumbnailCache: Saves a newly finished thumbnail to disk.
+     *
+     * @param thumb    - The finished thumbnail.
+     * @param hashCode - The hash to store the thumbnail under.
+     */
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+    /**
+     * Writes a thumbnail to disk, through a temporary file so a half-written
+     * thumbnail is never loaded.
+     *
+     * @param thumb    - The finished thumbnail.
+     * @param hashCode - The hash to store the thumbnail under.
+     * @return True if the thumbnail was saved.
+     */
+    bool saveThumbnailFile(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) const;
+
+    /**
+     * Gets the file a thumbnail is stored in.
+     *
+     * @param hashCode - The hash of the thumbnail.
+     * @return The thumbnail file.
+     */
+    juce::File getThumbnailFile(juce::int64 hashCode) const;
+
+    // Shared format manager, and reader factory for building thumbnails
+    juce::AudioFormatManager& formatManager;
+    AudioFileReaderFactory readerFactory{ formatManager };
+    // Folder the thumbnails are stored in
+    juce::File directory;
+
+    // Samples read from a track at a time when building its thumbnail
+    static constexpr int chunkSize{ 65536 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PersistentThumbnailCache)
+};
@@ -3,27 +3,28 @@
 
 
 PlaylistComponent::PlaylistComponent(juce::AudioFormatManager& _formatManager, 
-                                     DeckGUI* _leftDeck,
-                                     DeckGUI* _rightDeck)
-    : musicLibrary { _formatManager },
-      leftDeck { _leftDeck },
-      rightDeck { _rightDeck }
+                                     PersistentThumbnailCache& _thumbCache,
+                                     DeckManager& _deckManager)
+    : musicLibrary { _formatManager, _thumbCache },
+      deckManager { _deckManager }
 {
     // Set custom look and feel
     setLookAndFeel(&mainLookAndFeel);
 
-    // Get the playlist from the music library
-    shownTracks = musicLibrary.getTracks();
+    // Show every track in the music library
+    playlistView.refresh();
 
     // Set the table component's data model
     tableComponent.setModel(this);
 
-    // Create headers for the table
-    tableComponent.getHeader().addColumn("File Name", 1, 330);
+    // Create headers for the table. Only the track info columns can be sorted.
+    int buttonColumnFlags = juce::TableHeaderComponent::defaultFlags 
+                            & ~juce::TableHeaderComponent::sortable;
+    tableComponent.getHeader().addColumn("File Name", 1, 400);
     tableComponent.getHeader().addColumn("Track Length", 2, 160);
-    tableComponent.getHeader().addColumn("", 3, 150);
-    tableComponent.getHeader().addColumn("", 4, 150);
-    tableComponent.getHeader().addColumn("", 5, 110);
+    tableComponent.getHeader().addColumn("BPM", 4, 80);
+    tableComponent.getHeader().addColumn("", 3, 150, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("", 5, 110, 30, -1, buttonColumnFlags);
 
     // Add components
     addAndMakeVisible(addTrackButton);
@@ -50,10 +51,13 @@ PlaylistComponent::PlaylistComponent(juce::AudioFormatManager& _formatManager,
     clearPlaylistButton.addListener(this);
     searchBox.addListener(this);
     clearSearchButton.addListener(this);
+    musicLibrary.addListener(this);
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
+    // Stop receiving import notifications
+    musicLibrary.removeListener(this);
     // Remove this component's look and feel
     setLookAndFeel(nullptr);
 }
@@ -96,8 +100,8 @@ void PlaylistComponent::resized()
 
 int PlaylistComponent::getNumRows()
 {
-    // Use the size of the trackTitles vector to determine number of rows
-    return shownTracks.size();
+    // Use the number of tracks in the playlist view to determine number of rows
+    return playlistView.getNumRows();
 }
 
 void PlaylistComponent::paintRowBackground(juce::Graphics& g,
@@ -117,7 +121,9 @@ void PlaylistComponent::paintRowBackground(juce::Graphics& g,
     }
 }
 
-// Draws cell contents for non-custom component columns
+// Draws cell contents. The deck loading and track removal columns are drawn
+// as buttons here too, rather than as child components, so scrolling never
+// creates components or registers listeners.
 void PlaylistComponent::paintCell(juce::Graphics& g,
     int rowNumber,
     int columnId,
@@ -125,10 +131,17 @@ void PlaylistComponent::paintCell(juce::Graphics& g,
     int height,
     bool rowIsSelected)
 {
+    // Get the track for the row from the library
+    const MusicTrack* track = playlistView.getTrack(rowNumber);
+    if (track == nullptr)
+    {
+        return;
+    }
+
     // Draw the track titles down the first column
     if(columnId == 1)
     {
-        g.drawText(shownTracks[rowNumber].getFileName(),
+        g.drawText(track->getFileName(),
             2, 0,
             width - 4, height,
             juce::Justification::centredLeft,
@@ -137,133 +150,125 @@ void PlaylistComponent::paintCell(juce::Graphics& g,
     // Draw the track lengths down the second column
     if (columnId == 2)
     {
-        g.drawText(shownTracks[rowNumber].getLength(),
+        g.drawText(MusicTrack::formatLength(track->getLengthInSeconds()),
             2, 0,
             width - 4, height,
             juce::Justification::centredLeft,
             true);
     }
-}
-
-// Draws cell contents that contain custom components
-juce::Component* PlaylistComponent::refreshComponentForCell(int rowNumber,
-    int columnId,
-    bool isRowSelected,
-    juce::Component* existingComponentToUpdate)
-{
-    // Create custom component deck loading buttons in the 3rd and 4th columns
+    // Draw the tempos in the BPM column, once the tracks are analysed
+    if (columnId == 4 && track->getBeatGrid().bpm > 0)
+    {
+        g.drawText(juce::String{ track->getBeatGrid().bpm, 1 },
+            2, 0,
+            width - 4, height,
+            juce::Justification::centredLeft,
+            true);
+    }
+    // Draw deck loading buttons in the 3rd column
     if (columnId == 3)
     {
-        // Make 'left deck' load buttons
-        if (existingComponentToUpdate == nullptr)
-        {
-            // Create a text button component for the left deck
-            juce::TextButton* leftDeckButton = new juce::TextButton{ "Left Deck" };
-            juce::String id { shownTracks[rowNumber].getTrackID() };
-            juce::String name{ "leftDeck" };
-            leftDeckButton->setComponentID(id);
-            leftDeckButton->setName(name);
-
-            // Assign it the button listener
-            leftDeckButton->addListener(this);
-
-            // Save it as the existing component to update, to return below
-            existingComponentToUpdate = leftDeckButton;
-        }
-        // Refresh the component ID for existing buttons.
-        // This is necessary because which track is in the row can change.
-        if (existingComponentToUpdate->isVisible())
-        {
-            juce::String id{ shownTracks[rowNumber].getTrackID() };
-            existingComponentToUpdate->setComponentID(id);
-        }
+        paintCellButton(g, "Load to Deck", width, height);
     }
-    if (columnId == 4)
+    // Draw 'remove track' buttons in the 5th column
+    if (columnId == 5)
     {
-        // Make 'right deck' load buttons
-        if (existingComponentToUpdate == nullptr)
-        {
-            // Create a text button component for the right deck
-            juce::TextButton* rightDeckButton = new juce::TextButton{ "Right Deck" };
-            juce::String id{ shownTracks[rowNumber].getTrackID() };
-            juce::String name{ "rightDeck" };
-            rightDeckButton->setComponentID(id);
-            rightDeckButton->setName(name);
+        paintCellButton(g, "Remove Track", width, height);
+    }
+}
 
-            // Assign it the button listener
-            rightDeckButton->addListener(this);
+// Handles clicks on the buttons drawn in the deck loading and track 
+// removal columns. The row number gives the track directly.
+void PlaylistComponent::cellClicked(int rowNumber, int columnId, const juce::MouseEvent&)
+{
+    // Get the ID of the track in the clicked row
+    int trackID = playlistView.getTrackID(rowNumber);
+    if (trackID == 0)
+    {
+        return;
+    }
 
-            existingComponentToUpdate = rightDeckButton;
-        }
-        // Refresh the component ID for existing buttons
-        // This is necessary because which track is in the row can change
-        if (existingComponentToUpdate->isVisible())
-        {
-            juce::String id{ shownTracks[rowNumber].getTrackID() };
-            existingComponentToUpdate->setComponentID(id);
-        }
+    // 'Load to Deck' buttons
+    if (columnId == 3)
+    {
+        chooseDeckForTrack(trackID);
     }
-    // Create custom component 'remove track' buttons in the 5th column
+    // 'Remove Track' buttons
     if (columnId == 5)
     {
-        if (existingComponentToUpdate == nullptr)
-        {
-            // Create a button to remove the track
-            juce::TextButton* removeTrackButton = new juce::TextButton{ "Remove Track" };
-            juce::String id{ shownTracks[rowNumber].getTrackID() };
-            juce::String name{ "removeTrack" };
-            removeTrackButton->setComponentID(id);
-            removeTrackButton->setName(name);
+        // Remove the track from the music library and the playlist view
+        musicLibrary.removeTrack(trackID);
+        playlistView.removeTrack(trackID);
 
-            // Assign it the button listener
-            removeTrackButton->addListener(this);
+        // Refresh the table
+        tableComponent.updateContent();
+        tableComponent.repaint();
+    }
+}
 
-            existingComponentToUpdate = removeTrackButton;
-        }
-        // Refresh the component ID for existing buttons
-        // This is necessary because which track is in the row can change
-        if (existingComponentToUpdate->isVisible())
-        {
-            juce::String id{ shownTracks[rowNumber].getTrackID() };
-            existingComponentToUpdate->setComponentID(id);
-        }
+// Called when a column header is clicked. Only the file name, track 
+// length and BPM columns can be sorted by.
+void PlaylistComponent::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    // Choose the track property for the column
+    PlaylistView::SortKey sortKey{ PlaylistView::SortKey::dateAdded };
+    if (newSortColumnId == 1)
+    {
+        sortKey = PlaylistView::SortKey::fileName;
+    }
+    else if (newSortColumnId == 2)
+    {
+        sortKey = PlaylistView::SortKey::length;
+    }
+    else if (newSortColumnId == 4)
+    {
+        sortKey = PlaylistView::SortKey::bpm;
     }
-    // Return the custom component, or nullptr if irrelevant column
-    return existingComponentToUpdate;
+
+    // Re-sort the view and redraw the rows
+    playlistView.setSortOrder(sortKey, isForwards);
+    tableComponent.updateContent();
+    tableComponent.repaint();
 }
 
-// Processes all buttons in the playlist component, both in the
-// top bar, and in the table columns.
+// Processes the buttons in the playlist component's top bar. Buttons in
+// the table columns are handled by cellClicked().
 void PlaylistComponent::buttonClicked(juce::Button* button)
 {
     // 'Add Track' button
     if (button == &addTrackButton)
     {
-        // Create a file chooser GUI for the user to select a file 
-        chooser = std::make_unique<juce::FileChooser> ("Select a track to load...", homeDirectory);
+        // Create a file chooser GUI for the user to select files or folders
+        chooser = std::make_unique<juce::FileChooser> ("Select tracks or folders to add...", homeDirectory);
 
         // Set file chooser flags
         auto folderChooserFlags = juce::FileBrowserComponent::openMode |
-            juce::FileBrowserComponent::canSelectFiles;
+            juce::FileBrowserComponent::canSelectFiles |
+            juce::FileBrowserComponent::canSelectDirectories |
+            juce::FileBrowserComponent::canSelectMultipleItems;
 
-        // If the user selects a file to open, load the file
+        // If the user selects files to open, import them in the background
         chooser->launchAsync(folderChooserFlags,
             [this](const juce::FileChooser& chooser) {
-                // Get the chosen file
-                juce::File file { chooser.getResult() };
-                // Confirm it is a supported audio file
-                if (file.hasFileExtension("mp3") || file.hasFileExtension("wav"))
+                // Get the chosen files and folders
+                juce::Array<juce::File> files{ chooser.getResults() };
+                if (!files.isEmpty())
                 {
                     // Clear any active search, so full library can be seen
                     clearSearch();
 
-                    // Convert the chosen file to a URL and load it
-                    juce::URL audioURL{ file };
-                    musicLibrary.addTrack(audioURL);
+                    // Add the tracks from any exported library CSV files straight away
+                    for (const juce::File& file : files)
+                    {
+                        if (file.hasFileExtension("csv"))
+                        {
+                            musicLibrary.importCSV(file);
+                            refreshPlaylist();
+                        }
+                    }
 
-                    // Update playlist to show the new track
-                    shownTracks = musicLibrary.getTracks();
-                    tableComponent.updateContent();
+                    // Import the audio files. The playlist is refreshed as tracks are added.
+                    musicLibrary.importFiles(files);
                 }
             }
         );
@@ -272,7 +277,7 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
     else if (button == &clearPlaylistButton)
     {
         // Only clear if not already empty
-        if (!shownTracks.empty())
+        if (!musicLibrary.getTracks().empty())
         {
             // Set alert messages
             juce::String alertTitle{ "Clear Playlist" };
@@ -297,122 +302,179 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
         // Clear the search and re-display whole library
         clearSearch();
     }
-    // 'Remove Track' buttons in the tableComponent
-    else if (button->getName() == "removeTrack")
-    {
-        // Get the track id from the component id on the button
-        int trackID = button->getComponentID().getIntValue();
+}
 
-        // Remove the track from the music library
-        musicLibrary.removeTrack(trackID);
+// Loads a track from the music library to one of the decks
+void PlaylistComponent::loadTrackToDeck(int trackID, DeckGUI* deck)
+{
+    // Load the relevant track from the music library
+    try {
+        // Get the track from the library
+        const MusicTrack& track = musicLibrary.getTrack(trackID);
 
-        // Refresh the table
-        refreshPlaylist();
-    }
-    // 'Left Deck' loading buttons in the tableComponent
-    else if (button->getName() == "leftDeck")
-    {
-        // Get the track id from the component id on the button
-        int trackID = button->getComponentID().getIntValue();
-
-        // Load the relevant track from the music library
-        try {
-            // Get the track from the library
-            MusicTrack track{ musicLibrary.getTrack(trackID) };
-
-            // Load the file to the correct deck
-            leftDeck->loadURL(track.getAudioURL(), track.getFileName());
-        }        
-        catch(const std::exception& e) // there was an error looking up the track
+        // Load the file to the deck, if it hasn't been moved or deleted
+        if (track.getAudioURL().getLocalFile().existsAsFile())
         {
-            DBG(e.what());
+            deck->loadURL(track.getAudioURL(), track.getFileName());
         }
+        else
+        {
+            playlistMessageBox.setText("The file for this track no longer exists at its saved location.",
+                juce::dontSendNotification);
+        }
+    }        
+    catch(const std::exception& e) // there was an error looking up the track
+    {
+        DBG(e.what());
+    }
+}
+
+// Decks are listed by number, in the order they appear
+void PlaylistComponent::chooseDeckForTrack(int trackID)
+{
+    int numDecks = deckManager.getNumDecks();
+    if (numDecks == 0)
+    {
+        playlistMessageBox.setText("Add a deck to load tracks to.", juce::dontSendNotification);
+        return;
     }
-    // 'Right Deck' loading buttons in the tableComponent
-    else if (button->getName() == "rightDeck")
+    if (numDecks == 1)
     {
-        // Get the track id from the component id on the button
-        int trackID = button->getComponentID().getIntValue();
+        loadTrackToDeck(trackID, deckManager.getDeckGUI(0));
+        return;
+    }
 
-        // Load the relevant track from the music library
-        try {
-            // Get the track from the library
-            MusicTrack track{ musicLibrary.getTrack(trackID) };
+    // List the decks
+    juce::PopupMenu menu;
+    for (int i = 0; i < numDecks; ++i)
+    {
+        menu.addItem(i + 1, "Deck " + juce::String(i + 1));
+    }
 
-            // Load the file to the correct deck
-            rightDeck->loadURL(track.getAudioURL(), track.getFileName());
-        }
-        catch (const std::exception& e) // there was an error looking up the track
+    // Load the track to the chosen deck, if the playlist and deck are
+    // still there
+    juce::Component::SafePointer<PlaylistComponent> safeThis{ this };
+    menu.showMenuAsync(juce::PopupMenu::Options{}.withMousePosition(), 
+        [safeThis, trackID](int result)
         {
-            DBG(e.what());
-        }
-    }
+            if (safeThis == nullptr || result == 0)
+            {
+                return;
+            }
+            if (DeckGUI* deck = safeThis->deckManager.getDeckGUI(result - 1))
+            {
+                safeThis->loadTrackToDeck(trackID, deck);
+            }
+        });
+}
+
+// Draws a button-style box and label for the action columns
+void PlaylistComponent::paintCellButton(juce::Graphics& g, const juce::String& text, int width, int height)
+{
+    // Use the same colours as the look and feel's text buttons
+    auto buttonArea = juce::Rectangle<int>{ width, height }.reduced(2).toFloat();
+    g.setColour(getLookAndFeel().findColour(juce::TextButton::buttonColourId));
+    g.fillRoundedRectangle(buttonArea, 4.0f);
+    g.setColour(getLookAndFeel().findColour(juce::ComboBox::outlineColourId));
+    g.drawRoundedRectangle(buttonArea.reduced(0.5f), 4.0f, 1.0f);
+
+    // Draw the button text
+    g.setColour(getLookAndFeel().findColour(juce::TextButton::textColourOffId));
+    g.drawText(text, buttonArea, juce::Justification::centred, true);
+}
+
+// Called as the search term is typed, so results update with every keystroke.
+void PlaylistComponent::textEditorTextChanged(juce::TextEditor& textEditor)
+{
+    searchPlaylist(textEditor.getText());
 }
 
 // Called when a search term is entered to search the playlist for tracks.
 void PlaylistComponent::textEditorReturnKeyPressed(juce::TextEditor& textEditor)
 {
-    // Get the search term
-    juce::String searchText = textEditor.getText();
+    searchPlaylist(textEditor.getText());
+}
 
-    // If search box text is deleted and entered, clear search results
-    if (textEditor.isEmpty())
+void PlaylistComponent::searchPlaylist(const juce::String& searchText)
+{
+    // If search box text is deleted, clear search results
+    if (searchText.trim().isEmpty())
     {
         // Clear the search and revert to displaying whole library
         clearSearch();
+        return;
     }
-    // Otherwise, search for the entered term
-    else
-    {   
-        // Check the library for matching tracks
-        std::vector<MusicTrack> matchedTracks = musicLibrary.searchLibrary(searchText);
 
-        // Display results
-        if (!matchedTracks.empty())
-        {
-            // Update the playlist to show the search results
-            shownTracks.clear(); 
-            shownTracks = matchedTracks;
-            tableComponent.updateContent();
-
-            // Repaint to update row data in case of consecutive searches, 
-            // ... which doesn't change the number of rows and therefore will not 
-            // ... be updated by updateContent()
-            repaint();
-
-            // Display success message
-            playlistMessageBox.setText("Displaying search results...",
-                juce::dontSendNotification);
-        }
-        // If no results were found, show message
-        else
-        {
-            playlistMessageBox.setText("No results for your search were found. Displaying all tracks in your library.", juce::dontSendNotification);
+    // Filter the playlist view by the search term
+    playlistView.setFilter(searchText);
+    tableComponent.updateContent();
 
-            // Show full music library 
-            refreshPlaylist();
-        }
+    // Repaint to update row data in case of consecutive searches, 
+    // ... which doesn't change the number of rows and therefore will not 
+    // ... be updated by updateContent()
+    repaint();
+
+    // Display a message for the results
+    if (playlistView.getNumRows() > 0)
+    {
+        playlistMessageBox.setText("Displaying search results...",
+            juce::dontSendNotification);
+    }
+    else
+    {
+        playlistMessageBox.setText("No results for your search were found.",
+            juce::dontSendNotification);
     }
 }
 
-void PlaylistComponent::clearSearch()
+// Called on the message thread as batches of imported tracks are added
+void PlaylistComponent::importProgressChanged(int tracksProcessed, int tracksTotal)
+{
+    // Show the new tracks, including any that match an active search
+    refreshPlaylist();
+
+    // Update the playlist message
+    playlistMessageBox.setText("Importing tracks... " + juce::String{ tracksProcessed } 
+                               + " of " + juce::String{ tracksTotal },
+                               juce::dontSendNotification);
+}
+
+void PlaylistComponent::importFinished(int tracksAdded)
+{
+    // Update the playlist message
+    playlistMessageBox.setText("Import finished. " + juce::String{ tracksAdded } 
+                               + " tracks were added to your library.",
+                               juce::dontSendNotification);
+}
+
+// Called on the message thread as tracks' beats are found, which can be
+// after the import has finished. Refreshing re-sorts the view, in case
+// it's sorted by BPM.
+void PlaylistComponent::beatGridsChanged()
 {
-    // Clear the search results and revert to showing all tracks
     refreshPlaylist();
+}
+
+void PlaylistComponent::clearSearch()
+{
+    // Clear the search filter and revert to showing all tracks
+    playlistView.setFilter({});
+    tableComponent.updateContent();
+    tableComponent.repaint();
 
     // Update the playlist message
     playlistMessageBox.setText("Displaying all tracks in your library.",
         juce::dontSendNotification);
 
-    // Clear the search term from the search box
-    searchBox.setText("");
+    // Clear the search term from the search box, without searching again
+    searchBox.setText("", false);
 }
 
 void PlaylistComponent::refreshPlaylist()
 {
-    shownTracks.clear();                        // Clear the tracks
-    shownTracks = musicLibrary.getTracks();     // Get fresh set from the library
+    playlistView.refresh();                     // Rebuild the view from the library
     tableComponent.updateContent();             // Update the table
+    tableComponent.repaint();                   // Redraw rows whose tracks changed
 }
 
 
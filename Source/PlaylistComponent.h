@@ -4,14 +4,16 @@
 #include <string>
 #include <JuceHeader.h>
 #include "MusicLibrary.h"
-#include "DeckGUI.h"
+#include "PlaylistView.h"
+#include "DeckManager.h"
 #include "MainLookAndFeel.h"
 
 
 class PlaylistComponent  : public juce::Component,
                            public juce::TableListBoxModel,
                            public juce::Button::Listener,
-                           public juce::TextEditor::Listener
+                           public juce::TextEditor::Listener,
+                           public MusicLibrary::Listener
 {
 public:
     /** 
@@ -20,14 +22,14 @@ public:
      * @param _formatManager - Reference to the shared audio format manager
      *                         for the app. Used to create a source reader 
      *                         for playlist tracks.
-     * @param _leftDeck      - Pointer to the left deck GUI. Used to load
-     *                         tracks from the playlist to the left deck.
-     * @param _rightDeck     - Pointer to the right deck GUI. Used to load
-     *                         tracks from the playlist to the right deck.
+     * @param _thumbCache    - Reference to the shared thumbnail cache. Used
+     *                         to build thumbnails for imported tracks.
+     * @param _deckManager   - Reference to the deck manager. Used to load
+     *                         tracks from the playlist to the decks.
      */
     PlaylistComponent(juce::AudioFormatManager& _formatManager, 
-                      DeckGUI* _leftDeck, 
-                      DeckGUI* _rightDeck);
+                      PersistentThumbnailCache& _thumbCache,
+                      DeckManager& _deckManager);
 
     /** 
      * Destructor 
@@ -73,7 +75,8 @@ private:
                     bool rowIsSelected) override;
 
     /** 
-     * Implements TableListBoxModel: Draws contents of individual cells. 
+     * Implements TableListBoxModel: Draws contents of individual cells, 
+     * including the deck loading and track removal buttons. 
      *
      * @param g             - The graphics context
      * @param rowNumber     - The number of the row
@@ -90,19 +93,23 @@ private:
                     bool rowIsSelected) override;
 
     /** 
-     * Implements TableListBoxModel: Draws custom components in cells. 
-     * This is used to draw deck loading and track removal buttons.
+     * Implements TableListBoxModel: Processes clicks on cells. This is used
+     * for the deck loading and track removal buttons drawn in the cells.
      * 
-     * @param rowNumber                 - The number of the row
-     * @param columnId                  - The ID of the column
-     * @param isRowSelected             - Whether the row is selected
-     * @param existingComponentToUpdate - A pointer to the custom component to 
-     *     draw in the cell, or else a nullptr if no custom component is desired
+     * @param rowNumber - The number of the row
+     * @param columnId  - The ID of the column
+     * @param event     - The mouse event for the click
      */
-    juce::Component* refreshComponentForCell(int rowNumber, 
-                    int columnId, 
-                    bool isRowSelected, 
-                    juce::Component* existingComponentToUpdate) override;
+    void cellClicked(int rowNumber, int columnId, const juce::MouseEvent& event) override;
+
+    /**
+     * Implements TableListBoxModel: Sorts the playlist when a column 
+     * header is clicked.
+     *
+     * @param newSortColumnId - The ID of the column to sort by, or 0 for none.
+     * @param isForwards      - True to sort in ascending order.
+     */
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
 
     /**
      * Implements Button::Listener: Processes button clicks.
@@ -111,6 +118,13 @@ private:
      */
     void buttonClicked(juce::Button* button) override;
 
+    /** 
+     * Implements TextEditor Listener: Searches as text is typed in the search box. 
+     *
+     * @param textEditor - The text editor component that triggered the event.
+     */
+    void textEditorTextChanged(juce::TextEditor& textEditor) override;
+
     /** 
      * Implements TextEditor Listener: Processes entered text in the search box. 
      *
@@ -118,6 +132,63 @@ private:
      */
     void textEditorReturnKeyPressed(juce::TextEditor& textEditor) override;
 
+    /**
+     * Shows the tracks matching a search term, or the whole library if the 
+     * search term is empty.
+     *
+     * @param searchText - The search term.
+     */
+    void searchPlaylist(const juce::String& searchText);
+
+    /**
+     * Implements MusicLibrary::Listener: Shows the progress of a background
+     * import and refreshes the playlist with the tracks added so far.
+     *
+     * @param tracksProcessed - The number of files probed so far.
+     * @param tracksTotal     - The number of files found to import so far.
+     */
+    void importProgressChanged(int tracksProcessed, int tracksTotal) override;
+
+    /**
+     * Implements MusicLibrary::Listener: Shows a message when a background
+     * import has finished.
+     *
+     * @param tracksAdded - The number of tracks added to the library.
+     */
+    void importFinished(int tracksAdded) override;
+
+    /**
+     * Implements MusicLibrary::Listener: Shows newly analysed tempos.
+     */
+    void beatGridsChanged() override;
+
+    /**
+     * Loads a track from the music library to a deck.
+     *
+     * @param trackID - The unique ID of the track in the music library.
+     * @param deck    - Pointer to the deck GUI to load the track to.
+     */
+    void loadTrackToDeck(int trackID, DeckGUI* deck);
+
+    /**
+     * Shows a menu of the decks to load a track to, or loads it straight
+     * away if there's only one deck.
+     *
+     * @param trackID - The unique ID of the track in the music library.
+     */
+    void chooseDeckForTrack(int trackID);
+
+    /**
+     * Draws a button in a table cell, in the style of the look and feel's 
+     * text buttons.
+     *
+     * @param g      - The graphics context of the cell
+     * @param text   - The button text
+     * @param width  - The width of the graphics context
+     * @param height - The height of the graphics context
+     */
+    void paintCellButton(juce::Graphics& g, const juce::String& text, int width, int height);
+
     /** 
      * Clears the search box and any shown search results. 
      */
@@ -130,11 +201,10 @@ private:
 
     // The user's music library 
     MusicLibrary musicLibrary;
-    // The playlist's shown tracks displayed in the table component
-    std::vector<MusicTrack> shownTracks;
-    // Pointers to the deck GUI components, for loading tracks
-    DeckGUI* rightDeck;
-    DeckGUI* leftDeck;
+    // View of the library tracks displayed in the table component
+    PlaylistView playlistView{ musicLibrary };
+    // The decks, for loading tracks
+    DeckManager& deckManager;
     // Pointer for a file chooser to add tracks
     std::unique_ptr<juce::FileChooser> chooser;
     // Path to home directory for selecting tracks to add
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <JuceHeader.h>
+#include "PlaylistView.h"
+
+
+PlaylistView::PlaylistView(MusicLibrary& _library)
+    : library{ _library }
+{
+}
+
+PlaylistView::~PlaylistView()
+{
+}
+
+void PlaylistView::refresh()
+{
+    if (isFiltered())
+    {
+        // Search results come back in the order tracks were added
+        trackIDs = library.searchLibrary(filter);
+    }
+    else
+    {
+        // Collect the IDs of every track in the library
+        const std::vector<MusicTrack>& tracks = library.getTracks();
+        trackIDs.clear();
+        trackIDs.reserve(tracks.size());
+        for (const MusicTrack& track : tracks)
+        {
+            trackIDs.push_back(track.getTrackID());
+        }
+        // Tracks are stored out of order once any have been removed
+        std::sort(trackIDs.begin(), trackIDs.end());
+    }
+
+    // IDs are now in the order tracks were added, which is the default order
+    if (sortKey != SortKey::dateAdded || !sortForwards)
+    {
+        sortTrackIDs();
+    }
+}
+
+void PlaylistView::setFilter(const juce::String& searchText)
+{
+    filter = searchText.trim();
+    refresh();
+}
+
+bool PlaylistView::isFiltered() const
+{
+    return filter.isNotEmpty();
+}
+
+void PlaylistView::setSortOrder(SortKey _sortKey, bool _sortForwards)
+{
+    sortKey = _sortKey;
+    sortForwards = _sortForwards;
+    sortTrackIDs();
+}
+
+void PlaylistView::removeTrack(int trackID)
+{
+    trackIDs.erase(std::remove(trackIDs.begin(), trackIDs.end(), trackID), trackIDs.end());
+}
+
+int PlaylistView::getNumRows() const
+{
+    return (int) trackIDs.size();
+}
+
+int PlaylistView::getTrackID(int rowNumber) const
+{
+    if (rowNumber < 0 || rowNumber >= getNumRows())
+    {
+        return 0;
+    }
+    return trackIDs[(size_t) rowNumber];
+}
+
+const MusicTrack* PlaylistView::getTrack(int rowNumber) const
+{
+    if (rowNumber < 0 || rowNumber >= getNumRows())
+    {
+        return nullptr;
+    }
+    return library.findTrack(trackIDs[(size_t) rowNumber]);
+}
+
+// Tracks with equal keys are kept in the order they were added. Tracks are 
+// looked up in the library for each comparison, which is a hash lookup 
+// rather than a copy.
+void PlaylistView::sortTrackIDs()
+{
+    // Compares two tracks by the sort key, falling back to the ID
+    auto isBefore = [this](int a, int b) {
+        if (sortKey == SortKey::dateAdded)
+        {
+            return a < b;
+        }
+        const MusicTrack* trackA = library.findTrack(a);
+        const MusicTrack* trackB = library.findTrack(b);
+        if (trackA == nullptr || trackB == nullptr)
+        {
+            return a < b;
+        }
+        if (sortKey == SortKey::fileName)
+        {
+            int comparison = trackA->getFileName().compareNatural(trackB->getFileName());
+            return comparison != 0 ? comparison < 0 : a < b;
+        }
+        if (sortKey == SortKey::bpm)
+        {
+            double bpmA = trackA->getBeatGrid().bpm;
+            double bpmB = trackB->getBeatGrid().bpm;
+            return bpmA != bpmB ? bpmA < bpmB : a < b;
+        }
+        double lengthA = trackA->getLengthInSeconds();
+        double lengthB = trackB->getLengthInSeconds();
+        return lengthA != lengthB ? lengthA < lengthB : a < b;
+    };
+
+    // Sort in the chosen direction
+    if (sortForwards)
+    {
+        std::sort(trackIDs.begin(), trackIDs.end(), isBefore);
+    }
+    else
+    {
+        std::sort(trackIDs.begin(), trackIDs.end(), 
+            [&isBefore](int a, int b) { return isBefore(b, a); });
+    }
+}
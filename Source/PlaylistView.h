@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <JuceHeader.h>
+#include "MusicLibrary.h"
+
+
+/**
+ * A lightweight view of the music library for the playlist table. The view 
+ * only holds the IDs of the tracks to show, along with the search filter and 
+ * sort order used to choose them. Track data is read from the library when 
+ * a row is drawn, so refreshing the view never copies tracks.
+ */
+class PlaylistView
+{
+public:
+    /** The track properties the view can be sorted by */
+    enum class SortKey
+    {
+        dateAdded,
+        fileName,
+        length,
+        bpm
+    };
+
+    /**
+     * Constructor
+     *
+     * @param _library - Reference to the music library to view.
+     */
+    PlaylistView(MusicLibrary& _library);
+
+    /**
+     * Destructor
+     */
+    ~PlaylistView();
+
+    /**
+     * Rebuilds the list of shown track IDs from the library, applying the
+     * current filter and sort order. Call after tracks are added or removed.
+     */
+    void refresh();
+
+    /**
+     * Sets the search filter and refreshes the view.
+     *
+     * @param searchText - The search term, or an empty string to show every track.
+     */
+    void setFilter(const juce::String& searchText);
+
+    /**
+     * Checks whether the view is filtered by a search term.
+     *
+     * @return True if a search filter is set.
+     */
+    bool isFiltered() const;
+
+    /**
+     * Sets the sort order and re-sorts the shown tracks.
+     *
+     * @param _sortKey      - The track property to sort by.
+     * @param _sortForwards - True to sort in ascending order.
+     */
+    void setSortOrder(SortKey _sortKey, bool _sortForwards);
+
+    /**
+     * Removes a track from the view without rebuilding it.
+     *
+     * @param trackID - The unique ID of the removed track.
+     */
+    void removeTrack(int trackID);
+
+    /**
+     * Gets the number of shown tracks.
+     *
+     * @return The number of rows in the view.
+     */
+    int getNumRows() const;
+
+    /**
+     * Gets the ID of the track shown in a row.
+     *
+     * @param rowNumber - The row number.
+     * @return The track ID, or 0 if the row is out of range.
+     */
+    int getTrackID(int rowNumber) const;
+
+    /**
+     * Gets the track shown in a row, straight from the library.
+     *
+     * @param rowNumber - The row number.
+     * @return A pointer to the track, or nullptr if the row is out of range.
+     *     This is valid until the next track is added to or removed from 
+     *     the library.
+     */
+    const MusicTrack* getTrack(int rowNumber) const;
+
+private:
+    /**
+     * Sorts the shown track IDs by the current sort order.
+     */
+    void sortTrackIDs();
+
+    // The music library being viewed
+    MusicLibrary& library;
+    // IDs of the tracks shown, in display order
+    std::vector<int> trackIDs;
+    // The search filter
+    juce::String filter;
+    // The sort order
+    SortKey sortKey{ SortKey::dateAdded };
+    bool sortForwards{ true };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistView)
+};
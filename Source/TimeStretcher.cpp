@@ -0,0 +1,302 @@
+#include <cmath>
+#include <cstring>
+#include <JuceHeader.h>
+#include "TimeStretcher.h"
+
+
+namespace
+{
+    /** Frame and search settings for a quality level. */
+    struct QualitySettings
+    {
+        double frameSeconds;
+        double searchSeconds;
+        int searchStep;
+    };
+
+    /** Gets the settings for a quality level. */
+    QualitySettings getSettings(TimeStretcher::Quality quality)
+    {
+        switch (quality)
+        {
+            case TimeStretcher::Quality::low:    return { 0.020, 0.005, 4 };
+            case TimeStretcher::Quality::high:   return { 0.040, 0.014, 1 };
+            case TimeStretcher::Quality::medium: 
+            default:                             return { 0.030, 0.010, 2 };
+        }
+    }
+}
+
+
+TimeStretcher::TimeStretcher(juce::AudioSource* _input)
+    : input{ _input }
+{
+}
+
+TimeStretcher::~TimeStretcher()
+{
+}
+
+void TimeStretcher::prepareToPlay(int, double _sampleRate)
+{
+    sampleRate = _sampleRate;
+
+    // Size the buffers for the largest frame and search range, so the
+    // quality can be changed without allocating on the audio thread
+    QualitySettings largest = getSettings(Quality::high);
+    int maxFrameLength = static_cast<int>(largest.frameSeconds * sampleRate) + 2;
+    int maxSearchRange = static_cast<int>(largest.searchSeconds * sampleRate) + 1;
+    // Enough input for a frame at the furthest point of its search range,
+    // plus the gap to the next frame at the highest tempo
+    int inputCapacity = static_cast<int>(maxFrameLength * (maxTempo / 2 + 2)) + 4 * maxSearchRange + 16;
+
+    window.allocate(static_cast<size_t>(maxFrameLength), true);
+    inputBuffer.setSize(2, inputCapacity);
+    inputMix.allocate(static_cast<size_t>(inputCapacity), true);
+    overlapBuffer.setSize(2, maxFrameLength);
+
+    configure();
+}
+
+void TimeStretcher::releaseResources()
+{
+    window.free();
+    inputBuffer.setSize(0, 0);
+    inputMix.free();
+    overlapBuffer.setSize(0, 0);
+    sampleRate = 0;
+}
+
+void TimeStretcher::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto* buffer = bufferToFill.buffer;
+
+    // Output silence if not prepared, or if the tempo is too slow to stretch
+    if (sampleRate <= 0 || tempo < minTempo)
+    {
+        buffer->clear(bufferToFill.startSample, bufferToFill.numSamples);
+        return;
+    }
+
+    int numWritten = 0;
+    while (numWritten < bufferToFill.numSamples)
+    {
+        // Build another frame once the ready samples have all been used
+        if (numReady == 0)
+        {
+            makeFrame();
+        }
+
+        // Copy out as many ready samples as will fit
+        int numToCopy = juce::jmin(numReady, bufferToFill.numSamples - numWritten);
+        for (int channel = 0; channel < buffer->getNumChannels(); ++channel)
+        {
+            buffer->copyFrom(channel, bufferToFill.startSample + numWritten,
+                             overlapBuffer, juce::jmin(channel, 1), readyPosition, numToCopy);
+        }
+        readyPosition += numToCopy;
+        numReady -= numToCopy;
+        numWritten += numToCopy;
+    }
+}
+
+void TimeStretcher::setTempo(double _tempo)
+{
+    tempo = juce::jmin(_tempo, maxTempo);
+}
+
+void TimeStretcher::setQuality(Quality _quality)
+{
+    if (quality != _quality)
+    {
+        quality = _quality;
+        configure();
+    }
+}
+
+void TimeStretcher::reset()
+{
+    inputBuffer.clear();
+    overlapBuffer.clear();
+    inputStart = 0;
+    numBuffered = 0;
+    nominalPosition = 0;
+    previousFrameStart = -1;
+    readyPosition = 0;
+    numReady = 0;
+}
+
+void TimeStretcher::configure()
+{
+    if (sampleRate <= 0)
+    {
+        return;
+    }
+
+    // Convert the settings to samples. Frames are an even length, so two
+    // half-overlapping windows sum to exactly one.
+    QualitySettings settings = getSettings(quality);
+    frameLength = static_cast<int>(settings.frameSeconds * sampleRate) & ~1;
+    hopLength = frameLength / 2;
+    searchRange = static_cast<int>(settings.searchSeconds * sampleRate);
+    searchStep = settings.searchStep;
+
+    // Periodic Hann window
+    for (int i = 0; i < frameLength; ++i)
+    {
+        window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * i / frameLength);
+    }
+
+    reset();
+}
+
+void TimeStretcher::makeFrame()
+{
+    // Move the samples still overlapping to the front, ready for the next frame
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* samples = overlapBuffer.getWritePointer(channel);
+        std::memmove(samples, samples + hopLength, sizeof(float) * static_cast<size_t>(frameLength - hopLength));
+        std::memset(samples + frameLength - hopLength, 0, sizeof(float) * static_cast<size_t>(hopLength));
+    }
+
+    // Pick where to take the frame from. The first frame has nothing to match.
+    juce::int64 nominalStart = static_cast<juce::int64>(nominalPosition);
+    juce::int64 frameStart = nominalStart;
+    if (previousFrameStart >= 0)
+    {
+        juce::int64 naturalStart = previousFrameStart + hopLength;
+        juce::int64 searchStart = juce::jmax(inputStart, nominalStart - searchRange);
+        juce::int64 searchEnd = nominalStart + searchRange;
+        fillInput(juce::jmax(searchEnd, naturalStart) + frameLength);
+        frameStart = findBestFrameStart(searchStart, searchEnd, naturalStart);
+    }
+    else
+    {
+        fillInput(frameStart + frameLength);
+    }
+
+    // Overlap-add the windowed frame
+    int offset = static_cast<int>(frameStart - inputStart);
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        const float* source = inputBuffer.getReadPointer(channel, offset);
+        float* destination = overlapBuffer.getWritePointer(channel);
+        for (int i = 0; i < frameLength; ++i)
+        {
+            destination[i] += source[i] * window[i];
+        }
+    }
+
+    // The first hop is now complete
+    readyPosition = 0;
+    numReady = hopLength;
+
+    // Step on by the tempo-scaled hop, and drop input no frame can use again
+    previousFrameStart = frameStart;
+    nominalPosition += hopLength * tempo;
+    discardInput(juce::jmin(static_cast<juce::int64>(nominalPosition) - searchRange,
+                            frameStart + hopLength));
+}
+
+juce::int64 TimeStretcher::findBestFrameStart(juce::int64 searchStart,
+                                              juce::int64 searchEnd,
+                                              juce::int64 naturalStart) const
+{
+    int natural = static_cast<int>(naturalStart - inputStart);
+    int first = static_cast<int>(searchStart - inputStart);
+    int last = static_cast<int>(searchEnd - inputStart);
+
+    // Coarse search, comparing every searchStep-th candidate and sample
+    int best = first;
+    float bestSimilarity = -1.0e30f;
+    for (int candidate = first; candidate <= last; candidate += searchStep)
+    {
+        float similarity = getSimilarity(candidate, natural, searchStep);
+        if (similarity > bestSimilarity)
+        {
+            bestSimilarity = similarity;
+            best = candidate;
+        }
+    }
+
+    // Refine around the best candidate at full resolution
+    if (searchStep > 1)
+    {
+        int coarseBest = best;
+        bestSimilarity = -1.0e30f;
+        for (int candidate = juce::jmax(first, coarseBest - searchStep + 1);
+             candidate <= juce::jmin(last, coarseBest + searchStep - 1); ++candidate)
+        {
+            float similarity = getSimilarity(candidate, natural, 1);
+            if (similarity > bestSimilarity)
+            {
+                bestSimilarity = similarity;
+                best = candidate;
+            }
+        }
+    }
+
+    return inputStart + best;
+}
+
+float TimeStretcher::getSimilarity(int candidate, int natural, int step) const
+{
+    // Compare over the half of the frame that overlaps the previous one
+    float correlation = 0;
+    float energy = 1.0e-9f;
+    for (int i = 0; i < hopLength; i += step)
+    {
+        float sample = inputMix[candidate + i];
+        correlation += sample * inputMix[natural + i];
+        energy += sample * sample;
+    }
+    return correlation / std::sqrt(energy);
+}
+
+void TimeStretcher::fillInput(juce::int64 endPosition)
+{
+    int numRequired = static_cast<int>(endPosition - inputStart);
+    if (numRequired <= numBuffered)
+    {
+        return;
+    }
+    // The buffer is sized so this can't happen, but don't overrun it if it does
+    jassert(numRequired <= inputBuffer.getNumSamples());
+    numRequired = juce::jmin(numRequired, inputBuffer.getNumSamples());
+
+    // Read the missing samples after the ones already buffered
+    juce::AudioSourceChannelInfo info{ &inputBuffer, numBuffered, numRequired - numBuffered };
+    input->getNextAudioBlock(info);
+
+    // Mix them to mono for matching frames
+    const float* left = inputBuffer.getReadPointer(0);
+    const float* right = inputBuffer.getReadPointer(1);
+    for (int i = numBuffered; i < numRequired; ++i)
+    {
+        inputMix[i] = left[i] + right[i];
+    }
+
+    numBuffered = numRequired;
+}
+
+void TimeStretcher::discardInput(juce::int64 position)
+{
+    int numDiscarded = juce::jlimit(0, numBuffered, static_cast<int>(position - inputStart));
+    if (numDiscarded == 0)
+    {
+        return;
+    }
+
+    // Move the samples still needed to the front of the buffer
+    int numRemaining = numBuffered - numDiscarded;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* samples = inputBuffer.getWritePointer(channel);
+        std::memmove(samples, samples + numDiscarded, sizeof(float) * static_cast<size_t>(numRemaining));
+    }
+    std::memmove(inputMix.get(), inputMix.get() + numDiscarded, sizeof(float) * static_cast<size_t>(numRemaining));
+
+    inputStart += numDiscarded;
+    numBuffered = numRemaining;
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+
+/**
+ * Changes the tempo of an audio source without changing its pitch, using
+ * waveform similarity overlap-add (WSOLA).
+ *
+ * Output is built from half-overlapping windowed frames of the input. The
+ * frames are taken a tempo-scaled distance apart, and each one is nudged
+ * within a small search range to the offset that best lines up with the
+ * audio the previous frame would have continued into, so the overlaps add
+ * without phasing. Work is done one frame at a time, so the cost per block
+ * is bounded by the frame size and search range, and the latency is about
+ * one frame.
+ *
+ * Only call the setters on the audio thread, between calls to
+ * getNextAudioBlock().
+ */
+class TimeStretcher : public juce::AudioSource
+{
+public:
+    /** Trade-off between CPU use and smoothness. */
+    enum class Quality
+    {
+        low,        // Short frames and a coarse search, for previews
+        medium,     // Suitable for most material
+        high        // Long frames and a fine search, for sustained sounds
+    };
+
+    /**
+     * Constructor
+     *
+     * @param _input - The source to stretch. Not owned by the stretcher.
+     */
+    TimeStretcher(juce::AudioSource* _input);
+
+    /** Destructor */
+    ~TimeStretcher();
+
+    /**
+     * Implements AudioSource: Allocates buffers for the input sample rate.
+     * Does not prepare the input source.
+     *
+     * @param samplesPerBlockExpected - The expected block size.
+     * @param _sampleRate - The sample rate of the input.
+     */
+    void prepareToPlay(int samplesPerBlockExpected, double _sampleRate) override;
+
+    /**
+     * Implements AudioSource: Frees the buffers.
+     */
+    void releaseResources() override;
+
+    /**
+     * Implements AudioSource: Fills a block with stretched audio.
+     *
+     * @param bufferToFill - The audio source buffer.
+     */
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    /**
+     * Sets the tempo, as a multiple of the input's tempo. Takes effect at
+     * the next frame.
+     *
+     * @param _tempo - The tempo ratio, between minTempo and maxTempo.
+     */
+    void setTempo(double _tempo);
+
+    /**
+     * Sets the quality. Changing it restarts the stretcher.
+     *
+     * @param _quality - The new quality.
+     */
+    void setQuality(Quality _quality);
+
+    /**
+     * Clears all buffered audio, for a jump in the input or a restart.
+     */
+    void reset();
+
+    // Tempo limits. Below minTempo, the stretcher outputs silence.
+    static constexpr double minTempo{ 0.1 };
+    static constexpr double maxTempo{ 4.0 };
+
+private:
+    /**
+     * Sets the frame and search sizes for the current quality, and clears
+     * all buffered audio.
+     */
+    void configure();
+
+    /**
+     * Builds the next frame of output: picks the best-matching input frame,
+     * and overlap-adds it into the output buffer.
+     */
+    void makeFrame();
+
+    /**
+     * Finds the input frame start within the search range that best matches
+     * the natural continuation of the previous frame.
+     *
+     * @param searchStart  - The first candidate start, as an input position.
+     * @param searchEnd    - The last candidate start, as an input position.
+     * @param naturalStart - Where the previous frame would have continued.
+     * @return The best frame start, as an input position.
+     */
+    juce::int64 findBestFrameStart(juce::int64 searchStart,
+                                   juce::int64 searchEnd,
+                                   juce::int64 naturalStart) const;
+
+    /**
+     * Measures how well the input at a candidate frame start matches the
+     * natural continuation, over the overlapping half of the frame.
+     *
+     * @param candidate - Index of the candidate in the input buffer.
+     * @param natural   - Index of the natural continuation in the input buffer.
+     * @param step      - Compare every step-th sample.
+     * @return The correlation, normalised by the candidate's energy.
+     */
+    float getSimilarity(int candidate, int natural, int step) const;
+
+    /**
+     * Reads from the input until it is buffered up to a position.
+     *
+     * @param endPosition - The input position to buffer up to, exclusive.
+     */
+    void fillInput(juce::int64 endPosition);
+
+    /**
+     * Drops buffered input before a position.
+     *
+     * @param position - The first input position still needed.
+     */
+    void discardInput(juce::int64 position);
+
+    // Source of audio to stretch
+    juce::AudioSource* input;
+    // Sample rate of the input
+    double sampleRate{ 0 };
+    // Current tempo and quality
+    double tempo{ 1.0 };
+    Quality quality{ Quality::medium };
+
+    /*------------- Frame Settings ------------*/
+    // Length of each frame, and the distance between frames in the output
+    int frameLength{ 0 };
+    int hopLength{ 0 };
+    // How far either side of its nominal position a frame can be moved
+    int searchRange{ 0 };
+    // Spacing of the coarse search, in candidates and compared samples
+    int searchStep{ 1 };
+    // Hann window for the current frame length
+    juce::HeapBlock<float> window;
+
+    /*------------- Input ------------*/
+    // Buffered input, and the mono mix of it used for matching frames
+    juce::AudioBuffer<float> inputBuffer;
+    juce::HeapBlock<float> inputMix;
+    // Input position of the first buffered sample, and the number buffered
+    juce::int64 inputStart{ 0 };
+    int numBuffered{ 0 };
+    // Where the next frame would start if the tempo were followed exactly
+    double nominalPosition{ 0 };
+    // Where the previous frame started, or -1 before the first frame
+    juce::int64 previousFrameStart{ -1 };
+
+    /*------------- Output ------------*/
+    // Overlap-add buffer. The first hopLength samples are ready to output.
+    juce::AudioBuffer<float> overlapBuffer;
+    // Next ready sample to output, and the number left
+    int readyPosition{ 0 };
+    int numReady{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeStretcher)
+};
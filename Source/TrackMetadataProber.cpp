@@ -0,0 +1,189 @@
+#include <JuceHeader.h>
+#include "TrackMetadataProber.h"
+
+
+TrackMetadataProber::TrackMetadataProber(juce::AudioFormatManager& _formatManager)
+    : formatManager{ _formatManager }
+{
+}
+
+TrackMetadataProber::~TrackMetadataProber()
+{
+}
+
+// Creating a format reader only parses the file header, so no audio data
+// is decoded here. A new reader is made for each call, which keeps the 
+// prober safe to share between import threads.
+bool TrackMetadataProber::probe(const juce::File& file, TrackMetadata& metadata) const
+{
+    // Create a reader for the file
+    std::unique_ptr<juce::AudioFormatReader> reader{ readerFactory.createReaderFor(file) };
+
+    // Check that the file could be read
+    if (reader == nullptr || reader->sampleRate <= 0)
+    {
+        return false;
+    }
+
+    // Copy the format information from the header
+    metadata.lengthInSamples = reader->lengthInSamples;
+    metadata.sampleRate = reader->sampleRate;
+    metadata.numChannels = (int) reader->numChannels;
+    metadata.bitsPerSample = (int) reader->bitsPerSample;
+
+    // Copy any tags the reader found, then look for an ID3 tag
+    readReaderTags(reader->metadataValues, metadata);
+    readID3Tags(file, metadata);
+
+    return true;
+}
+
+// Different formats use different names for the same tags, so the first
+// name with a value is used for each one.
+void TrackMetadataProber::readReaderTags(const juce::StringPairArray& metadataValues,
+                                         TrackMetadata& metadata)
+{
+    // Returns the first non-empty value out of a list of possible keys
+    auto findTag = [&metadataValues](std::initializer_list<const char*> keys) {
+        for (const char* key : keys)
+        {
+            juce::String value = metadataValues.getValue(key, {}).trim();
+            if (value.isNotEmpty())
+            {
+                return value;
+            }
+        }
+        return juce::String{};
+    };
+
+    // RIFF INFO chunks (WAV), Vorbis comments (Ogg) and Core Audio names
+    metadata.title = findTag({ "title", "INAM", "id3title" });
+    metadata.artist = findTag({ "artist", "IART", "id3artist" });
+    metadata.album = findTag({ "album", "IPRD", "id3album" });
+    metadata.genre = findTag({ "genre", "IGNR", "id3genre" });
+}
+
+void TrackMetadataProber::readID3Tags(const juce::File& file, TrackMetadata& metadata)
+{
+    // Open the file and read the tag header
+    juce::FileInputStream input{ file };
+    juce::uint8 header[10];
+    if (!input.openedOk() || input.read(header, 10) != 10)
+    {
+        return;
+    }
+
+    // Only ID3v2.3 and ID3v2.4 tags are supported
+    int majorVersion = header[3];
+    if (header[0] != 'I' || header[1] != 'D' || header[2] != '3'
+        || (majorVersion != 3 && majorVersion != 4))
+    {
+        return;
+    }
+
+    // Reads a 28-bit "synchsafe" integer, as used for ID3 sizes
+    auto readSynchsafe = [](const juce::uint8* bytes) {
+        return ((bytes[0] & 0x7f) << 21) | ((bytes[1] & 0x7f) << 14)
+             | ((bytes[2] & 0x7f) << 7) | (bytes[3] & 0x7f);
+    };
+    juce::int64 tagEnd = 10 + readSynchsafe(header + 6);
+
+    // Skip the extended header, if there is one
+    if ((header[5] & 0x40) != 0)
+    {
+        juce::uint8 sizeBytes[4];
+        if (input.read(sizeBytes, 4) != 4)
+        {
+            return;
+        }
+        // The v2.4 size includes its own 4 bytes, but the v2.3 size does not
+        int extendedSize = majorVersion == 4 ? readSynchsafe(sizeBytes) - 4
+                                             : (int) juce::ByteOrder::bigEndianInt(sizeBytes);
+        input.skipNextBytes(extendedSize);
+    }
+
+    // Read frames until the end of the tag or the start of the padding
+    while (input.getPosition() + 10 <= tagEnd)
+    {
+        juce::uint8 frameHeader[10];
+        if (input.read(frameHeader, 10) != 10 || frameHeader[0] == 0)
+        {
+            break;
+        }
+
+        // Get the frame ID and size
+        juce::String frameID{ (const char*) frameHeader, 4 };
+        int frameSize = majorVersion == 4 ? readSynchsafe(frameHeader + 4)
+                                          : (int) juce::ByteOrder::bigEndianInt(frameHeader + 4);
+        if (frameSize <= 0 || input.getPosition() + frameSize > tagEnd)
+        {
+            break;
+        }
+
+        // Pick out the text frames for each tag
+        juce::String* tag{ nullptr };
+        if (frameID == "TIT2")      tag = &metadata.title;
+        else if (frameID == "TPE1") tag = &metadata.artist;
+        else if (frameID == "TALB") tag = &metadata.album;
+        else if (frameID == "TCON") tag = &metadata.genre;
+
+        // Read wanted text frames, and skip everything else (such as artwork)
+        if (tag != nullptr && frameSize <= 4096)
+        {
+            juce::MemoryBlock frameData;
+            input.readIntoMemoryBlock(frameData, frameSize);
+            juce::String text = decodeID3Text(frameData).trim();
+            if (text.isNotEmpty())
+            {
+                *tag = text;
+            }
+        }
+        else
+        {
+            input.skipNextBytes(frameSize);
+        }
+    }
+}
+
+// The first byte of a text frame gives the encoding of the rest of the frame:
+// 0 = ISO-8859-1, 1 = UTF-16 with BOM, 2 = UTF-16BE without BOM, 3 = UTF-8.
+juce::String TrackMetadataProber::decodeID3Text(const juce::MemoryBlock& frameData)
+{
+    if (frameData.getSize() < 2)
+    {
+        return {};
+    }
+
+    int encoding = frameData[0];
+    const char* text = static_cast<const char*>(frameData.getData()) + 1;
+    int textSize = (int) frameData.getSize() - 1;
+
+    // UTF-16 with a BOM, and UTF-8, are both handled by JUCE
+    if (encoding == 1 || encoding == 3)
+    {
+        return juce::String::createStringFromData(text, textSize);
+    }
+
+    // Build up the string one character at a time for the other encodings
+    juce::String result;
+    if (encoding == 2)
+    {
+        for (int i = 0; i + 1 < textSize; i += 2)
+        {
+            juce::juce_wchar c = ((juce::uint8) text[i] << 8) | (juce::uint8) text[i + 1];
+            if (c == 0)
+            {
+                break;
+            }
+            result += juce::String::charToString(c);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < textSize && text[i] != 0; ++i)
+        {
+            result += juce::String::charToString((juce::juce_wchar) (juce::uint8) text[i]);
+        }
+    }
+    return result;
+}
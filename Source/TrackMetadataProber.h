@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTrack.h"
+#include "AudioFileReaderFactory.h"
+
+
+class TrackMetadataProber
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param _formatManager - Reference to the shared audio format manager
+     *      for the app. Used to create format readers that parse file headers.
+     */
+    TrackMetadataProber(juce::AudioFormatManager& _formatManager);
+
+    /**
+     * Destructor
+     */
+    ~TrackMetadataProber();
+
+    /**
+     * Reads the format header and tags of an audio file without creating any
+     * playback objects. Safe to call from several threads at once.
+     *
+     * @param file     - The audio file to probe.
+     * @param metadata - The metadata object to fill in.
+     * @return True if the file could be read as audio, otherwise false.
+     */
+    bool probe(const juce::File& file, TrackMetadata& metadata) const;
+
+private:
+    /**
+     * Copies any tags found by the format reader into the metadata.
+     *
+     * @param metadataValues - The metadata values read by the format reader.
+     * @param metadata       - The metadata object to fill in.
+     */
+    static void readReaderTags(const juce::StringPairArray& metadataValues,
+                               TrackMetadata& metadata);
+
+    /**
+     * Reads the title, artist, album and genre frames of an ID3v2 tag at the 
+     * start of a file. JUCE's MP3 reader skips over these tags, so they are
+     * parsed here. Only the tag header and the wanted frames are read.
+     *
+     * @param file     - The audio file to read.
+     * @param metadata - The metadata object to fill in.
+     */
+    static void readID3Tags(const juce::File& file, TrackMetadata& metadata);
+
+    /**
+     * Decodes the contents of an ID3v2 text frame.
+     *
+     * @param frameData - The raw frame data, starting with the encoding byte.
+     * @return The decoded text.
+     */
+    static juce::String decodeID3Text(const juce::MemoryBlock& frameData);
+
+    // Shared format manager, and reader factory for parsing headers
+    juce::AudioFormatManager& formatManager;
+    AudioFileReaderFactory readerFactory{ formatManager };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackMetadataProber)
+};
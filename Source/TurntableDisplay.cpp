@@ -5,47 +5,30 @@
 
 TurntableDisplay::TurntableDisplay()
 {
+    // The static image covers the whole component, so nothing behind it
+    // needs repainting
+    setOpaque(true);
 }
 
 TurntableDisplay::~TurntableDisplay()
 {
 }
 
-// Draws the turntable using the component's graphics object
-// Dimension values are set in resized(), so that the component can 
-// be drawn at any size.
+// Draws the turntable using the component's graphics object. The platter
+// and tone arm base come from the static image, so only the marker and
+// tone arm are drawn here.
 void TurntableDisplay::paint (juce::Graphics& g)
 {
-    // Clear the background
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));   
-    g.setColour (juce::Colours::grey);
-
-    // Draw the turntable
-    g.setColour(juce::Colours::black);
-    g.fillEllipse(turntableCentre.getX() - turntableRadius,       // outer circle
-        turntableCentre.getY() - turntableRadius,
-        turntableRadius * 2,
-        turntableRadius * 2);
-    g.setColour(juce::Colours::silver);
-    g.fillEllipse(turntableCentre.getX() - turntableInnerRadius,  // inner circle
-        turntableCentre.getY() - turntableInnerRadius,
-        turntableInnerRadius * 2,
-        turntableInnerRadius * 2);
-
-    // Draw the tone arm base
-    g.setColour(juce::Colours::dimgrey);
-    g.fillEllipse(toneArmBase.getX() - toneArmBaseRadius,         // outer circle
-        toneArmBase.getY() - toneArmBaseRadius,
-        toneArmBaseRadius * 2,
-        toneArmBaseRadius * 2);
-    g.setColour(juce::Colours::grey);
-    g.fillEllipse(toneArmBase.getX() - (toneArmBaseRadius * 0.5), // inner circle
-        toneArmBase.getY() - (toneArmBaseRadius * 0.5),
-        toneArmBaseRadius,
-        toneArmBaseRadius);
+    // Draw the platter and tone arm base
+    g.drawImageAt(staticImage, 0, 0);
 
-    // Update the needle position to the correct point in the track
-    updateNeedlePosition();
+    // Draw the platter marker
+    g.setColour(juce::Colours::white);
+    juce::Point<float> marker = turntableCentre.getPointOnCircumference(markerDistance, platterAngle);
+    g.fillEllipse(marker.getX() - markerRadius, 
+        marker.getY() - markerRadius, 
+        markerRadius * 2, 
+        markerRadius * 2);
 
     // Draw the tone arm needle
     g.setColour(juce::Colours::grey);
@@ -88,6 +71,8 @@ void TurntableDisplay::resized()
     // Get the tone arm size and position relative to the turntable
     toneArmBase.setXY(componentSize - margin, margin * 1.8);
     toneArmBaseRadius = turntableRadius * 0.2;
+    markerRadius = turntableRadius * 0.05;
+    markerDistance = turntableRadius * 0.85;
     toneArmDistance = toneArmBase.getDistanceFrom(needleTrackStart);
 
     // Set start and stop position angles for the tone arm on the needle track
@@ -97,6 +82,9 @@ void TurntableDisplay::resized()
 
     // Set the tone arm needle position to the correct place on the track
     updateNeedlePosition();
+
+    // Render the parts that don't move
+    renderStaticImage();
 }
 
 
@@ -105,10 +93,30 @@ void TurntableDisplay::setPositionRelative(double _relativePosition)
     // Only change if there is change to show
     if (_relativePosition != relativePosition)
     {
-        // Update the relative position
+        // Move the tone arm, repainting where it was and where it is now
+        juce::Rectangle<int> oldBounds = getToneArmBounds();
         relativePosition = _relativePosition;
-        // Redraw the turntable
-        repaint();
+        updateNeedlePosition();
+        juce::Rectangle<int> newBounds = getToneArmBounds();
+        if (newBounds != oldBounds)
+        {
+            repaint(oldBounds.getUnion(newBounds));
+        }
+    }
+}
+
+void TurntableDisplay::setPositionInSeconds(double seconds)
+{
+    // Wrap the angle to one turn, so it stays precise for long tracks
+    float angle = static_cast<float>(std::fmod(seconds * platterRadiansPerSecond, 
+                                               juce::MathConstants<double>::twoPi));
+    if (angle != platterAngle)
+    {
+        // Move the marker, repainting where it was and where it is now
+        juce::Rectangle<int> oldBounds = getMarkerBounds();
+        platterAngle = angle;
+        repaint(oldBounds);
+        repaint(getMarkerBounds());
     }
 }
 
@@ -123,4 +131,62 @@ void TurntableDisplay::updateNeedlePosition()
     // Calculate and update the new needle and elbow point coordinates
     toneArmNeedle = toneArmBase.getPointOnCircumference(toneArmDistance, needleAngle);
     toneArmElbow = toneArmBase.getPointOnCircumference(toneArmDistance * 0.63, elbowAngle);
+}
+
+void TurntableDisplay::renderStaticImage()
+{
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        staticImage = {};
+        return;
+    }
+
+    staticImage = juce::Image{ juce::Image::ARGB, getWidth(), getHeight(), true };
+    juce::Graphics g{ staticImage };
+
+    // Clear the background
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));   
+
+    // Draw the turntable
+    g.setColour(juce::Colours::black);
+    g.fillEllipse(turntableCentre.getX() - turntableRadius,       // outer circle
+        turntableCentre.getY() - turntableRadius,
+        turntableRadius * 2,
+        turntableRadius * 2);
+    g.setColour(juce::Colours::silver);
+    g.fillEllipse(turntableCentre.getX() - turntableInnerRadius,  // inner circle
+        turntableCentre.getY() - turntableInnerRadius,
+        turntableInnerRadius * 2,
+        turntableInnerRadius * 2);
+
+    // Draw the tone arm base
+    g.setColour(juce::Colours::dimgrey);
+    g.fillEllipse(toneArmBase.getX() - toneArmBaseRadius,         // outer circle
+        toneArmBase.getY() - toneArmBaseRadius,
+        toneArmBaseRadius * 2,
+        toneArmBaseRadius * 2);
+    g.setColour(juce::Colours::grey);
+    g.fillEllipse(toneArmBase.getX() - (toneArmBaseRadius * 0.5), // inner circle
+        toneArmBase.getY() - (toneArmBaseRadius * 0.5),
+        toneArmBaseRadius,
+        toneArmBaseRadius);
+}
+
+// The tone arm is drawn between its base, elbow and needle, with a stroke
+// up to 3 pixels wide
+juce::Rectangle<int> TurntableDisplay::getToneArmBounds() const
+{
+    return juce::Rectangle<float>{ toneArmBase, toneArmElbow }
+        .getUnion(juce::Rectangle<float>{ toneArmElbow, toneArmNeedle })
+        .expanded(3)
+        .getSmallestIntegerContainer();
+}
+
+juce::Rectangle<int> TurntableDisplay::getMarkerBounds() const
+{
+    juce::Point<float> marker = turntableCentre.getPointOnCircumference(markerDistance, platterAngle);
+    return juce::Rectangle<float>{ markerRadius * 2, markerRadius * 2 }
+        .withCentre(marker)
+        .expanded(1)
+        .getSmallestIntegerContainer();
 }
\ No newline at end of file
@@ -4,6 +4,14 @@
 #include "DJAudioPlayer.h"
 
 
+/**
+ * Draws a turntable whose tone arm follows the playhead across the record,
+ * with a marker on the platter that turns as the track plays.
+ *
+ * The platter and tone arm base never move, so they are rendered into an
+ * image when the component is resized. Each update only repaints the areas
+ * the tone arm and platter marker have moved through.
+ */
 class TurntableDisplay  : public juce::Component
 {
 public:
@@ -36,16 +44,49 @@ public:
      */
     void setPositionRelative(double _relativePosition);
 
+    /**
+     * Sets the playhead position in seconds, which turns the platter marker
+     * at the speed of a record. This is called by DeckGUI::timerCallback().
+     *
+     * @param seconds - The position of the playhead in the track.
+     */
+    void setPositionInSeconds(double seconds);
+
 private:
     /** 
-     * Updates the coordinates of the toneArmNeedle. Called in paint() 
-     * and resized(). Repainting is done whenever setPositionRelative() is called
-     * by the DeckGUI::timerCallback function.
+     * Updates the coordinates of the toneArmNeedle. Called in resized() 
+     * and whenever setPositionRelative() changes the position.
      */
     void updateNeedlePosition();
 
+    /**
+     * Renders the platter and tone arm base into the static image.
+     */
+    void renderStaticImage();
+
+    /**
+     * Gets the area covered by the tone arm at its current position.
+     *
+     * @return The tone arm bounds.
+     */
+    juce::Rectangle<int> getToneArmBounds() const;
+
+    /**
+     * Gets the area covered by the platter marker at its current angle.
+     *
+     * @return The marker bounds.
+     */
+    juce::Rectangle<int> getMarkerBounds() const;
+
     // The relative position of the playhead as a percentage of track length
     double relativePosition{0};
+    // Angle of the platter marker, in radians clockwise from the top
+    float platterAngle{0};
+    // Platter speed, in radians per second of playback (33 1/3 rpm)
+    static constexpr double platterRadiansPerSecond{ (100.0 / 3.0) / 60.0 * juce::MathConstants<double>::twoPi };
+
+    // The platter and tone arm base, rendered when resized
+    juce::Image staticImage;
 
     // Layout variables
     float componentSize{};
@@ -56,6 +97,8 @@ private:
     float turntableInnerRadius{};   // to inner circle edge of turntable
     float toneArmBaseRadius{};      // to outer edge of tone arm base
     float toneArmDistance{};        // straight distance from tone arm base to needle
+    float markerRadius{};           // radius of the platter marker dot
+    float markerDistance{};         // distance of the marker from the turntable centre
 
     // Turntable coordinate points
     juce::Point<float> turntableCentre{};   // center of the turntable
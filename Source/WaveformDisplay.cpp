@@ -5,9 +5,10 @@
 WaveformDisplay::WaveformDisplay(juce::AudioFormatManager& formatManagerToUse,
     juce::AudioThumbnailCache& cacheToUse)
     : audioThumb {           
-        1000,                   // image resolution
+        PersistentThumbnailCache::thumbnailResolution,  // image resolution
         formatManagerToUse,     // shared audio format manager 
         cacheToUse },           // shared AudioThumbnailCache 
+      readerFactory { formatManagerToUse },
       fileLoaded { false }    
 {
     // Register change listener
@@ -18,68 +19,245 @@ WaveformDisplay::~WaveformDisplay()
 {
 }
 
+// The waveforms are drawn from cached images, so painting is only a couple
+// of image copies and the playhead bars.
 void WaveformDisplay::paint(juce::Graphics& g)
 {
     // Clear the background
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
 
-    // Draw an outline around the component
-    g.setColour(juce::Colours::grey);
-    g.drawRect(getLocalBounds(), 1);   
-
-    // Set draw colour to orange
-    g.setColour(juce::Colours::orange);
-
     // Draw the waveform only if file is loaded to the deck
     if (fileLoaded)
     {
-        // Draw the waveform
-        audioThumb.drawChannel(g, getLocalBounds(),
-            0, audioThumb.getTotalLength(),
-            0, 1.0f);
+        // Draw the whole waveform in the overview, rendering it first if
+        // it has changed
+        if (overviewImageDirty)
+        {
+            renderOverviewImage();
+        }
+        g.drawImageAt(overviewImage, overviewBounds.getX(), overviewBounds.getY());
+
+        // Draw the zoomed view around the playhead
+        if (pyramid != nullptr && !zoomedBounds.isEmpty())
+        {
+            // Render the zoomed image again if it has changed, or the view
+            // has scrolled off the edge of it. The view is put in the middle
+            // third, so it can scroll a whole view width either way.
+            juce::int64 firstPixel = getZoomedFirstPixel();
+            if (zoomedImageDirty || firstPixel < zoomedImageFirstPixel
+                || firstPixel + zoomedBounds.getWidth() > zoomedImageFirstPixel + zoomedImage.getWidth())
+            {
+                renderZoomedImage(firstPixel - zoomedBounds.getWidth());
+            }
 
-        // Draw the playhead indicator
+            // Copy the visible part of the image
+            juce::Graphics::ScopedSaveState saveState{ g };
+            g.reduceClipRegion(zoomedBounds);
+            g.drawImageAt(zoomedImage, 
+                          zoomedBounds.getX() - static_cast<int>(firstPixel - zoomedImageFirstPixel), 
+                          zoomedBounds.getY());
+        }
+
+        // Draw the playhead indicators, in the middle of the zoomed view
+        // and at the track position on the overview
         g.setColour(juce::Colours::lightgreen);
-        juce::Rectangle<int> playheadBar(relativePosition * getWidth(), 
-                                         0, 4, getHeight());
-        g.fillRect(playheadBar);
+        g.fillRect(zoomedBounds.getCentreX() - 1, zoomedBounds.getY(), 2, zoomedBounds.getHeight());
+        g.fillRect(getOverviewPlayheadBounds());
     }
     else
     {
         // Draw placeholder text
+        g.setColour(juce::Colours::orange);
         g.setFont(20.0f);
         g.drawText("File not loaded...", getLocalBounds(),
             juce::Justification::centred, true);
     }
+
+    // Draw an outline around the component
+    g.setColour(juce::Colours::grey);
+    g.drawRect(getLocalBounds(), 1);   
 }
 
 void WaveformDisplay::resized()
 {
+    // Split into the zoomed view and the overview below it
+    zoomedBounds = getLocalBounds();
+    overviewBounds = zoomedBounds.removeFromBottom(juce::roundToInt(getHeight() * overviewProportion));
+
+    // Both images need rendering at the new size
+    overviewImageDirty = true;
+    zoomedImageDirty = true;
+}
+
+// Each notch of the wheel halves or doubles the time shown
+void WaveformDisplay::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    visibleSeconds = juce::jlimit(minVisibleSeconds, maxVisibleSeconds, 
+                                  visibleSeconds * std::pow(2.0, -wheel.deltaY * 4.0));
+    zoomedImageDirty = true;
+    repaint(zoomedBounds);
 }
 
 void WaveformDisplay::loadURL(const juce::URL& audioURL)
 {
-    // Clear previous drawings
+    // Clear previous drawings, and stop building the last track's pyramid
     audioThumb.clear();
+    pyramidPool.removeAllJobs(true, 2000);
+    pyramid.reset();
+    samplesReadyPainted = 0;
+    overviewImageDirty = true;
+    zoomedImageDirty = true;
+    repaint();
 
-    // Set the audioURL as the input source for the audio thumbnail
-    fileLoaded = audioThumb.setSource(new juce::URLInputSource(audioURL));
+    // Local files are hashed the way the thumbnail cache stores them on
+    // disk, so a thumbnail saved earlier is loaded instead of rebuilt
+    juce::int64 hashCode = audioURL.isLocalFile() 
+        ? PersistentThumbnailCache::getHashForFile(audioURL.getLocalFile())
+        : audioURL.toString(true).hashCode64();
+
+    // Set a reader for the audioURL as the source for the audio thumbnail
+    std::unique_ptr<juce::AudioFormatReader> reader = readerFactory.createReaderFor(audioURL);
+    fileLoaded = reader != nullptr;
+    if (fileLoaded)
+    {
+        audioThumb.setReader(reader.release(), hashCode);
+    }
+
+    // Build the waveform pyramid in the background, with its own reader
+    std::shared_ptr<juce::AudioFormatReader> pyramidReader{ readerFactory.createReaderFor(audioURL) };
+    if (pyramidReader != nullptr)
+    {
+        pyramid = std::make_shared<WaveformPyramid>(pyramidReader->lengthInSamples, pyramidReader->sampleRate);
+        pyramidPool.addJob([pyramid = pyramid, pyramidReader]
+        {
+            juce::ThreadPoolJob* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+            pyramid->build(*pyramidReader, [job] { return job != nullptr && job->shouldExit(); });
+        });
+    }
 }
 
+// Only the strips that change are repainted: the old and new playhead bars
+// on the overview, and the zoomed view if it has scrolled by a pixel.
 void WaveformDisplay::setPositionRelative(double  _relativePosition)
 {
-    // Only change if there is change to show
-    if (_relativePosition != relativePosition)
+    // Only change if there is change to show, either in the position or
+    // in the pyramid being built
+    juce::int64 samplesReady = pyramid != nullptr ? pyramid->getNumSamplesReady() : 0;
+    if (_relativePosition == relativePosition && samplesReady == samplesReadyPainted)
+    {
+        return;
+    }
+
+    // Remember where the playhead was drawn
+    juce::Rectangle<int> oldPlayheadBounds = getOverviewPlayheadBounds();
+    juce::int64 oldFirstPixel = getZoomedFirstPixel();
+
+    // Update the relative position
+    relativePosition = _relativePosition;
+
+    // Redraw the zoomed view with newly built parts of the pyramid
+    if (samplesReady != samplesReadyPainted)
+    {
+        samplesReadyPainted = samplesReady;
+        zoomedImageDirty = true;
+        repaint(zoomedBounds);
+    }
+    else if (getZoomedFirstPixel() != oldFirstPixel)
+    {
+        repaint(zoomedBounds);
+    }
+
+    // Move the overview playhead
+    juce::Rectangle<int> newPlayheadBounds = getOverviewPlayheadBounds();
+    if (newPlayheadBounds != oldPlayheadBounds)
     {
-        // Update the relative position
-        relativePosition = _relativePosition;
-        // Redraw the waveform
-        repaint();
+        repaint(oldPlayheadBounds);
+        repaint(newPlayheadBounds);
     }
 }
 
 // Called whenever the audio thumbnail broadcasts changes
 void WaveformDisplay::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
-    repaint();
+    overviewImageDirty = true;
+    repaint(overviewBounds);
+}
+
+void WaveformDisplay::renderOverviewImage()
+{
+    overviewImageDirty = false;
+    if (overviewBounds.isEmpty())
+    {
+        return;
+    }
+
+    overviewImage = juce::Image{ juce::Image::RGB, overviewBounds.getWidth(), overviewBounds.getHeight(), false };
+    juce::Graphics g{ overviewImage };
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+
+    // Draw the whole waveform
+    g.setColour(juce::Colours::orange);
+    audioThumb.drawChannel(g, overviewImage.getBounds(),
+        0, audioThumb.getTotalLength(),
+        0, 1.0f);
+}
+
+// Each pixel column summarises the samples under it, read from the pyramid
+// level closest to the column's width, so rendering takes the same time at
+// any zoom level.
+void WaveformDisplay::renderZoomedImage(juce::int64 firstPixel)
+{
+    zoomedImageDirty = false;
+    zoomedImageFirstPixel = firstPixel;
+
+    // Three view widths wide, so the view can scroll within it
+    int width = zoomedBounds.getWidth() * 3;
+    int height = zoomedBounds.getHeight();
+    zoomedImage = juce::Image{ juce::Image::RGB, width, height, false };
+    juce::Graphics g{ zoomedImage };
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+
+    double samplesPerPixel = getSamplesPerPixel();
+    float centreY = height / 2.0f;
+    float halfHeight = height / 2.0f;
+
+    for (int x = 0; x < width; ++x)
+    {
+        juce::int64 startSample = static_cast<juce::int64>(std::floor((firstPixel + x) * samplesPerPixel));
+        juce::int64 endSample = static_cast<juce::int64>(std::floor((firstPixel + x + 1) * samplesPerPixel));
+        WaveformPyramid::Peak peak = pyramid->getPeak(startSample, juce::jmax(endSample, startSample + 1));
+
+        // Draw the peaks, with the RMS level on top in a lighter colour
+        g.setColour(juce::Colours::orange);
+        g.drawVerticalLine(x, centreY - peak.max * halfHeight, centreY - peak.min * halfHeight + 1.0f);
+        g.setColour(juce::Colours::orange.brighter(0.6f));
+        g.drawVerticalLine(x, centreY - peak.rms * halfHeight, centreY + peak.rms * halfHeight);
+    }
+}
+
+double WaveformDisplay::getSamplesPerPixel() const
+{
+    if (pyramid == nullptr || zoomedBounds.getWidth() <= 0)
+    {
+        return 1.0;
+    }
+    return visibleSeconds * pyramid->getSampleRate() / zoomedBounds.getWidth();
+}
+
+// The view is scrolled in whole pixels, so the cached image can be copied
+// without resampling
+juce::int64 WaveformDisplay::getZoomedFirstPixel() const
+{
+    if (pyramid == nullptr)
+    {
+        return 0;
+    }
+    double playheadSample = relativePosition * pyramid->getLengthInSamples();
+    return static_cast<juce::int64>(std::floor(playheadSample / getSamplesPerPixel())) - zoomedBounds.getWidth() / 2;
+}
+
+juce::Rectangle<int> WaveformDisplay::getOverviewPlayheadBounds() const
+{
+    return { overviewBounds.getX() + static_cast<int>(relativePosition * overviewBounds.getWidth()), 
+             overviewBounds.getY(), 4, overviewBounds.getHeight() };
 }
\ No newline at end of file
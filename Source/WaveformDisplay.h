@@ -1,8 +1,22 @@
 #pragma once
 
+#include <memory>
 #include <JuceHeader.h>
+#include "AudioFileReaderFactory.h"
+#include "PersistentThumbnailCache.h"
+#include "WaveformPyramid.h"
 
 
+/**
+ * Shows the loaded track's waveform in two views: a zoomed view that
+ * scrolls with the playhead kept in the middle, for cueing, and an overview
+ * of the whole track underneath. The zoomed view is drawn from a waveform
+ * pyramid, and is zoomed in and out with the mouse wheel.
+ *
+ * Both views are rendered into cached images, which are only rendered
+ * again when the track, size or zoom changes. Moving the playhead just
+ * copies the images and repaints the strips that have moved.
+ */
 class WaveformDisplay : public juce::Component,
                         public juce::ChangeListener
 {
@@ -38,8 +52,18 @@ public:
      */
     void resized() override;
 
+    /**
+     * Implements Component: Zooms the zoomed view in or out.
+     *
+     * @param event - The mouse event.
+     * @param wheel - The wheel movement.
+     */
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+
     /** 
-     * Loads the audio file by setting it as source for the AudioThumbnail.
+     * Loads the audio file by setting a reader for it as the source for the
+     * AudioThumbnail, and starts building its waveform pyramid in the
+     * background. Uncompressed files are memory-mapped.
      *
      * @param audioURL - The URL of the audio file to display.
      */
@@ -62,12 +86,75 @@ private:
      */
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
 
+    /**
+     * Renders the whole track's waveform into the overview image.
+     */
+    void renderOverviewImage();
+
+    /**
+     * Renders the zoomed waveform into the zoomed image, three view widths
+     * wide.
+     *
+     * @param firstPixel - The first column to render, in pixels from the
+     *     start of the track at the current zoom.
+     */
+    void renderZoomedImage(juce::int64 firstPixel);
+
+    /**
+     * Gets the number of samples under each column of the zoomed view.
+     *
+     * @return The samples per pixel at the current zoom.
+     */
+    double getSamplesPerPixel() const;
+
+    /**
+     * Gets the first column of the zoomed view, with the playhead in the middle.
+     *
+     * @return The column, in pixels from the start of the track.
+     */
+    juce::int64 getZoomedFirstPixel() const;
+
+    /**
+     * Gets the area of the playhead bar on the overview.
+     *
+     * @return The playhead bar bounds.
+     */
+    juce::Rectangle<int> getOverviewPlayheadBounds() const;
+
     // Audio thumbnail for displaying waveform
     juce::AudioThumbnail audioThumb;
+    // Creates readers for the thumbnail, memory-mapped where possible
+    AudioFileReaderFactory readerFactory;
     // Flag to decide whether to paint the waveform to the component
     bool fileLoaded;
     // Playhead relative position
     double relativePosition{ 0 };
+    // Areas of the zoomed view and the overview
+    juce::Rectangle<int> zoomedBounds;
+    juce::Rectangle<int> overviewBounds;
+    // Cached overview image, and whether it needs rendering again
+    juce::Image overviewImage;
+    bool overviewImageDirty{ true };
+
+    /*------------- Zoomed View ------------*/
+    // Waveform pyramid for the loaded track. Shared with the job building it.
+    std::shared_ptr<WaveformPyramid> pyramid;
+    // How much of the pyramid was ready when it was last drawn
+    juce::int64 samplesReadyPainted{ 0 };
+    // Cached zoomed image, the column it starts at, and whether it needs
+    // rendering again
+    juce::Image zoomedImage;
+    juce::int64 zoomedImageFirstPixel{ 0 };
+    bool zoomedImageDirty{ true };
+    // Seconds of audio shown across the zoomed view
+    double visibleSeconds{ 8.0 };
+    static constexpr double minVisibleSeconds{ 0.5 };
+    static constexpr double maxVisibleSeconds{ 120.0 };
+    // Proportion of the height used by the overview
+    static constexpr float overviewProportion{ 0.3f };
+    // Background thread for building pyramids. Declared last, so it is
+    // destroyed first, while the pyramid is still alive.
+    juce::ThreadPool pyramidPool{ 1 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
 };
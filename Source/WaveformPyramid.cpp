@@ -0,0 +1,181 @@
+#include <cmath>
+#include <JuceHeader.h>
+#include "WaveformPyramid.h"
+
+
+WaveformPyramid::WaveformPyramid(juce::int64 _lengthInSamples, double _sampleRate)
+    : lengthInSamples{ juce::jmax<juce::int64>(0, _lengthInSamples) },
+      sampleRate{ _sampleRate }
+{
+    // The bottom level has a block for every baseBlockSize samples, and each
+    // level above has half as many, up to a single block for the whole track
+    size_t numBlocks = static_cast<size_t>((lengthInSamples + baseBlockSize - 1) / baseBlockSize);
+    levels.emplace_back(numBlocks);
+    while (numBlocks > 1)
+    {
+        numBlocks = (numBlocks + 1) / 2;
+        levels.emplace_back(numBlocks);
+    }
+    numBlocksDone.assign(levels.size(), 0);
+}
+
+WaveformPyramid::~WaveformPyramid()
+{
+}
+
+bool WaveformPyramid::build(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop)
+{
+    // Read up to two channels, a chunk at a time
+    int numChannels = static_cast<int>(juce::jlimit(1u, 2u, reader.numChannels));
+    juce::AudioBuffer<float> buffer{ numChannels, chunkSize };
+
+    for (juce::int64 position = 0; position < lengthInSamples; position += chunkSize)
+    {
+        if (shouldStop != nullptr && shouldStop())
+        {
+            return false;
+        }
+
+        // Read the next chunk
+        int numSamples = static_cast<int>(juce::jmin<juce::int64>(chunkSize, lengthInSamples - position));
+        if (!reader.read(&buffer, 0, numSamples, position, true, numChannels > 1))
+        {
+            DBG("WaveformPyramid::build: could not read the track");
+            return false;
+        }
+
+        // Summarise it, then merge the finished blocks up through the levels.
+        // Chunks are a whole number of blocks, so each chunk starts a new block.
+        addBaseBlocks(buffer, numSamples, static_cast<size_t>(position / baseBlockSize));
+        mergeLevels(static_cast<size_t>((position + numSamples + baseBlockSize - 1) / baseBlockSize));
+
+        // Let the display read the new blocks
+        samplesReady.store(position + numSamples, std::memory_order_release);
+    }
+
+    return true;
+}
+
+// Blocks are combined from the level whose block size is closest to the
+// length of the range without going over, so at most three blocks are read.
+WaveformPyramid::Peak WaveformPyramid::getPeak(juce::int64 startSample, juce::int64 endSample) const
+{
+    Peak peak;
+
+    // Only read the part of the range that's ready
+    juce::int64 ready = samplesReady.load(std::memory_order_acquire);
+    startSample = juce::jmax<juce::int64>(0, startSample);
+    endSample = juce::jmin(endSample, ready);
+    if (startSample >= endSample)
+    {
+        return peak;
+    }
+
+    // Pick the level
+    juce::int64 span = endSample - startSample;
+    size_t level = 0;
+    while (level + 1 < levels.size() && (static_cast<juce::int64>(baseBlockSize) << (level + 1)) <= span)
+    {
+        ++level;
+    }
+    juce::int64 blockSize = static_cast<juce::int64>(baseBlockSize) << level;
+
+    // Find the blocks covering the range. A block at the end that isn't
+    // finished yet is left out.
+    juce::int64 firstBlock = startSample / blockSize;
+    juce::int64 lastBlock = (endSample - 1) / blockSize;
+    if ((lastBlock + 1) * blockSize > ready && ready < lengthInSamples)
+    {
+        --lastBlock;
+    }
+    if (lastBlock < firstBlock)
+    {
+        return peak;
+    }
+
+    // Combine the blocks
+    const std::vector<Block>& blocks = levels[level];
+    float sumOfSquares = 0;
+    peak.min = blocks[static_cast<size_t>(firstBlock)].min;
+    peak.max = blocks[static_cast<size_t>(firstBlock)].max;
+    for (juce::int64 i = firstBlock; i <= lastBlock; ++i)
+    {
+        const Block& block = blocks[static_cast<size_t>(i)];
+        peak.min = juce::jmin(peak.min, block.min);
+        peak.max = juce::jmax(peak.max, block.max);
+        sumOfSquares += block.sumOfSquares;
+    }
+    juce::int64 numSamples = juce::jmin((lastBlock + 1) * blockSize, lengthInSamples) - firstBlock * blockSize;
+    peak.rms = std::sqrt(sumOfSquares / static_cast<float>(numSamples));
+
+    return peak;
+}
+
+juce::int64 WaveformPyramid::getNumSamplesReady() const
+{
+    return samplesReady.load(std::memory_order_acquire);
+}
+
+juce::int64 WaveformPyramid::getLengthInSamples() const
+{
+    return lengthInSamples;
+}
+
+double WaveformPyramid::getSampleRate() const
+{
+    return sampleRate;
+}
+
+void WaveformPyramid::addBaseBlocks(const juce::AudioBuffer<float>& buffer, int numSamples, size_t firstBlock)
+{
+    const float* left = buffer.getReadPointer(0);
+    const float* right = buffer.getReadPointer(buffer.getNumChannels() > 1 ? 1 : 0);
+    std::vector<Block>& blocks = levels[0];
+
+    for (int start = 0; start < numSamples; start += baseBlockSize)
+    {
+        int end = juce::jmin(start + baseBlockSize, numSamples);
+
+        // Summarise the mono mix of the block
+        Block block;
+        block.min = block.max = 0.5f * (left[start] + right[start]);
+        for (int i = start; i < end; ++i)
+        {
+            float sample = 0.5f * (left[i] + right[i]);
+            block.min = juce::jmin(block.min, sample);
+            block.max = juce::jmax(block.max, sample);
+            block.sumOfSquares += sample * sample;
+        }
+        blocks[firstBlock + static_cast<size_t>(start / baseBlockSize)] = block;
+    }
+}
+
+void WaveformPyramid::mergeLevels(size_t numBaseBlocks)
+{
+    numBlocksDone[0] = numBaseBlocks;
+
+    for (size_t level = 1; level < levels.size(); ++level)
+    {
+        const std::vector<Block>& below = levels[level - 1];
+        std::vector<Block>& blocks = levels[level];
+
+        // A block is finished once both blocks below it are, or once the
+        // one below it is if it's the last in its level
+        size_t numBelow = numBlocksDone[level - 1];
+        size_t numDone = numBelow == below.size() ? blocks.size() : numBelow / 2;
+
+        for (size_t i = numBlocksDone[level]; i < numDone; ++i)
+        {
+            Block block = below[2 * i];
+            if (2 * i + 1 < below.size())
+            {
+                const Block& next = below[2 * i + 1];
+                block.min = juce::jmin(block.min, next.min);
+                block.max = juce::jmax(block.max, next.max);
+                block.sumOfSquares += next.sumOfSquares;
+            }
+            blocks[i] = block;
+        }
+        numBlocksDone[level] = numDone;
+    }
+}
\ No newline at end of file
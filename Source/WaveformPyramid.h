@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <JuceHeader.h>
+
+
+/**
+ * A multi-resolution summary of a track's waveform, for drawing it at any
+ * zoom level.
+ *
+ * The bottom level holds the minimum, maximum and RMS of each block of
+ * baseBlockSize samples, and each level above merges pairs of blocks from
+ * the level below. A range of samples is summarised from the level whose
+ * blocks are closest to the range's length, so it only ever touches a few
+ * blocks, however far the view is zoomed out.
+ *
+ * The pyramid is built on a background thread, and can be read from another
+ * thread while it is being built. Blocks are readable once they are ready.
+ */
+class WaveformPyramid
+{
+public:
+    /** The summary of a range of samples, mixed down to mono. */
+    struct Peak
+    {
+        float min{ 0 };
+        float max{ 0 };
+        float rms{ 0 };
+    };
+
+    /**
+     * Constructor. Allocates space for the pyramid.
+     *
+     * @param _lengthInSamples - The length of the track.
+     * @param _sampleRate      - The sample rate of the track.
+     */
+    WaveformPyramid(juce::int64 _lengthInSamples, double _sampleRate);
+
+    /** Destructor */
+    ~WaveformPyramid();
+
+    /**
+     * Builds the pyramid from a track. Blocks until the whole track has been
+     * read, so only call this on a background thread.
+     *
+     * @param reader     - The reader for the track.
+     * @param shouldStop - Checked between chunks. Return true to give up.
+     * @return True if the whole track was read.
+     */
+    bool build(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop);
+
+    /**
+     * Summarises a range of samples. Any part of the range that isn't ready
+     * yet, or is outside the track, is treated as silence.
+     *
+     * @param startSample - The first sample in the range.
+     * @param endSample   - The sample after the last one in the range.
+     * @return The minimum, maximum and RMS of the range.
+     */
+    Peak getPeak(juce::int64 startSample, juce::int64 endSample) const;
+
+    /**
+     * Gets how much of the track has been summarised so far.
+     *
+     * @return The number of samples summarised.
+     */
+    juce::int64 getNumSamplesReady() const;
+
+    /**
+     * Gets the length of the track.
+     *
+     * @return The length, in samples.
+     */
+    juce::int64 getLengthInSamples() const;
+
+    /**
+     * Gets the sample rate of the track.
+     *
+     * @return The sample rate.
+     */
+    double getSampleRate() const;
+
+    // Samples summarised by each block in the bottom level
+    static constexpr int baseBlockSize{ 64 };
+
+private:
+    /** The summary of one block, before it's turned into a Peak. */
+    struct Block
+    {
+        float min{ 0 };
+        float max{ 0 };
+        float sumOfSquares{ 0 };
+    };
+
+    /**
+     * Summarises newly decoded audio into the bottom level.
+     *
+     * @param buffer     - The decoded audio.
+     * @param numSamples - The number of samples in the buffer.
+     * @param firstBlock - The index of the block the buffer starts at.
+     */
+    void addBaseBlocks(const juce::AudioBuffer<float>& buffer, int numSamples, size_t firstBlock);
+
+    /**
+     * Merges newly finished blocks into every level above the bottom one.
+     *
+     * @param numBaseBlocks - The number of finished blocks in the bottom level.
+     */
+    void mergeLevels(size_t numBaseBlocks);
+
+    // Length and sample rate of the track
+    juce::int64 lengthInSamples;
+    double sampleRate;
+    // The levels of the pyramid, from the bottom up
+    std::vector<std::vector<Block>> levels;
+    // Number of finished blocks in each level. Only used while building.
+    std::vector<size_t> numBlocksDone;
+    // Samples summarised so far. Blocks covering them are safe to read.
+    std::atomic<juce::int64> samplesReady{ 0 };
+
+    // Samples read from the track at a time
+    static constexpr int chunkSize{ baseBlockSize * 1024 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformPyramid)
+};